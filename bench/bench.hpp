@@ -0,0 +1,33 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Timing utilities shared by the benchmark suites.
+//! @note Benchmarks are skipped by default. Run them with "--test-suite=benchmarks --no-skip", ideally in an optimized
+//! build with doctest enabled.
+
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace gynjo::bench {
+	//! Calls @p f @p iterations times and returns the mean wall-clock time per call, in seconds.
+	template <typename F>
+	auto seconds_per_call(std::size_t iterations, F&& f) -> double {
+		auto const start = std::chrono::steady_clock::now();
+		for (std::size_t i = 0; i < iterations; ++i) {
+			f();
+		}
+		std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / iterations;
+	}
+
+	//! Reads the entire contents of the file at @p path.
+	inline auto read_file(char const* path) -> std::string {
+		std::ifstream fin{path};
+		std::stringstream ss;
+		ss << fin.rdbuf();
+		return ss.str();
+	}
+}
@@ -0,0 +1,295 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "bench.hpp"
+
+#include "interpreter.hpp"
+#include "module_cache.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <filesystem>
+#include <string>
+#include <utility>
+
+TEST_SUITE("benchmarks") {
+	using namespace gynjo;
+
+	TEST_CASE("core library evaluation" * doctest::skip()) {
+		// Workloads from the core library tests, scaled up. Parsing is included but is a tiny part of each workload.
+		constexpr std::array workloads{
+			"len(range(1, 200))",
+			"reverse(range(1, 200))",
+			"map(range(1, 100), x -> x^2)",
+			"reduce(range(1, 200), 0, (a, b) -> a + b)",
+			"flatmap(range(1, 30), x -> [x, x])",
+			"insert(range(1, 50), 25, 0)",
+			"fact 100",
+			"nPk(40, 20)",
+			"abs(nCk(30, 15) - 155117520) < 10**-50",
+		};
+		auto const env = environment::make_with_core_libs();
+		double total = 0;
+		fmt::print("core library evaluation:\n");
+		for (auto const workload : workloads) {
+			REQUIRE(eval(env, workload).has_value());
+			auto const seconds = bench::seconds_per_call(20, [&] { eval(env, workload); });
+			total += seconds;
+			fmt::print("  {:<42} {:>10.1f} us\n", workload, seconds * 1e6);
+		}
+		fmt::print("  {:<42} {:>10.1f} us\n", "total", total * 1e6);
+	}
+
+	TEST_CASE("tree walker vs. VM" * doctest::skip()) {
+		// Loop-heavy and recursion-heavy functions from the core library.
+		constexpr std::array workloads{
+			"len(range(1, 300))",
+			"fact 200",
+			"reduce(range(1, 200), 0, (a, b) -> a + b)",
+			"append(range(1, 100), 0)",
+			"concat(range(1, 100), range(1, 100))",
+			"nPk(80, 40)",
+		};
+		auto const env = environment::make_with_core_libs();
+		auto const original = current_engine();
+		fmt::print("tree walker vs. VM:\n");
+		fmt::print("  {:<42} {:>10} {:>10}\n", "", "tree (us)", "VM (us)");
+		for (auto const workload : workloads) {
+			std::array<double, 2> seconds;
+			for (auto const e : {engine::tree_walker, engine::vm}) {
+				set_engine(e);
+				REQUIRE(eval(env, workload).has_value());
+				seconds[static_cast<std::size_t>(e)] = bench::seconds_per_call(20, [&] { eval(env, workload); });
+			}
+			fmt::print("  {:<42} {:>10.1f} {:>10.1f}\n", workload, seconds[0] * 1e6, seconds[1] * 1e6);
+		}
+		set_engine(original);
+	}
+
+	TEST_CASE("local variable access on 10k-element inputs" * doctest::skip()) {
+		// Loops whose bodies mostly read and assign local variables.
+		constexpr std::array workloads{"fact 10000", "len big", "reverse big"};
+		auto const env = environment::make_with_core_libs();
+		auto const original = current_engine();
+		fmt::print("local variable access on 10k-element inputs:\n");
+		fmt::print("  {:<42} {:>10} {:>10}\n", "", "tree (ms)", "VM (ms)");
+		for (auto const workload : workloads) {
+			std::array<double, 2> seconds;
+			for (auto const e : {engine::tree_walker, engine::vm}) {
+				set_engine(e);
+				auto const local_env = std::make_shared<environment>(env);
+				REQUIRE(exec(local_env, "let big = range(1, 10000)").has_value());
+				REQUIRE(eval(local_env, workload).has_value());
+				seconds[static_cast<std::size_t>(e)] = bench::seconds_per_call(3, [&] { eval(local_env, workload); });
+			}
+			fmt::print("  {:<42} {:>10.1f} {:>10.1f}\n", workload, seconds[0] * 1e3, seconds[1] * 1e3);
+		}
+		set_engine(original);
+	}
+
+	TEST_CASE("clusters" * doctest::skip()) {
+		// Clusters evaluated over and over, which follow their cached plans.
+		constexpr std::array workloads{"chain 1.001", "chains 100", "convert 1000"};
+		auto const env = environment::make_with_core_libs();
+		std::string chain = "x";
+		for (int i = 1; i < 200; ++i) {
+			chain += " x";
+		}
+		REQUIRE(exec(env, fmt::format("let chain = x -> {}", chain)).has_value());
+		REQUIRE(exec(env, R"(
+			let chains = n -> { let i = 0 while i < n do { let c = 2 i i 3 i/4 i i^2 5 let i = i + 1 }; return i }
+			let convert = n -> { let f = 0 while f < n do { let c = 5/9(f - 32) let f = f + 1 }; return c }
+			)")
+					.has_value());
+		auto const original = current_engine();
+		fmt::print("clusters:\n");
+		fmt::print("  {:<42} {:>10} {:>10}\n", "", "tree (us)", "VM (us)");
+		for (auto const workload : workloads) {
+			std::array<double, 2> seconds;
+			for (auto const e : {engine::tree_walker, engine::vm}) {
+				set_engine(e);
+				REQUIRE(eval(env, workload).has_value());
+				seconds[static_cast<std::size_t>(e)] = bench::seconds_per_call(20, [&] { eval(env, workload); });
+			}
+			fmt::print("  {:<42} {:>10.1f} {:>10.1f}\n", workload, seconds[0] * 1e6, seconds[1] * 1e6);
+		}
+		set_engine(original);
+	}
+
+	TEST_CASE("shallow calls" * doctest::skip()) {
+		// Many calls that never nest deeply, where keeping the call stack on the heap must not cost throughput.
+		constexpr std::array workloads{
+			"fib 18",
+			"map(range(1, 300), x -> x + 1)",
+			"reduce(range(1, 300), 0, (a, b) -> a + b)",
+			"nPk(80, 40)",
+		};
+		auto const env = environment::make_with_core_libs();
+		REQUIRE(exec(env, "let fib = n -> n <= 1 ? n : fib(n - 1) + fib(n - 2)").has_value());
+		auto const original = current_engine();
+		fmt::print("shallow calls:\n");
+		fmt::print("  {:<42} {:>10} {:>10}\n", "", "tree (us)", "VM (us)");
+		for (auto const workload : workloads) {
+			std::array<double, 2> seconds;
+			for (auto const e : {engine::tree_walker, engine::vm}) {
+				set_engine(e);
+				REQUIRE(eval(env, workload).has_value());
+				seconds[static_cast<std::size_t>(e)] = bench::seconds_per_call(10, [&] { eval(env, workload); });
+			}
+			fmt::print("  {:<42} {:>10.1f} {:>10.1f}\n", workload, seconds[0] * 1e6, seconds[1] * 1e6);
+		}
+		set_engine(original);
+	}
+
+	TEST_CASE("tail calls, 10 million iterations" * doctest::skip()) {
+		// Per-call overhead of tail-recursive loops, which run in constant stack space. The while-loop does the same
+		// arithmetic without calls, for comparison.
+		constexpr int n = 10'000'000;
+		constexpr std::array workloads{
+			std::pair{"tail-recursive count", "count(n, 0)"},
+			std::pair{"mutually recursive count", "even(n, 0)"},
+			std::pair{"while-loop count", "loop(n, 0)"},
+		};
+		constexpr auto definitions = R"(
+			let count = (n, acc) -> n = 0 ? acc : count(n - 1, acc + 1)
+			let even = (n, acc) -> n = 0 ? acc : odd(n - 1, acc + 1)
+			let odd = (n, acc) -> n = 0 ? acc : even(n - 1, acc + 1)
+			let loop = (n, acc) -> {
+				while n != 0 do {
+					let n = n - 1
+					let acc = acc + 1
+				};
+				return acc
+			}
+			)";
+		auto const original = current_engine();
+		fmt::print("tail calls, 10 million iterations:\n");
+		fmt::print("  {:<42} {:>10} {:>10}\n", "", "tree (ns)", "VM (ns)");
+		for (auto const& [name, workload] : workloads) {
+			std::array<double, 2> seconds;
+			for (auto const e : {engine::tree_walker, engine::vm}) {
+				set_engine(e);
+				auto const env = environment::make_empty();
+				REQUIRE(exec(env, definitions).has_value());
+				REQUIRE(exec(env, fmt::format("let n = {}", n)).has_value());
+				val::value result;
+				seconds[static_cast<std::size_t>(e)] =
+					bench::seconds_per_call(1, [&] { result = eval(env, workload).value(); });
+				CHECK(val::value{val::num{n}} == result);
+			}
+			fmt::print("  {:<42} {:>10.1f} {:>10.1f}\n", name, seconds[0] / n * 1e9, seconds[1] / n * 1e9);
+		}
+		set_engine(original);
+	}
+
+	TEST_CASE("counting loop, 1 million iterations" * doctest::skip()) {
+		// A loop whose body is little more than number literals, like the counting loops in the core library.
+		constexpr int n = 1'000'000;
+		auto const original = current_engine();
+		fmt::print("counting loop, 1 million iterations:\n");
+		fmt::print("  {:<42} {:>10} {:>10}\n", "", "tree (ns)", "VM (ns)");
+		std::array<double, 2> seconds;
+		for (auto const e : {engine::tree_walker, engine::vm}) {
+			set_engine(e);
+			auto const env = environment::make_empty();
+			REQUIRE(exec(env, "let count = n -> { let i = 0 while i < n do { let i = i + 1 }; return i }").has_value());
+			val::value result;
+			seconds[static_cast<std::size_t>(e)] =
+				bench::seconds_per_call(1, [&] { result = eval(env, fmt::format("count {}", n)).value(); });
+			CHECK(val::value{val::num{n}} == result);
+		}
+		fmt::print("  {:<42} {:>10.1f} {:>10.1f}\n", "count", seconds[0] / n * 1e9, seconds[1] / n * 1e9);
+		set_engine(original);
+	}
+
+	TEST_CASE("number representations" * doctest::skip()) {
+		// Integer-heavy workloads, which run on machine integers, and non-integral ones, which run on decimals unless
+		// binary floats are enabled. Literals take their representations when they're parsed, so each setting gets its
+		// own environment.
+		constexpr std::array workloads{
+			"count 100000", "fact 20", "fact 100", "len(range(1, 1000))", "halve 10000", "map(xs, ftoc)"};
+		auto const original = val::binary_floats_enabled();
+		std::array<env_ptr, 2> envs;
+		for (bool const binary : {false, true}) {
+			val::set_binary_floats(binary);
+			envs[binary] = environment::make_empty();
+			import_natives(envs[binary]);
+			REQUIRE(exec(envs[binary], R"(
+				import "core/constants.gynj"
+				import "core/core.gynj"
+				let count = n -> { let i = 0 while i < n do { let i = i + 1 }; return i }
+				let halve = n -> { let x = 0.5 while n > 0 do { let x = x / 2 + 0.25 let n = n - 1 }; return x }
+				let xs = map(range(1, 100), x -> x - 50.5)
+				)")
+						.has_value());
+		}
+		fmt::print("number representations:\n");
+		fmt::print("  {:<42} {:>10} {:>10}\n", "", "dec (us)", "bin (us)");
+		for (auto const workload : workloads) {
+			std::array<double, 2> seconds;
+			for (bool const binary : {false, true}) {
+				val::set_binary_floats(binary);
+				auto const& env = envs[binary];
+				REQUIRE(eval(env, workload).has_value());
+				seconds[binary] = bench::seconds_per_call(5, [&] { eval(env, workload); });
+			}
+			fmt::print("  {:<42} {:>10.1f} {:>10.1f}\n", workload, seconds[0] * 1e6, seconds[1] * 1e6);
+		}
+		val::set_binary_floats(original);
+	}
+
+	TEST_CASE("core math helpers, unoptimized vs. optimized" * doctest::skip()) {
+		// The core library's arithmetic helpers, with the library imported with and without optimization, each applied
+		// to 100 numbers.
+		constexpr std::array workloads{
+			"map(xs, abs)", "map(xs, sqrt)", "map(xs, cbrt)", "map(xs, ftoc)", "map(xs, ctof)", "fact 100"};
+		auto const original = optimization_enabled();
+		std::array<env_ptr, 2> envs;
+		for (bool const optimize : {false, true}) {
+			set_optimization(optimize);
+			envs[optimize] = environment::make_empty();
+			import_natives(envs[optimize]);
+			REQUIRE(exec(envs[optimize], R"(import "core/constants.gynj" import "core/core.gynj")").has_value());
+			REQUIRE(exec(envs[optimize], "let xs = map(range(1, 100), x -> x - 50.5)").has_value());
+		}
+		fmt::print("core math helpers, unoptimized vs. optimized:\n");
+		fmt::print("  {:<42} {:>10} {:>10}\n", "", "off (us)", "on (us)");
+		for (auto const workload : workloads) {
+			std::array<double, 2> seconds;
+			for (bool const optimize : {false, true}) {
+				set_optimization(optimize);
+				auto const& env = envs[optimize];
+				REQUIRE(eval(env, workload).has_value());
+				seconds[optimize] = bench::seconds_per_call(20, [&] { eval(env, workload); });
+			}
+			fmt::print("  {:<42} {:>10.2f} {:>10.2f}\n", workload, seconds[0] * 1e6, seconds[1] * 1e6);
+		}
+		set_optimization(original);
+	}
+
+	TEST_CASE("core library startup, cold vs. warm" * doctest::skip()) {
+		// Imports the core libraries into a fresh environment, as every process start does. Cold imports have no module
+		// caches and so must lex, parse, and write caches. Warm imports read the caches.
+		constexpr std::array libs{"core/constants.gynj", "core/core.gynj"};
+		auto const import_core = [&] {
+			auto const env = environment::make_empty();
+			for (auto const lib : libs) {
+				REQUIRE(exec(env, fmt::format("import \"{}\"", lib)).has_value());
+			}
+		};
+		auto const cold = bench::seconds_per_call(200, [&] {
+			for (auto const lib : libs) {
+				std::filesystem::remove(cache_path(lib));
+			}
+			import_core();
+		});
+		auto const warm = bench::seconds_per_call(200, import_core);
+		fmt::print("core library startup: cold {:>8.1f} us, warm {:>8.1f} us\n", cold * 1e6, warm * 1e6);
+	}
+}
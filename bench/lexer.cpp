@@ -0,0 +1,126 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "bench.hpp"
+
+#include "lexer.hpp"
+#include "simd.hpp"
+
+#include "../test/allocations.hpp"
+#include "../test/regex_lexer.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <fmt/format.h>
+
+#include <random>
+
+TEST_SUITE("benchmarks") {
+	using namespace gynjo;
+
+	TEST_CASE("lexer throughput" * doctest::skip()) {
+		auto const core = bench::read_file("core/core.gynj");
+		// Repeat the core library to build larger inputs. Newlines keep comments from swallowing the next copy.
+		auto const repeat = [&](std::size_t min_size) {
+			std::string result;
+			while (result.size() < min_size) {
+				result += core;
+				result += '\n';
+			}
+			return result;
+		};
+		auto const one_mb = repeat(1 << 20);
+		auto const hundred_mb = repeat(100 << 20);
+		// Reserved words mixed with symbols that share their prefixes, to stress keyword classification.
+		std::string words;
+		while (words.size() < (1 << 20)) {
+			words += "let lets if iffy while whilst top topmost print printer return returned and android not note ";
+		}
+
+		auto const report = [](char const* lexer_name, std::string const& input, std::size_t iterations, auto lex) {
+			std::size_t token_count = 0;
+			auto const seconds = bench::seconds_per_call(iterations, [&] { token_count = lex(input).value().size(); });
+			fmt::print("{:<8} {:>12} bytes {:>10} tokens {:>10.2f} MB/s\n",
+				lexer_name,
+				input.size(),
+				token_count,
+				input.size() / seconds / 1e6);
+		};
+		fmt::print("lexer throughput:\n");
+		report("regex", core, 20, test::regex_lex);
+		report("regex", one_mb, 1, test::regex_lex);
+		report("scanner", core, 2000, lex);
+		report("scanner", one_mb, 20, lex);
+		report("scanner", hundred_mb, 1, lex);
+		report("words", words, 20, lex);
+	}
+
+	TEST_CASE("lexer allocations" * doctest::skip()) {
+		auto const report = [](char const* input_name, std::string const& input) {
+			auto const before = test::allocation_count();
+			auto const token_count = lex(input).value().size();
+			auto const allocations = test::allocation_count() - before;
+			fmt::print("{:<10} {:>8} tokens {:>8} allocations {:>8.1f} allocations per 1k tokens\n",
+				input_name,
+				token_count,
+				allocations,
+				1000.0 * allocations / token_count);
+		};
+		fmt::print("lexer allocations:\n");
+		report("core", bench::read_file("core/core.gynj"));
+		// Generated data script with long names and string literals, which defeat the small-string optimization.
+		std::string data;
+		for (int i = 0; i < 1000; ++i) {
+			data += fmt::format("let measurement_series_{:05} = [\"sensor reading label {}\", {}.{}]\n", i, i, i, i % 7);
+		}
+		report("data", data);
+	}
+
+	TEST_CASE("lexer startup" * doctest::skip()) {
+		// Lazily built lexer tables show up as extra latency on the first call. Run this case on its own, e.g. with
+		// --test-case="lexer startup", so neither lexer has been called before.
+		auto const report = [](char const* lexer_name, auto lex) {
+			constexpr std::string_view input = "let f = x -> if x then print x else return top [x]";
+			auto const first = bench::seconds_per_call(1, [&] { lex(input); });
+			auto const steady = bench::seconds_per_call(10000, [&] { lex(input); });
+			fmt::print("{:<8} first call {:>10.1f} us, steady state {:>8.2f} us, startup cost {:>10.1f} us\n",
+				lexer_name,
+				first * 1e6,
+				steady * 1e6,
+				(first - steady) * 1e6);
+		};
+		fmt::print("lexer startup:\n");
+		report("regex", test::regex_lex);
+		report("scanner", lex);
+	}
+
+	TEST_CASE("numeric data lexing" * doctest::skip()) {
+		// A 1 MiB block of a generated data file: an indented, commented list literal of decimal numbers. Lexing the block
+		// 1024 times covers 1 GiB of input without holding it all in memory.
+		std::string block = "let readings = [\n";
+		std::mt19937 gen{42};
+		std::uniform_int_distribution<int> digits_dist{0, 999999};
+		while (block.size() < (1 << 20)) {
+			block += "\t\t// Batch of readings from the primary sensor array, in calibrated units\n\t\t";
+			for (int i = 0; i < 8; ++i) {
+				block += fmt::format("{}.{:06}, ", digits_dist(gen), digits_dist(gen));
+			}
+			block += '\n';
+		}
+		block += "\t\t0\n]\n";
+		constexpr std::size_t repetitions = 1024;
+
+		fmt::print("numeric data lexing ({} MiB):\n", block.size() * repetitions >> 20);
+		auto const original_isa = simd::active_isa();
+		for (auto const isa : {simd::isa::scalar, simd::isa::sse2, simd::isa::avx2}) {
+			if (!simd::set_active_isa(isa)) { continue; }
+			std::size_t token_count = 0;
+			auto const seconds = bench::seconds_per_call(repetitions, [&] { token_count += lex(block).value().size(); });
+			fmt::print("{:<8} {:>12} tokens {:>10.2f} MB/s\n", simd::to_string(isa), token_count, block.size() / seconds / 1e6);
+		}
+		simd::set_active_isa(original_isa);
+	}
+}
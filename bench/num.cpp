@@ -0,0 +1,103 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "bench.hpp"
+
+#include "interpreter.hpp"
+#include "num.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+TEST_SUITE("benchmarks") {
+	using namespace gynjo;
+
+	TEST_CASE("arithmetic at each working precision" * doctest::skip()) {
+		// Each operation applied to 100 non-integers, which are full-precision decimals, as number literals are.
+		using op = val::num (*)(val::num const&, val::num const&);
+		constexpr std::array ops{
+			std::pair<char const*, op>{"+", [](val::num const& a, val::num const& b) { return a + b; }},
+			std::pair<char const*, op>{"*", [](val::num const& a, val::num const& b) { return a * b; }},
+			std::pair<char const*, op>{"/", [](val::num const& a, val::num const& b) { return a / b; }},
+			std::pair<char const*, op>{"^", [](val::num const& a, val::num const& b) { return pow(a, b); }},
+		};
+		std::vector<val::num> xs;
+		for (int i = 1; i <= 100; ++i) {
+			xs.push_back(val::num{i} / val::num{7});
+		}
+		val::num const y{"1.1"};
+		std::vector<val::num> results(xs.size());
+		auto const original = val::working_precision();
+		fmt::print("arithmetic at each working precision:\n");
+		fmt::print("  {:<10}", "");
+		for (auto const digits : val::working_precisions) {
+			fmt::print(" {:>10}", fmt::format("{} (ns)", digits));
+		}
+		fmt::print("\n");
+		for (auto const& [name, f] : ops) {
+			fmt::print("  {:<10}", name);
+			for (auto const digits : val::working_precisions) {
+				REQUIRE(val::set_working_precision(digits));
+				auto const seconds = bench::seconds_per_call(20, [&] {
+					for (std::size_t i = 0; i < xs.size(); ++i) {
+						results[i] = f(xs[i], y);
+					}
+				});
+				fmt::print(" {:>10.1f}", seconds / xs.size() * 1e9);
+			}
+			fmt::print("\n");
+		}
+		val::set_working_precision(original);
+	}
+
+	TEST_CASE("factorials and binomial coefficients" * doctest::skip()) {
+		// The core library's former definitions, which multiply term by term in Gynjo.
+		constexpr auto term_by_term = R"(
+			let old_fact = n -> {
+				let result = 1
+				while n > 1 do {
+					let result = n result
+					let n = n - 1
+				};
+				return result
+			}
+			let old_nPk = (n, k) -> k = 0 ? 1 : n old_nPk(n-1, k-1)
+			let old_nCk = (n, k) -> old_nPk(n, k) / old_fact(k)
+		)";
+		constexpr std::array workloads{
+			std::pair{"fact(10000)", "old_fact(10000)"},
+			std::pair{"nCk(100000, 50000)", "old_nCk(100000, 50000)"},
+		};
+		auto const env = std::make_shared<environment>(environment::make_with_core_libs());
+		REQUIRE(exec(env, term_by_term).has_value());
+		auto const original = current_engine();
+		set_engine(engine::vm);
+		// Times an evaluation, or describes why it failed.
+		auto const time = [&](char const* source) -> std::string {
+			auto const result = eval(env, source);
+			if (!result.has_value()) { return "fails"; }
+			return fmt::format("{:.2f}", bench::seconds_per_call(3, [&] { eval(env, source); }) * 1e3);
+		};
+		fmt::print("factorials and binomial coefficients, VM:\n");
+		fmt::print("  {:<20} {:>20} {:>20} {:>20}\n", "", "term by term (ms)", "intrinsic (ms)", "exact (ms)");
+		for (auto const& [intrinsic, old] : workloads) {
+			auto const term_by_term_time = time(old);
+			auto const intrinsic_time = time(intrinsic);
+			val::set_exact_numbers(true);
+			auto const exact_time = time(intrinsic);
+			val::set_exact_numbers(false);
+			fmt::print("  {:<20} {:>20} {:>20} {:>20}\n", intrinsic, term_by_term_time, intrinsic_time, exact_time);
+		}
+		set_engine(original);
+	}
+}
@@ -0,0 +1,147 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "bench.hpp"
+
+#include "inference.hpp"
+#include "interpreter.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+#include "../test/allocations.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <fmt/format.h>
+
+#include <string>
+#include <vector>
+
+TEST_SUITE("benchmarks") {
+	using namespace gynjo;
+
+	TEST_CASE("parser nesting scaling" * doctest::skip()) {
+		// Parses pathologically nested inputs at increasing depths. Time per level should stay flat as depth grows.
+		// Depths beyond the default maximum need a stack of at least 16 MiB, which the Windows build reserves. On Linux,
+		// run with ulimit -s 16384 or more.
+		constexpr int max_depth = 10'000;
+		set_max_nesting_depth(max_depth + 1);
+		auto const report = [](char const* shape_name, auto make_input) {
+			fmt::print("{}:\n", shape_name);
+			for (int depth : {1'250, 2'500, 5'000, max_depth}) {
+				auto const tokens = lex(make_input(depth)).value();
+				auto const seconds = bench::seconds_per_call(5, [&] {
+					auto const tree = ast::make();
+					auto const result = parse_expr(*tree, tokens.begin(), tokens.end());
+					REQUIRE(result.has_value());
+				});
+				fmt::print("  depth {:>6}: {:>8.2f} ms, {:>6.2f} us/level\n", depth, seconds * 1e3, seconds / depth * 1e6);
+			}
+		};
+		report("nested parentheses", [](int depth) { return std::string(depth, '(') + "1" + std::string(depth, ')'); });
+		report("nested lists", [](int depth) { return std::string(depth, '[') + "1" + std::string(depth, ']'); });
+		report("nested lambdas", [](int depth) {
+			std::string result;
+			for (int i = 0; i < depth; ++i) {
+				result += "(x, y) -> ";
+			}
+			return result + "x";
+		});
+		report("nested sums", [](int depth) {
+			std::string result;
+			for (int i = 0; i < depth; ++i) {
+				result += "1 + (";
+			}
+			return result + "1" + std::string(depth, ')');
+		});
+		set_max_nesting_depth(default_max_nesting_depth);
+	}
+
+	TEST_CASE("parser throughput" * doctest::skip()) {
+		auto const core = bench::read_file("core/core.gynj");
+		std::string source;
+		while (source.size() < 1'000'000) {
+			source += core + "\n";
+		}
+		auto const tokens = lex(source).value();
+		// Parses every statement in the source into one tree, like a module, keeping the results alive.
+		struct module {
+			ast_ptr tree = ast::make();
+			std::vector<stmt> stmts;
+		};
+		auto const parse_all = [&] {
+			module result;
+			for (auto it = tokens.begin(); it != tokens.end();) {
+				auto stmt_result = parse_stmt(*result.tree, it, tokens.end());
+				REQUIRE(stmt_result.has_value());
+				it = stmt_result.value().it;
+				result.stmts.push_back(stmt_result.value().stmt);
+			}
+			return result;
+		};
+		// Memory includes everything allocated while parsing, counting temporary allocations as well as the AST.
+		auto const bytes_before = test::allocated_bytes();
+		auto const allocations_before = test::allocation_count();
+		auto const parsed = parse_all();
+		auto const bytes = test::allocated_bytes() - bytes_before;
+		auto const allocations = test::allocation_count() - allocations_before;
+		auto const seconds = bench::seconds_per_call(10, parse_all);
+		fmt::print(
+			"parser throughput: {} bytes, {} tokens, {} statements\n", source.size(), tokens.size(), parsed.stmts.size());
+		fmt::print("  {:>8.2f} MB/s, {:>8.1f} bytes allocated per source KB ({:.1f} in the tree), {:>8.1f} allocations "
+				   "per source KB\n",
+			source.size() / seconds / 1e6,
+			1024.0 * bytes / source.size(),
+			1024.0 * parsed.tree->bytes_used() / source.size(),
+			1024.0 * allocations / source.size());
+		fmt::print("  {} nodes, {:.1f} bytes per node\n",
+			parsed.tree->size(),
+			static_cast<double>(parsed.tree->bytes_used()) / parsed.tree->size());
+	}
+
+	TEST_CASE("cluster inference" * doctest::skip()) {
+		// Reports how many of the core library's clusters are resolved at parse time.
+		for (char const* path : {"core/core.gynj", "core/constants.gynj"}) {
+			auto const tokens = lex(bench::read_file(path)).value();
+			auto const tree = ast::make();
+			for (auto it = tokens.begin(); it != tokens.end();) {
+				auto const stmt_result = parse_stmt(*tree, it, tokens.end());
+				REQUIRE(stmt_result.has_value());
+				it = stmt_result.value().it;
+			}
+			auto const stats = resolve_clusters(*tree);
+			fmt::print("{}: {} of {} clusters resolved ({:.1f}%)\n",
+				path,
+				stats.resolved,
+				stats.clusters,
+				stats.clusters == 0 ? 0.0 : 100.0 * stats.resolved / stats.clusters);
+		}
+	}
+
+	TEST_CASE("closure creation" * doctest::skip()) {
+		// Evaluates lambda expressions of increasing size, which creates closures over them.
+		auto const env = environment::make_empty();
+		for (int body_size : {1, 100, 10'000}) {
+			std::string source = "(x, y) -> x";
+			for (int i = 0; i < body_size; ++i) {
+				source += " + y";
+			}
+			auto const tokens = lex(source).value();
+			auto const tree = ast::make();
+			auto const parse_result = parse_expr(*tree, tokens.begin(), tokens.end());
+			REQUIRE(parse_result.has_value());
+			auto const& lambda_expr = parse_result.value().expr;
+			auto const allocations_before = test::allocation_count();
+			REQUIRE(eval(env, lambda_expr).has_value());
+			auto const allocations = test::allocation_count() - allocations_before;
+			auto const seconds = bench::seconds_per_call(100'000, [&] { REQUIRE(eval(env, lambda_expr).has_value()); });
+			fmt::print("closure creation, body of {:>6} operations: {:>8.1f} ns, {} allocations\n",
+				body_size,
+				seconds * 1e9,
+				allocations);
+		}
+	}
+}
@@ -0,0 +1,57 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "bench.hpp"
+
+#include "interpreter.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+TEST_SUITE("benchmarks") {
+	using namespace gynjo;
+
+	TEST_CASE("REPL line latency" * doctest::skip()) {
+		// Replays a recorded REPL session, one line at a time, reporting per-line latency.
+		std::vector<std::string> lines;
+		std::istringstream session{bench::read_file("bench/repl_session.txt")};
+		for (std::string line; std::getline(session, line);) {
+			lines.push_back(line);
+		}
+		constexpr int replays = 20;
+
+		auto const report = [&](char const* approach_name, auto interpret_line) {
+			std::vector<double> latencies;
+			for (int i = 0; i < replays; ++i) {
+				auto env = environment::make_with_core_libs();
+				for (auto const& line : lines) {
+					latencies.push_back(bench::seconds_per_call(1, [&] { interpret_line(env, line); }));
+				}
+			}
+			std::sort(latencies.begin(), latencies.end());
+			double total = 0;
+			for (auto latency : latencies) {
+				total += latency;
+			}
+			fmt::print("{:<16} mean {:>8.1f} us, median {:>8.1f} us, p90 {:>8.1f} us\n",
+				approach_name,
+				total / latencies.size() * 1e6,
+				latencies[latencies.size() / 2] * 1e6,
+				latencies[latencies.size() * 9 / 10] * 1e6);
+		};
+		fmt::print("REPL line latency ({} lines):\n", lines.size());
+		// What the REPL used to do: evaluate, and if that fails for any reason, lex and parse again as statements.
+		report("eval then exec", [](env_ptr const& env, std::string const& line) {
+			if (!eval(env, line).has_value()) { exec(env, line); }
+		});
+		report("interpret", [](env_ptr const& env, std::string const& line) { interpret(env, line); });
+	}
+}
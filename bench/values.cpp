@@ -0,0 +1,80 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "bench.hpp"
+
+#include "interpreter.hpp"
+
+#include "../test/allocations.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <memory>
+#include <string>
+#include <utility>
+
+TEST_SUITE("benchmarks") {
+	using namespace gynjo;
+
+	TEST_CASE("list memory and traversal" * doctest::skip()) {
+		// Each list is built by prepending one element at a time, which frees nothing, so every allocated byte is still
+		// held by the list at the end.
+		constexpr int n = 10'000;
+		using make_element = val::value (*)(int);
+		constexpr std::array elements{
+			std::pair<char const*, make_element>{"integers", [](int i) { return val::value{val::num{i}}; }},
+			std::pair<char const*, make_element>{"non-integers", [](int i) { return val::value{val::num{i} / val::num{7}}; }},
+			std::pair<char const*, make_element>{"short strings", [](int) { return val::value{std::string{"short"}}; }},
+			std::pair<char const*, make_element>{
+				"long strings", [](int) { return val::value{std::string{"a string of 32 characters long.."}}; }},
+			std::pair<char const*, make_element>{
+				"pairs", [](int i) { return val::value{val::make_tup(val::value{val::num{i}}, val::value{val::num{i}})}; }},
+		};
+		fmt::print("list memory and traversal, {} elements:\n", n);
+		fmt::print("  value size: {} bytes\n", sizeof(val::value));
+		fmt::print("  {:<16} {:>14} {:>14}\n", "", "bytes/element", "allocs/element");
+		for (auto const& [name, f] : elements) {
+			auto const bytes_before = test::allocated_bytes();
+			auto const allocations_before = test::allocation_count();
+			val::value list = val::empty{};
+			for (int i = 0; i < n; ++i) {
+				list = val::list{f(i), std::move(list)};
+			}
+			auto const bytes = test::allocated_bytes() - bytes_before;
+			auto const allocations = test::allocation_count() - allocations_before;
+			fmt::print("  {:<16} {:>14.1f} {:>14.2f}\n",
+				name,
+				static_cast<double>(bytes) / n,
+				static_cast<double>(allocations) / n);
+		}
+		// List-heavy workloads, which mostly chase list cells and copy values.
+		constexpr std::array workloads{
+			"len big",
+			"reverse big",
+			"reduce(big, 0, (a, b) -> a + b)",
+			"map(big, x -> x + 1)",
+			"for x in big do let y = x",
+		};
+		auto const env = environment::make_with_core_libs();
+		auto const original = current_engine();
+		fmt::print("  {:<42} {:>10} {:>10}\n", "", "tree (ms)", "VM (ms)");
+		for (auto const workload : workloads) {
+			std::array<double, 2> seconds;
+			for (auto const e : {engine::tree_walker, engine::vm}) {
+				set_engine(e);
+				auto const local_env = std::make_shared<environment>(env);
+				REQUIRE(exec(local_env, "let big = range(1, 10000)").has_value());
+				REQUIRE(interpret(local_env, workload).has_value());
+				seconds[static_cast<std::size_t>(e)] = bench::seconds_per_call(3, [&] { interpret(local_env, workload); });
+			}
+			fmt::print("  {:<42} {:>10.1f} {:>10.1f}\n", workload, seconds[0] * 1e3, seconds[1] * 1e3);
+		}
+		set_engine(original);
+	}
+}
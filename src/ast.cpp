@@ -0,0 +1,334 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "ast.hpp"
+
+#include <algorithm>
+#include <array>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace gynjo {
+	namespace {
+		template <typename T>
+		auto write_pod(std::ostream& out, T const& value) -> void {
+			out.write(reinterpret_cast<char const*>(&value), sizeof(T));
+		}
+
+		template <typename T>
+		auto read_pod(std::istream& in, T& value) -> bool {
+			return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+		}
+
+		//! Writes @p elems, preceded by their count.
+		template <typename T>
+		auto write_array(std::ostream& out, std::vector<T> const& elems) -> void {
+			write_pod(out, static_cast<std::uint32_t>(elems.size()));
+			out.write(reinterpret_cast<char const*>(elems.data()), static_cast<std::streamsize>(elems.size() * sizeof(T)));
+		}
+
+		//! Reads an array written by write_array into @p elems.
+		template <typename T>
+		auto read_array(std::istream& in, std::vector<T>& elems) -> bool {
+			std::uint32_t size;
+			if (!read_pod(in, size)) { return false; }
+			elems.resize(size);
+			return static_cast<bool>(
+				in.read(reinterpret_cast<char*>(elems.data()), static_cast<std::streamsize>(size * sizeof(T))));
+		}
+	}
+
+	auto ast::make() -> ast_ptr {
+		return ast_ptr{new ast};
+	}
+
+	auto ast::add(node_kind kind, std::initializer_list<node_id> children) -> node_id {
+		auto const first = static_cast<std::uint32_t>(_children.size());
+		_children.insert(_children.end(), children);
+		return add_node(kind, first);
+	}
+
+	auto ast::add_list(node_kind kind, std::span<node_id const> children) -> node_id {
+		auto const first = static_cast<std::uint32_t>(_children.size());
+		_children.push_back(static_cast<node_id>(children.size()));
+		_children.insert(_children.end(), children.begin(), children.end());
+		return add_node(kind, first);
+	}
+
+	auto ast::add_cluster(std::span<node_id const> items,
+		std::vector<bool> const& negations,
+		std::span<gynjo::connector const> connectors) -> node_id {
+		auto const first = static_cast<std::uint32_t>(_children.size());
+		_children.push_back(static_cast<node_id>(items.size()));
+		_children.push_back(static_cast<node_id>(_links.size()));
+		_children.insert(_children.end(), items.begin(), items.end());
+		for (std::size_t i = 0; i < items.size(); ++i) {
+			// The first item has no preceding connector.
+			auto const connector = i == 0 ? 0 : static_cast<std::uint8_t>(connectors[i - 1]) << connector_shift;
+			_links.push_back(static_cast<std::uint8_t>(connector | (negations[i] ? negated_bit : 0)));
+		}
+		return add_node(node_kind::cluster, first);
+	}
+
+	auto ast::add_symbol(interned name) -> node_id {
+		auto const symbol = static_cast<std::uint32_t>(_symbols.size());
+		_symbols.push_back(name);
+		return add_node(node_kind::sym, symbol);
+	}
+
+	auto ast::add_literal(node_kind kind, std::string_view text) -> node_id {
+		auto const literal = append_literal(text);
+		if (kind == node_kind::num) { pool_number(literal); }
+		return add_node(kind, literal);
+	}
+
+	auto ast::add_number(std::int64_t value) -> node_id {
+		// An integer's text reads back as the same machine integer in any numeric mode, so read() can reparse it.
+		auto const literal = append_literal(std::to_string(value));
+		_number_slots[literal] = static_cast<std::uint32_t>(_numbers.size());
+		_numbers.push_back(value);
+		return add_node(node_kind::num, literal);
+	}
+
+	auto ast::add_boolean(bool value) -> node_id {
+		return add_node(node_kind::boolean, value ? 1 : 0);
+	}
+
+	auto ast::add_intrinsic(gynjo::intrinsic f) -> node_id {
+		return add_node(node_kind::intrinsic, static_cast<std::uint32_t>(f));
+	}
+
+	auto ast::add_intrinsic_lambda(gynjo::intrinsic f) -> node_id {
+		auto const param = [&](char const* name) { return add_symbol(name); };
+		auto const params = [&] {
+			switch (f) {
+				case intrinsic::top:
+					return add_list(node_kind::tup, std::array{param("list")});
+				case intrinsic::pop:
+					return add_list(node_kind::tup, std::array{param("list")});
+				case intrinsic::push:
+					return add_list(node_kind::tup, std::array{param("list"), param("value")});
+				case intrinsic::print:
+					return add_list(node_kind::tup, std::array{param("value")});
+				case intrinsic::fact:
+					return add_list(node_kind::tup, std::array{param("n")});
+				case intrinsic::nCk:
+					return add_list(node_kind::tup, std::array{param("n"), param("k")});
+				default:
+					// unreachable
+					return add_list(node_kind::tup, {});
+			}
+		}();
+		return add(node_kind::lambda, {params, add_intrinsic(f)});
+	}
+
+	auto ast::add_nop() -> node_id {
+		return add_node(node_kind::nop, 0);
+	}
+
+	auto ast::replace(node_id node, node_id replacement) -> void {
+		// Only the first rewrite's copy is as written.
+		if (!_originals.contains(node)) { _originals.emplace(node, add_node(_kinds[node], _operands[node])); }
+		_kinds[node] = _kinds[replacement];
+		_operands[node] = _operands[replacement];
+	}
+
+	auto ast::bytes_used() const noexcept -> std::size_t {
+		return _kinds.size() * sizeof(node_kind) + _operands.size() * sizeof(std::uint32_t) +
+			_children.size() * sizeof(node_id) + _links.size() * sizeof(std::uint8_t) +
+			_symbols.size() * sizeof(interned) + _text.size() + _literal_offsets.size() * sizeof(std::uint32_t) +
+			_numbers.size() * sizeof(val::num) + _number_slots.size() * sizeof(std::uint32_t) +
+			_originals.size() * 2 * sizeof(node_id);
+	}
+
+	auto ast::write(std::ostream& out) const -> void {
+		write_array(out, _kinds);
+		write_array(out, _operands);
+		write_array(out, _children);
+		write_array(out, _links);
+		// Interned IDs are only meaningful within a process, so symbols are written as text.
+		write_pod(out, static_cast<std::uint32_t>(_symbols.size()));
+		for (auto const symbol : _symbols) {
+			auto const name = symbol.str();
+			write_pod(out, static_cast<std::uint32_t>(name.size()));
+			out.write(name.data(), static_cast<std::streamsize>(name.size()));
+		}
+		write_pod(out, static_cast<std::uint32_t>(_text.size()));
+		out.write(_text.data(), static_cast<std::streamsize>(_text.size()));
+		write_array(out, _literal_offsets);
+		std::vector<node_id> originals;
+		originals.reserve(2 * _originals.size());
+		for (auto const& [node, original] : _originals) {
+			originals.push_back(node);
+			originals.push_back(original);
+		}
+		write_array(out, originals);
+	}
+
+	auto ast::cached_bytecode(node_id node) const -> chunk const* {
+		auto const it = _bytecode.find(node);
+		return it == _bytecode.end() ? nullptr : it->second.get();
+	}
+
+	auto ast::cache_bytecode(node_id node, std::shared_ptr<chunk const> code) const -> chunk const& {
+		return *(_bytecode[node] = std::move(code));
+	}
+
+	auto ast::cached_plan(node_id node) const -> std::shared_ptr<cluster_plan const> {
+		auto const it = _plans.find(node);
+		return it == _plans.end() ? nullptr : it->second;
+	}
+
+	auto ast::cache_plan(node_id node, std::shared_ptr<cluster_plan const> plan) const -> void {
+		_plans[node] = std::move(plan);
+	}
+
+	auto ast::read(std::istream& in) -> ast_ptr {
+		auto result = make();
+		if (!read_array(in, result->_kinds) || !read_array(in, result->_operands) || !read_array(in, result->_children) ||
+			!read_array(in, result->_links)) {
+			return nullptr;
+		}
+		if (result->_kinds.size() != result->_operands.size()) { return nullptr; }
+		std::uint32_t symbol_count;
+		if (!read_pod(in, symbol_count)) { return nullptr; }
+		result->_symbols.reserve(symbol_count);
+		std::string name;
+		for (std::uint32_t i = 0; i < symbol_count; ++i) {
+			std::uint32_t size;
+			if (!read_pod(in, size)) { return nullptr; }
+			name.resize(size);
+			if (!in.read(name.data(), size)) { return nullptr; }
+			result->_symbols.emplace_back(name);
+		}
+		std::uint32_t text_size;
+		if (!read_pod(in, text_size)) { return nullptr; }
+		result->_text.resize(text_size);
+		if (!in.read(result->_text.data(), text_size) || !read_array(in, result->_literal_offsets)) { return nullptr; }
+		// Each literal must be a null-terminated span of the text, in order.
+		auto const& offsets = result->_literal_offsets;
+		if (offsets.empty() || offsets.front() != 0 || offsets.back() != text_size) { return nullptr; }
+		for (std::size_t i = 1; i < offsets.size(); ++i) {
+			if (offsets[i] <= offsets[i - 1] || result->_text[offsets[i] - 1] != '\0') { return nullptr; }
+		}
+		std::vector<node_id> originals;
+		if (!read_array(in, originals) || originals.size() % 2 != 0) { return nullptr; }
+		for (std::size_t i = 0; i < originals.size(); i += 2) {
+			if (originals[i] >= result->_kinds.size() || originals[i + 1] >= result->_kinds.size()) { return nullptr; }
+			result->_originals.emplace(originals[i], originals[i + 1]);
+		}
+		auto const literal_count = offsets.size() - 1;
+		result->_number_slots.resize(literal_count);
+		auto const node_count = result->_kinds.size();
+		auto const& children = result->_children;
+		// Whether the @p count children starting at @p first are all nodes.
+		auto const valid_children = [&](std::size_t first, std::size_t count) {
+			if (first > children.size() || count > children.size() - first) { return false; }
+			return std::all_of(children.begin() + first, children.begin() + first + count, [&](node_id child) {
+				return child < node_count;
+			});
+		};
+		for (node_id node = 0; node < node_count; ++node) {
+			auto const operand = result->_operands[node];
+			switch (result->_kinds[node]) {
+				case node_kind::not_:
+				case node_kind::neg:
+				case node_kind::ret:
+				case node_kind::expr_stmt:
+					if (!valid_children(operand, 1)) { return nullptr; }
+					break;
+				case node_kind::and_:
+				case node_kind::or_:
+				case node_kind::eq:
+				case node_kind::neq:
+				case node_kind::approx:
+				case node_kind::lt:
+				case node_kind::leq:
+				case node_kind::gt:
+				case node_kind::geq:
+				case node_kind::add:
+				case node_kind::sub:
+				case node_kind::pow:
+				case node_kind::mul:
+				case node_kind::div:
+				case node_kind::sqrt:
+				case node_kind::int_pow:
+				case node_kind::lambda:
+				case node_kind::assign:
+				case node_kind::while_loop:
+					if (!valid_children(operand, 2)) { return nullptr; }
+					break;
+				case node_kind::cond:
+				case node_kind::branch:
+				case node_kind::for_loop:
+					if (!valid_children(operand, 3)) { return nullptr; }
+					break;
+				case node_kind::block:
+				case node_kind::tup:
+				case node_kind::list:
+					if (operand >= children.size() || !valid_children(operand + std::size_t{1}, children[operand])) {
+						return nullptr;
+					}
+					break;
+				case node_kind::cluster: {
+					if (operand > children.size() || children.size() - operand < 2) { return nullptr; }
+					auto const item_count = children[operand];
+					auto const first_link = children[operand + 1];
+					if (item_count == 0 || !valid_children(operand + std::size_t{2}, item_count)) { return nullptr; }
+					auto const& links = result->_links;
+					if (first_link > links.size() || item_count > links.size() - first_link) { return nullptr; }
+					for (std::size_t i = 1; i < item_count; ++i) {
+						if ((links[first_link + i] >> connector_shift) > static_cast<std::uint8_t>(connector::exp)) {
+							return nullptr;
+						}
+					}
+					break;
+				}
+				case node_kind::intrinsic:
+					if (operand >= intrinsic_count) { return nullptr; }
+					break;
+				case node_kind::boolean:
+					if (operand > 1) { return nullptr; }
+					break;
+				case node_kind::nop:
+					break;
+				case node_kind::sym:
+					if (operand >= symbol_count) { return nullptr; }
+					break;
+				case node_kind::num:
+					if (operand >= literal_count) { return nullptr; }
+					result->pool_number(operand);
+					break;
+				case node_kind::str:
+				case node_kind::imp:
+					if (operand >= literal_count) { return nullptr; }
+					break;
+				default:
+					// Not a node kind.
+					return nullptr;
+			}
+		}
+		return result;
+	}
+
+	auto ast::add_node(node_kind kind, std::uint32_t operand) -> node_id {
+		_kinds.push_back(kind);
+		_operands.push_back(operand);
+		return static_cast<node_id>(_kinds.size() - 1);
+	}
+
+	auto ast::append_literal(std::string_view text) -> std::uint32_t {
+		auto const literal = static_cast<std::uint32_t>(_literal_offsets.size() - 1);
+		_text += text;
+		_text += '\0';
+		_literal_offsets.push_back(static_cast<std::uint32_t>(_text.size()));
+		_number_slots.push_back(0);
+		return literal;
+	}
+
+	auto ast::pool_number(std::uint32_t literal) -> void {
+		_number_slots[literal] = static_cast<std::uint32_t>(_numbers.size());
+		_numbers.emplace_back(_text.data() + _literal_offsets[literal]);
+	}
+}
@@ -0,0 +1,266 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Flat, index-based storage for syntax trees.
+
+#pragma once
+
+#include "interned.hpp"
+#include "intrinsics.hpp"
+#include "num.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <iosfwd>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace gynjo {
+	struct chunk;
+	struct cluster_plan;
+
+	//! The index of a node in an ast.
+	using node_id = std::uint32_t;
+
+	//! The kinds of syntax tree nodes. The comments give each kind's operand, as stored in ast.
+	enum class node_kind : std::uint8_t {
+		// Expressions
+		cond, // Children: test, true case, false case
+		block, // Child list: statements
+		and_, // Children: left, right
+		or_, // Children: left, right
+		not_, // Children: operand
+		eq, // Children: left, right
+		neq, // Children: left, right
+		approx, // Children: left, right
+		lt, // Children: left, right
+		leq, // Children: left, right
+		gt, // Children: left, right
+		geq, // Children: left, right
+		add, // Children: addend, addend
+		sub, // Children: minuend, subtrahend
+		neg, // Children: operand
+		pow, // Children: base, exponent
+		mul, // Children: factor, factor
+		div, // Children: dividend, divisor
+		sqrt, // Children: radicand, exponent (1/2): exponentiation computed as a square root
+		int_pow, // Children: base, exponent (a small positive integer): exponentiation by repeated multiplication
+		cluster, // Cluster: items, with their negations and connectors
+		lambda, // Children: parameter tuple, body (any expression or an intrinsic)
+		intrinsic, // The intrinsic function
+		tup, // Child list: elements
+		list, // Child list: elements in reverse order, so that prepending each one in turn builds the list
+		boolean, // 1 if true, 0 if false
+		num, // Literal: the number's text, whose value is also in the number pool
+		str, // Literal: the string's contents
+		sym, // Symbol: the symbol's name
+		// Statements
+		nop, // None
+		imp, // Literal: the filename
+		assign, // Children: symbol, right-hand side
+		branch, // Children: test, true case, false case (nop if absent)
+		while_loop, // Children: test, body
+		for_loop, // Children: loop variable symbol, range, body
+		ret, // Children: result
+		expr_stmt, // Children: expression
+	};
+
+	//! The way in which a cluster item is attached to the preceding items of the cluster.
+	enum class connector : std::uint8_t {
+		adj_paren, // Adjacent value enclosed in parentheses
+		adj_nonparen, // Adjacent value not enclosed in parentheses
+		mul, // Explicit multiplication
+		div, // Explicit division
+		exp, // Explicit exponentiation
+	};
+
+	//! Syntax trees for a unit of parsed code, stored as a structure of arrays. Each node is a kind plus a 32-bit
+	//! operand, whose meaning depends on the kind (see node_kind). Nodes with children point into a shared array of
+	//! child IDs, where each node's children are contiguous. Symbol names and literal text live in side tables. Nodes
+	//! are only ever appended, and everything is freed at once when the last closure over the code goes away.
+	struct ast : std::enable_shared_from_this<ast> {
+		//! Creates an empty tree. Trees are always shared so that closures can keep their code alive.
+		static auto make() -> std::shared_ptr<ast>;
+
+		ast(ast const&) = delete;
+		auto operator=(ast const&) -> ast& = delete;
+
+		auto kind(node_id node) const noexcept -> node_kind {
+			return _kinds[node];
+		}
+
+		//! Child @p i of a node with a fixed number of children.
+		auto child(node_id node, std::size_t i) const noexcept -> node_id {
+			return _children[_operands[node] + i];
+		}
+
+		//! The children of a node with a child list.
+		auto child_list(node_id node) const noexcept -> std::span<node_id const> {
+			auto const first = _operands[node];
+			return {_children.data() + first + 1, _children[first]};
+		}
+
+		//! The items of a cluster.
+		auto cluster_items(node_id node) const noexcept -> std::span<node_id const> {
+			auto const first = _operands[node];
+			return {_children.data() + first + 2, _children[first]};
+		}
+
+		//! Whether item @p i of a cluster is negated.
+		auto negated(node_id cluster, std::size_t i) const noexcept -> bool {
+			return (_links[_children[_operands[cluster] + 1] + i] & negated_bit) != 0;
+		}
+
+		//! How item @p i + 1 of a cluster is connected to item @p i.
+		auto connector(node_id cluster, std::size_t i) const noexcept -> gynjo::connector {
+			return static_cast<gynjo::connector>(_links[_children[_operands[cluster] + 1] + i + 1] >> connector_shift);
+		}
+
+		//! The name of a symbol.
+		auto symbol(node_id node) const noexcept -> interned {
+			return _symbols[_operands[node]];
+		}
+
+		//! The text of a number, string, or import literal.
+		auto literal(node_id node) const noexcept -> std::string_view {
+			auto const literal = _operands[node];
+			// Each literal is followed by a null terminator.
+			return {_text.data() + _literal_offsets[literal], _literal_offsets[literal + 1] - _literal_offsets[literal] - 1};
+		}
+
+		//! The value of a number literal, which was parsed once when the literal was added.
+		auto number(node_id node) const noexcept -> val::num const& {
+			return _numbers[_number_slots[_operands[node]]];
+		}
+
+		//! The value of a boolean literal.
+		auto boolean(node_id node) const noexcept -> bool {
+			return _operands[node] != 0;
+		}
+
+		//! The function of an intrinsic node.
+		auto intrinsic(node_id node) const noexcept -> gynjo::intrinsic {
+			return static_cast<gynjo::intrinsic>(_operands[node]);
+		}
+
+		//! Adds a node with the fixed @p children.
+		auto add(node_kind kind, std::initializer_list<node_id> children) -> node_id;
+
+		//! Adds a node with the child list @p children.
+		auto add_list(node_kind kind, std::span<node_id const> children) -> node_id;
+
+		//! Adds a cluster. @p connectors[i] connects @p items[i + 1] to @p items[i].
+		auto add_cluster(std::span<node_id const> items,
+			std::vector<bool> const& negations,
+			std::span<gynjo::connector const> connectors) -> node_id;
+
+		//! Adds a symbol named @p name.
+		auto add_symbol(interned name) -> node_id;
+
+		//! Adds a number, string, or import literal of kind @p kind with text @p text, which is copied into this tree. A
+		//! number literal's value is added to the number pool.
+		auto add_literal(node_kind kind, std::string_view text) -> node_id;
+
+		//! Adds a number literal with the machine integer @p value, such as the result of folding constants.
+		auto add_number(std::int64_t value) -> node_id;
+
+		//! Adds a boolean literal.
+		auto add_boolean(bool value) -> node_id;
+
+		//! Adds an intrinsic function body.
+		auto add_intrinsic(gynjo::intrinsic f) -> node_id;
+
+		//! Adds a lambda that takes @p f's parameters and applies @p f to them.
+		auto add_intrinsic_lambda(gynjo::intrinsic f) -> node_id;
+
+		//! Adds a node with no operand.
+		auto add_nop() -> node_id;
+
+		//! Rewrites @p node in place to be a copy of @p replacement, which shares its children. The node as written is
+		//! kept for display; see original().
+		auto replace(node_id node, node_id replacement) -> void;
+
+		//! @p node as it was written, before any replace(), or @p node itself if it hasn't been rewritten.
+		auto original(node_id node) const -> node_id {
+			auto const it = _originals.find(node);
+			return it == _originals.end() ? node : it->second;
+		}
+
+		//! The number of nodes in this tree.
+		auto size() const noexcept -> std::size_t {
+			return _kinds.size();
+		}
+
+		//! The number of bytes of storage this tree uses.
+		auto bytes_used() const noexcept -> std::size_t;
+
+		//! Writes this tree to @p out in a binary format that read() accepts.
+		//! @note The format uses native byte order and is only meant for caching on the same machine.
+		auto write(std::ostream& out) const -> void;
+
+		//! The bytecode compiled from the lambda @p node, if it's been cached.
+		auto cached_bytecode(node_id node) const -> chunk const*;
+
+		//! Caches @p code as the bytecode compiled from the lambda @p node.
+		auto cache_bytecode(node_id node, std::shared_ptr<chunk const> code) const -> chunk const&;
+
+		//! The plan most recently recorded for evaluating the cluster @p node, or null if there is none.
+		auto cached_plan(node_id node) const -> std::shared_ptr<cluster_plan const>;
+
+		//! Caches @p plan for evaluating the cluster @p node, replacing any previous plan.
+		auto cache_plan(node_id node, std::shared_ptr<cluster_plan const> plan) const -> void;
+
+		//! Reads a tree written by write() from @p in.
+		//! @return The tree, or null if @p in doesn't contain a well-formed tree.
+		static auto read(std::istream& in) -> std::shared_ptr<ast>;
+
+	private:
+		static constexpr std::uint8_t negated_bit = 1;
+		static constexpr int connector_shift = 1;
+
+		//! Node kinds, indexed by node ID.
+		std::vector<node_kind> _kinds;
+		//! Node operands, indexed by node ID.
+		std::vector<std::uint32_t> _operands;
+		//! Child lists. Each is preceded by its size, if variable, and a cluster's also by the offset of its links.
+		std::vector<node_id> _children;
+		//! Each cluster item's negation flag and connector to the preceding item.
+		std::vector<std::uint8_t> _links;
+		//! Symbol names, which are interned since they're compared and looked up, while there are only as many of them
+		//! as a program has names.
+		std::vector<interned> _symbols;
+		//! The text of each literal, followed by a null terminator. Literals aren't interned, so a tree with many distinct
+		//! literals doesn't leave them behind in the intern table once it's freed.
+		std::string _text;
+		//! The offset of each literal in the text, by literal index, followed by the size of the text.
+		std::vector<std::uint32_t> _literal_offsets{0};
+		//! The values of number literals, so that evaluating a literal doesn't parse its text each time.
+		std::vector<val::num> _numbers;
+		//! Each literal's index in the number pool, if it's a number, by literal index. The pool isn't written out, so
+		//! read() rebuilds it.
+		std::vector<std::uint32_t> _number_slots;
+		//! A copy of each rewritten node as it was written, by rewritten node, so code prints the way the user wrote it.
+		std::unordered_map<node_id, node_id> _originals;
+		//! Bytecode compiled from function bodies, by lambda node. This is derived from the tree and filled in as functions
+		//! are first called, even on const trees.
+		mutable std::unordered_map<node_id, std::shared_ptr<chunk const>> _bytecode;
+		//! Plans for evaluating clusters, by cluster node. Like the bytecode, these are derived and filled in lazily.
+		mutable std::unordered_map<node_id, std::shared_ptr<cluster_plan const>> _plans;
+
+		ast() = default;
+
+		auto add_node(node_kind kind, std::uint32_t operand) -> node_id;
+
+		//! Appends @p text to the literal text.
+		//! @return The index of the new literal.
+		auto append_literal(std::string_view text) -> std::uint32_t;
+
+		//! Adds the value of literal @p literal to the number pool.
+		auto pool_number(std::uint32_t literal) -> void;
+	};
+
+	using ast_ptr = std::shared_ptr<ast>;
+}
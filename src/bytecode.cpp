@@ -0,0 +1,427 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "bytecode.hpp"
+
+#include <algorithm>
+#include <optional>
+
+namespace gynjo {
+	namespace {
+		auto prefix_text(error_context prefix) -> char const* {
+			switch (prefix) {
+				case error_context::block_stmt:
+					return "in block statement: ";
+				case error_context::assign_rhs:
+					return "in RHS of assignment: ";
+				case error_context::branch_test:
+					return "in branch test expression: ";
+				case error_context::while_test:
+					return "in while-loop test expression: ";
+				case error_context::for_body:
+					return "in body of for-loop: ";
+				default:
+					// unreachable
+					return "";
+			}
+		}
+
+		//! Calls @p f on the name of each variable that @p node assigns, including by looping over it, without descending
+		//! into nested functions.
+		template <typename F>
+		auto for_each_assigned(ast const& tree, node_id node, F const& f) -> void {
+			switch (tree.kind(node)) {
+				case node_kind::block:
+				case node_kind::tup:
+				case node_kind::list:
+					for (node_id const child : tree.child_list(node)) {
+						for_each_assigned(tree, child, f);
+					}
+					break;
+				case node_kind::cluster:
+					for (node_id const item : tree.cluster_items(node)) {
+						for_each_assigned(tree, item, f);
+					}
+					break;
+				case node_kind::cond:
+				case node_kind::branch:
+					for_each_assigned(tree, tree.child(node, 2), f);
+					[[fallthrough]];
+				case node_kind::and_:
+				case node_kind::or_:
+				case node_kind::eq:
+				case node_kind::neq:
+				case node_kind::approx:
+				case node_kind::lt:
+				case node_kind::leq:
+				case node_kind::gt:
+				case node_kind::geq:
+				case node_kind::add:
+				case node_kind::sub:
+				case node_kind::pow:
+				case node_kind::mul:
+				case node_kind::div:
+				case node_kind::sqrt:
+				case node_kind::int_pow:
+				case node_kind::while_loop:
+					for_each_assigned(tree, tree.child(node, 1), f);
+					[[fallthrough]];
+				case node_kind::not_:
+				case node_kind::neg:
+				case node_kind::ret:
+				case node_kind::expr_stmt:
+					for_each_assigned(tree, tree.child(node, 0), f);
+					break;
+				case node_kind::assign:
+					f(tree.symbol(tree.child(node, 0)));
+					for_each_assigned(tree, tree.child(node, 1), f);
+					break;
+				case node_kind::for_loop:
+					f(tree.symbol(tree.child(node, 0)));
+					for_each_assigned(tree, tree.child(node, 1), f);
+					for_each_assigned(tree, tree.child(node, 2), f);
+					break;
+				default:
+					// Leaves and nested functions assign nothing in this function.
+					break;
+			}
+		}
+
+		//! The local variables of a function being compiled, and of the functions it's nested in.
+		struct scope {
+			std::vector<interned> const* slot_names;
+			scope const* parent;
+		};
+
+		//! The number of environments between a function's frame and the frame of the function it's nested in: a closure
+		//! has its own environment, whose parent is the environment that created it.
+		constexpr std::uint32_t frame_distance = 2;
+
+		//! Compiles syntax trees into a chunk.
+		struct compiler {
+			chunk result;
+			//! The innermost error context of the code being compiled.
+			std::uint32_t context = chunk::no_context;
+			//! The local variables in scope, or null at the top level, where variables are looked up by name.
+			scope const* locals = nullptr;
+
+			explicit compiler(ast const& tree) : result{&tree, {}, {}, {}, {}, {}, {}, {}} {}
+
+			//! The index of the next instruction.
+			auto here() const -> std::uint32_t {
+				return static_cast<std::uint32_t>(result.code.size());
+			}
+
+			//! Appends an instruction and returns its index.
+			auto emit(opcode op, std::uint32_t arg = 0) -> std::uint32_t {
+				result.code.push_back({op, arg});
+				result.instr_contexts.push_back(context);
+				return here() - 1;
+			}
+
+			//! Sets the target of the jump at @p jump to the next instruction.
+			auto patch(std::uint32_t jump) -> void {
+				result.code[jump].arg = here();
+			}
+
+			auto push_const(val::value value) -> void {
+				result.constants.push_back(std::move(value));
+				emit(opcode::push_const, static_cast<std::uint32_t>(result.constants.size() - 1));
+			}
+
+			//! If the symbol @p sym names a local variable of an enclosing function, adds a reference to it.
+			//! @return The index of the slot reference, or nullopt if @p sym should be looked up by name.
+			auto resolve(node_id sym) -> std::optional<std::uint32_t> {
+				auto const name = result.tree->symbol(sym);
+				std::uint32_t depth = 0;
+				for (auto s = locals; s != nullptr; s = s->parent, depth += frame_distance) {
+					auto const it = std::find(s->slot_names->begin(), s->slot_names->end(), name);
+					if (it != s->slot_names->end()) {
+						auto const slot = static_cast<std::uint32_t>(it - s->slot_names->begin());
+						result.slot_refs.push_back({name, depth, slot});
+						return static_cast<std::uint32_t>(result.slot_refs.size() - 1);
+					}
+				}
+				// Not a local variable of any enclosing function.
+				return std::nullopt;
+			}
+
+			//! Emits code that pushes the value of the symbol @p sym.
+			auto load(node_id sym) -> void {
+				if (auto const ref = resolve(sym)) {
+					emit(opcode::load_slot, *ref);
+				} else {
+					emit(opcode::load, sym);
+				}
+			}
+
+			//! Emits code that applies the binary operator @p op to the popped left operand and the value of its right
+			//! operand, which is a symbol, and pushes the result.
+			auto binary_load(node_id op) -> void {
+				auto const ref = resolve(result.tree->child(op, 1));
+				if (ref.has_value() && *ref < (1u << binary_slot_bits)) {
+					emit(opcode::binary_load_slot,
+						static_cast<std::uint32_t>(result.tree->kind(op)) << binary_slot_bits | *ref);
+				} else {
+					emit(opcode::binary_load, op);
+				}
+			}
+
+			//! Emits code that pops a value and assigns it to the symbol @p sym.
+			auto store(node_id sym) -> void {
+				if (locals == nullptr) {
+					emit(opcode::store, sym);
+				} else {
+					// Every variable a function assigns is one of its locals.
+					auto const& names = *locals->slot_names;
+					auto const it = std::find(names.begin(), names.end(), result.tree->symbol(sym));
+					emit(opcode::store_slot, static_cast<std::uint32_t>(it - names.begin()));
+				}
+			}
+
+			//! Calls @p f to compile code within the error context @p prefix.
+			template <typename F>
+			auto in_context(error_context prefix, F&& f) -> void {
+				auto const parent = context;
+				result.contexts.push_back({prefix, parent});
+				context = static_cast<std::uint32_t>(result.contexts.size() - 1);
+				std::forward<F>(f)();
+				context = parent;
+			}
+
+			//! Compiles code that pushes the value of @p e.
+			//! @param tail Whether @p e is in tail position in a function body, so its value is the function's result.
+			auto compile_expr(expr const& e, bool tail = false) -> void {
+				auto const& tree = *e.tree;
+				auto const node = e.node;
+				switch (e.kind()) {
+					case node_kind::cond: {
+						compile_expr(e.child(0));
+						auto const to_false = emit(opcode::jump_unless);
+						compile_expr(e.child(1), tail);
+						auto const to_end = emit(opcode::jump);
+						patch(to_false);
+						compile_expr(e.child(2), tail);
+						patch(to_end);
+						break;
+					}
+					case node_kind::block:
+						for (node_id const child : tree.child_list(node)) {
+							stmt const s{&tree, child};
+							// A return statement exits the block early and produces a value.
+							if (s.kind() == node_kind::ret) {
+								compile_expr(s.expr_child(0), tail);
+								return;
+							}
+							in_context(error_context::block_stmt, [&] { compile_stmt(s); });
+						}
+						// Produce nothing if there was no return statement.
+						push_const(val::make_tup());
+						break;
+					case node_kind::and_: {
+						compile_expr(e.child(0));
+						auto const short_circuit = emit(opcode::and_left);
+						compile_expr(e.child(1));
+						emit(opcode::and_right);
+						patch(short_circuit);
+						break;
+					}
+					case node_kind::or_: {
+						compile_expr(e.child(0));
+						auto const short_circuit = emit(opcode::or_left);
+						compile_expr(e.child(1));
+						emit(opcode::or_right);
+						patch(short_circuit);
+						break;
+					}
+					case node_kind::not_:
+						compile_expr(e.child(0));
+						emit(opcode::not_);
+						break;
+					case node_kind::neg:
+						compile_expr(e.child(0));
+						emit(opcode::neg);
+						break;
+					case node_kind::eq:
+					case node_kind::neq:
+					case node_kind::approx:
+					case node_kind::lt:
+					case node_kind::leq:
+					case node_kind::gt:
+					case node_kind::geq:
+					case node_kind::add:
+					case node_kind::sub:
+					case node_kind::pow:
+					case node_kind::mul:
+					case node_kind::div:
+					case node_kind::sqrt:
+					case node_kind::int_pow:
+						compile_expr(e.child(0));
+						// A variable operand is read in place rather than pushed.
+						if (e.child(1).kind() == node_kind::sym) {
+							binary_load(node);
+						} else {
+							compile_expr(e.child(1));
+							emit(opcode::binary, static_cast<std::uint32_t>(e.kind()));
+						}
+						break;
+					case node_kind::cluster:
+						for (node_id const item : tree.cluster_items(node)) {
+							compile_expr(expr{&tree, item});
+						}
+						emit(tail ? opcode::tail_cluster : opcode::cluster, node);
+						break;
+					case node_kind::lambda:
+						// A nested function's body can only be compiled along with the enclosing function's, since its
+						// references to the enclosing function's variables are resolved now.
+						if (locals != nullptr && e.child(1).kind() != node_kind::intrinsic &&
+							tree.cached_bytecode(node) == nullptr) {
+							tree.cache_bytecode(node, std::make_shared<chunk const>(compile_function(e, locals)));
+						}
+						emit(opcode::make_closure, node);
+						break;
+					case node_kind::tup:
+						for (node_id const elem : tree.child_list(node)) {
+							compile_expr(expr{&tree, elem});
+						}
+						emit(opcode::make_tup, static_cast<std::uint32_t>(tree.child_list(node).size()));
+						break;
+					case node_kind::list:
+						for (node_id const elem : tree.child_list(node)) {
+							compile_expr(expr{&tree, elem});
+						}
+						emit(opcode::make_list, static_cast<std::uint32_t>(tree.child_list(node).size()));
+						break;
+					case node_kind::boolean:
+						push_const(tok::boolean{tree.boolean(node)});
+						break;
+					case node_kind::num:
+						push_const(tree.number(node));
+						break;
+					case node_kind::str:
+						push_const(std::string{tree.literal(node)});
+						break;
+					case node_kind::sym:
+						load(node);
+						break;
+					default:
+						emit(opcode::eval_stmt, node);
+						break;
+				}
+			}
+
+			//! Compiles code that executes @p s, leaving the stack as it was.
+			auto compile_stmt(stmt const& s) -> void {
+				auto const& tree = *s.tree;
+				auto const node = s.node;
+				switch (s.kind()) {
+					case node_kind::nop:
+						break;
+					case node_kind::imp:
+						emit(opcode::import, node);
+						break;
+					case node_kind::assign:
+						in_context(error_context::assign_rhs, [&] { compile_expr(s.expr_child(1)); });
+						store(tree.child(node, 0));
+						break;
+					case node_kind::branch: {
+						in_context(error_context::branch_test, [&] { compile_expr(s.expr_child(0)); });
+						auto const to_false = emit(opcode::jump_unless);
+						compile_stmt(s.stmt_child(1));
+						auto const to_end = emit(opcode::jump);
+						patch(to_false);
+						compile_stmt(s.stmt_child(2));
+						patch(to_end);
+						break;
+					}
+					case node_kind::while_loop: {
+						auto const top = here();
+						in_context(error_context::while_test, [&] { compile_expr(s.expr_child(0)); });
+						auto const to_end = emit(opcode::jump_unless_while);
+						compile_stmt(s.stmt_child(1));
+						emit(opcode::jump, top);
+						patch(to_end);
+						break;
+					}
+					case node_kind::for_loop: {
+						compile_expr(s.expr_child(1));
+						auto const skip = emit(opcode::for_begin);
+						auto const top = here();
+						auto const to_end = emit(opcode::for_next);
+						store(tree.child(node, 0));
+						in_context(error_context::for_body, [&] { compile_stmt(s.stmt_child(2)); });
+						emit(opcode::jump, top);
+						patch(skip);
+						patch(to_end);
+						break;
+					}
+					case node_kind::ret:
+						emit(opcode::ret_outside_block);
+						break;
+					case node_kind::expr_stmt:
+						compile_expr(s.expr_child(0));
+						emit(opcode::discard_unit);
+						break;
+					default:
+						// The parser never puts expressions in statement position.
+						compile_expr(expr{s.tree, s.node});
+						emit(opcode::discard_unit);
+						break;
+				}
+			}
+
+			//! Compiles the body of @p lambda, nested in functions with the local variables @p enclosing.
+			static auto compile_function(expr const& lambda, scope const* enclosing) -> chunk {
+				auto const& tree = *lambda.tree;
+				compiler c{tree};
+				auto& names = c.result.slot_names;
+				auto const add_local = [&](interned name) {
+					auto const it = std::find(names.begin(), names.end(), name);
+					if (it != names.end()) { return static_cast<std::uint32_t>(it - names.begin()); }
+					names.push_back(name);
+					return static_cast<std::uint32_t>(names.size() - 1);
+				};
+				// Parameters come first, followed by the variables the body assigns.
+				for (node_id const param : tree.child_list(lambda.child(0).node)) {
+					c.result.param_slots.push_back(add_local(tree.symbol(param)));
+				}
+				for_each_assigned(tree, lambda.child(1).node, add_local);
+				scope const local{&names, enclosing};
+				c.locals = &local;
+				c.compile_expr(lambda.child(1), true);
+				c.emit(opcode::end);
+				return std::move(c.result);
+			}
+		};
+	}
+
+	auto chunk::in_context(std::size_t pc, std::string message) const -> std::string {
+		for (auto i = instr_contexts[pc]; i != no_context; i = contexts[i].parent) {
+			message = prefix_text(contexts[i].prefix) + message;
+		}
+		return message;
+	}
+
+	auto compile(expr const& expr) -> chunk {
+		compiler c{*expr.tree};
+		c.compile_expr(expr);
+		c.emit(opcode::end);
+		return std::move(c.result);
+	}
+
+	auto compile(stmt const& stmt) -> chunk {
+		compiler c{*stmt.tree};
+		c.compile_stmt(stmt);
+		c.push_const(val::make_tup());
+		c.emit(opcode::end);
+		return std::move(c.result);
+	}
+
+	auto bytecode(expr const& lambda) -> chunk const& {
+		if (auto const cached = lambda.tree->cached_bytecode(lambda.node)) { return *cached; }
+		// Nested functions are normally compiled along with their enclosing functions. Any others have no enclosing
+		// locals to resolve, since their free variables are looked up by name.
+		return lambda.tree->cache_bytecode(
+			lambda.node, std::make_shared<chunk const>(compiler::compile_function(lambda, nullptr)));
+	}
+}
@@ -0,0 +1,117 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Bytecode for the virtual machine, and compilation of syntax trees to bytecode.
+
+#pragma once
+
+#include "ast.hpp"
+#include "expr.hpp"
+#include "stmt.hpp"
+#include "values.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gynjo {
+	//! Virtual machine operations. The comments give each operation's argument and its effect on the value stack.
+	//! @note The VM's dispatch table lists these in order.
+	enum class opcode : std::uint8_t {
+		push_const, // Constant index. Pushes the constant.
+		load, // Symbol node. Pushes the value of the symbol, looked up by name.
+		load_slot, // Slot reference index. Pushes the value of a local variable of this or an enclosing function.
+		store, // Symbol node. Pops a value and assigns it to the symbol, by name.
+		store_slot, // Slot. Pops a value and assigns it to a local variable of this function.
+		make_closure, // Lambda node. Pushes a closure over the current environment.
+		make_tup, // Element count. Pops the elements and pushes a tuple of them.
+		make_list, // Element count. Pops the elements, in reverse order, and pushes a list of them.
+		cluster, // Cluster node. Pops the cluster's item values and pushes the value of the cluster.
+		tail_cluster, // Cluster node. Like cluster, but in tail position: if the cluster's last operation is a call to
+					  // a function with a Gynjo body, replaces the current call with it.
+		not_, // None. Replaces a boolean with its negation.
+		neg, // None. Replaces a number with its negation.
+		binary, // Operator node kind. Pops the right and left operands and pushes the result.
+		binary_load, // Operator node, whose right operand is a symbol. Pops the left operand and pushes the result,
+					 // reading the value of the symbol in place rather than copying it onto the stack.
+		binary_load_slot, // Operator node kind in the top 8 bits and slot reference index in the rest. Like
+						  // binary_load, but the right operand is a local variable, found like load_slot finds it.
+		and_left, // Jump target. Checks the left operand of "and". If false, jumps, leaving it; otherwise, pops it.
+		and_right, // None. Checks that the right operand of "and" is a boolean, leaving it.
+		or_left, // Jump target. Checks the left operand of "or". If true, jumps, leaving it; otherwise, pops it.
+		or_right, // None. Checks that the right operand of "or" is a boolean, leaving it.
+		jump, // Jump target. Jumps unconditionally.
+		jump_unless, // Jump target. Pops a conditional test and jumps if it's false.
+		jump_unless_while, // Jump target. Pops a while-loop test and jumps if it's false.
+		for_begin, // Jump target. Checks the for-loop range on top of the stack. If empty, pops it and jumps.
+		for_next, // Jump target. If the remaining range on top of the stack is a list, replaces it with its tail and
+				  // pushes its head. Otherwise, pops it and jumps.
+		discard_unit, // None. Pops the result of an expression statement, which must be the empty tuple.
+		import, // Import node. Executes the imported file.
+		ret_outside_block, // None. Fails, since return statements are only allowed in blocks.
+		eval_stmt, // Statement node. Fails, since statements can't be evaluated.
+		end, // None. Returns the value on top of the stack.
+	};
+
+	//! The number of bits of a binary_load_slot argument that hold the slot reference index.
+	constexpr unsigned binary_slot_bits = 24;
+
+	//! A virtual machine instruction.
+	struct instr {
+		opcode op;
+		std::uint32_t arg;
+	};
+
+	//! Error message prefixes, which say where in a statement an error occurred.
+	enum class error_context : std::uint8_t { block_stmt, assign_rhs, branch_test, while_test, for_body };
+
+	//! A reference to a local variable of a function, from code in that function or in a function nested within it.
+	struct slot_ref {
+		//! The variable's name.
+		interned name;
+		//! The number of environments between the referring code's environment and the variable's frame.
+		std::uint32_t depth;
+		//! The variable's slot in its frame.
+		std::uint32_t slot;
+	};
+
+	//! Bytecode compiled from an expression or statement.
+	struct chunk {
+		//! A nested error context.
+		struct context {
+			error_context prefix;
+			//! The enclosing context, or no_context.
+			std::uint32_t parent;
+		};
+
+		//! Marks an instruction or context that isn't inside any context.
+		static constexpr std::uint32_t no_context = UINT32_MAX;
+
+		//! The tree that node arguments refer to.
+		ast const* tree;
+		std::vector<instr> code;
+		std::vector<val::value> constants;
+		//! The innermost error context of each instruction, by instruction index.
+		std::vector<std::uint32_t> instr_contexts;
+		std::vector<context> contexts;
+		//! For a function body, the names of the function's local variables, by slot. These are its parameters and the
+		//! variables its body assigns.
+		std::vector<interned> slot_names;
+		//! For a function body, the slot of each parameter.
+		std::vector<std::uint32_t> param_slots;
+		//! The local variables that load_slot instructions refer to.
+		std::vector<slot_ref> slot_refs;
+
+		//! Adds the prefixes of the error contexts of the instruction at @p pc to @p message.
+		auto in_context(std::size_t pc, std::string message) const -> std::string;
+	};
+
+	//! Compiles @p expr to bytecode that evaluates it.
+	auto compile(expr const& expr) -> chunk;
+
+	//! Compiles @p stmt to bytecode that executes it and then pushes the empty tuple.
+	auto compile(stmt const& stmt) -> chunk;
+
+	//! The bytecode for the body of @p lambda, which is compiled on first use and cached in its tree. Its local variables
+	//! are assigned to slots, which its frames must provide.
+	auto bytecode(expr const& lambda) -> chunk const&;
+}
@@ -0,0 +1,100 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "combinatorics.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace gynjo::val {
+	namespace {
+		//! The primes up to @p n, by the sieve of Eratosthenes.
+		auto primes_up_to(std::uint64_t n) -> std::vector<std::uint64_t> {
+			std::vector<bool> composite(n + 1);
+			std::vector<std::uint64_t> result;
+			for (std::uint64_t i = 2; i <= n; ++i) {
+				if (composite[i]) { continue; }
+				result.push_back(i);
+				for (std::uint64_t j = i * i; j <= n; j += i) {
+					composite[j] = true;
+				}
+			}
+			return result;
+		}
+
+		//! The product of the range [@p begin, @p end), split in halves so that both sides of each multiplication
+		//! have about as many digits.
+		auto product(std::uint64_t const* begin, std::uint64_t const* end) -> big_int {
+			constexpr std::ptrdiff_t leaf_size = 8;
+			if (end - begin <= leaf_size) {
+				big_int result = 1;
+				for (auto it = begin; it != end; ++it) {
+					result *= *it;
+				}
+				return result;
+			}
+			auto const middle = begin + (end - begin) / 2;
+			return product(begin, middle) * product(middle, end);
+		}
+
+		//! The product of @p factors, which are packed into as few machine words as possible first.
+		auto product(std::vector<std::uint64_t> const& factors) -> big_int {
+			std::vector<std::uint64_t> words;
+			std::uint64_t word = 1;
+			for (auto const factor : factors) {
+				if (word > std::numeric_limits<std::uint64_t>::max() / factor) {
+					words.push_back(word);
+					word = factor;
+				} else {
+					word *= factor;
+				}
+			}
+			words.push_back(word);
+			return product(words.data(), words.data() + words.size());
+		}
+
+		//! The swinging factorial of @p n, n! / (n/2)!^2, from @p primes, which include those up to @p n.
+		auto swing(std::uint64_t n, std::vector<std::uint64_t> const& primes) -> big_int {
+			// The power of each prime p is the number of odd quotients of n by p, p^2, p^3, ..., and is at most n.
+			std::vector<std::uint64_t> factors;
+			for (auto const p : primes) {
+				if (p > n) { break; }
+				std::uint64_t power = 1;
+				for (auto q = n / p; q > 0; q /= p) {
+					if (q % 2 == 1) { power *= p; }
+				}
+				if (power > 1) { factors.push_back(power); }
+			}
+			return product(factors);
+		}
+
+		//! @p n! from @p primes, which include those up to @p n.
+		auto factorial(std::uint64_t n, std::vector<std::uint64_t> const& primes) -> big_int {
+			if (n < 2) { return 1; }
+			auto const half = factorial(n / 2, primes);
+			return half * half * swing(n, primes);
+		}
+	}
+
+	auto factorial(std::uint64_t n) -> big_int {
+		return factorial(n, primes_up_to(n));
+	}
+
+	auto binomial(std::uint64_t n, std::uint64_t k) -> big_int {
+		if (k > n) { return 0; }
+		k = std::min(k, n - k);
+		std::vector<std::uint64_t> factors;
+		for (auto const p : primes_up_to(n)) {
+			// The prime power is at most n.
+			std::uint64_t power = 1;
+			bool borrow = false;
+			for (auto m = n, j = k; m > 0; m /= p, j /= p) {
+				borrow = m % p < j % p + (borrow ? 1 : 0);
+				if (borrow) { power *= p; }
+			}
+			if (power > 1) { factors.push_back(power); }
+		}
+		return product(factors);
+	}
+}
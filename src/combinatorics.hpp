@@ -0,0 +1,25 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Exact factorials and binomial coefficients.
+
+#pragma once
+
+#include "num.hpp"
+
+#include <cstdint>
+
+namespace gynjo::val {
+	//! The largest argument for which factorials and binomial coefficients are computed exactly. Their cost grows with
+	//! the square of their size, so larger ones are better left to term-by-term arithmetic.
+	inline constexpr std::uint64_t max_exact_combinatorics = std::uint64_t{1} << 20;
+
+	//! @p n!, by the prime swing algorithm: n! is (n/2)! squared times the swinging factorial of n, which is a product
+	//! of prime powers no greater than n. Products are split in halves so that the multiplications are balanced.
+	//! @note @p n must be at most max_exact_combinatorics.
+	auto factorial(std::uint64_t n) -> big_int;
+
+	//! @p n choose @p k, from its prime factorization, in which by Kummer's theorem the power of each prime p is the
+	//! number of borrows when subtracting k from n in base p.
+	//! @note @p n must be at most max_exact_combinatorics.
+	auto binomial(std::uint64_t n, std::uint64_t k) -> big_int;
+}
@@ -3,7 +3,9 @@
 
 #include "environment.hpp"
 
+#include "ast.hpp"
 #include "interpreter.hpp"
+#include "intrinsics.hpp"
 
 namespace gynjo {
 	auto environment::make_empty() -> env_ptr {
@@ -11,8 +13,10 @@ namespace gynjo {
 	}
 
 	auto environment::make_with_core_libs() -> env_ptr {
-		static auto result = [] {
+		// Values' reference counts aren't atomic, so each thread imports the core libraries for itself.
+		thread_local auto result = [] {
 			auto env = std::make_shared<environment>();
+			import_natives(env);
 			import_lib(env, "\"core/constants.gynj\"");
 			import_lib(env, "\"core/core.gynj\"");
 			return env;
@@ -22,21 +26,27 @@ namespace gynjo {
 
 	environment::environment(env_ptr parent_env) : parent_env{std::move(parent_env)} {}
 
-	auto environment::lookup(std::string_view name) -> std::optional<val::value> const {
-		// For now, this is the best way I can think of to do a string_view lookup without allocating.
-		// In C++20, will be able to just use find(), thanks to P0919R2: Heterogeneous lookup for unordered containers.
-		std::unordered_map<std::string, val::value>::value_type x;
-		auto const it = std::find_if(
-			local_vars.begin(), local_vars.end(), [&](auto const& name_val) { return name_val.first == name; });
-		if (it != local_vars.end()) {
+	auto environment::lookup(interned name) const noexcept -> val::value const* {
+		for (environment const* env = this; env != nullptr; env = env->parent_env.get()) {
 			// Found in local variables.
-			return it->second;
-		} else if (parent_env != nullptr) {
-			// Try searching parent environment.
-			return parent_env->lookup(name);
-		} else {
-			// Not found.
-			return std::nullopt;
+			if (auto const value = env->local_vars.find(name)) { return value; }
+			for (std::size_t i = 0; i < env->slot_names.size(); ++i) {
+				// Found in an assigned slot.
+				if (env->slot_names[i] == name && env->slots[i].has_value()) { return &*env->slots[i]; }
+			}
+			// Otherwise, try searching the parent environment.
+		}
+		// Not found.
+		return nullptr;
+	}
+
+	auto import_natives(env_ptr const& env) -> void {
+		auto const code = ast::make();
+		for (auto const f : {intrinsic::fact, intrinsic::nCk}) {
+			// The functions only use their parameters, so they close over an empty environment rather than over env,
+			// which would keep env alive.
+			auto const lambda = code->add_intrinsic_lambda(f);
+			env->local_vars.insert_or_assign(name(f), val::closure{expr{code.get(), lambda}, environment::make_empty(), code});
 		}
 	}
 
@@ -5,21 +5,34 @@
 
 #include "environment_fwd.hpp"
 
+#include "interned.hpp"
+#include "symbol_map.hpp"
 #include "values.hpp"
 
-#include <string>
-#include <unordered_map>
+#include <optional>
+#include <span>
+#include <vector>
 
 namespace gynjo {
 	struct environment {
 		//! Convenience factory method for creating a new empty shared environment pointer.
 		static auto make_empty() -> env_ptr;
 
-		//! Convenience factory method for creating a new shared environment pointer with core libs loaded.
+		//! Convenience factory method for creating a new shared environment pointer with the native functions and core libs
+		//! loaded.
+		//! @note Each thread gets its own core environment, shared by that thread's callers, since values can't be
+		//! shared between threads.
 		static auto make_with_core_libs() -> env_ptr;
 
 		//! Variables mappings created within the local scope.
-		std::unordered_map<std::string, val::value> local_vars;
+		symbol_map<val::value> local_vars;
+
+		//! If this is the frame of a call to a compiled function, the names of the function's local variables, which the
+		//! compiler assigned to slots. The names are owned by the function's bytecode, which outlives its frames.
+		std::span<interned const> slot_names;
+
+		//! The values of the variables in @p slot_names, by slot. A slot is empty until its variable is assigned.
+		std::vector<std::optional<val::value>> slots;
 
 		//! A pointer to the parent environment, if any.
 		std::shared_ptr<environment> parent_env;
@@ -27,10 +40,14 @@ namespace gynjo {
 		//! @param parent_env A pointer to the parent environment, if any.
 		environment(env_ptr parent_env = nullptr);
 
-		//! Returns the value of the variable with name @name or nullopt if the variable is undefined.
-		auto lookup(std::string_view name) -> std::optional<val::value> const;
+		//! The value of the variable named @p name, in place, or null if the variable is undefined. The pointer is valid
+		//! until the variable's environment changes.
+		auto lookup(interned name) const noexcept -> val::value const*;
 	};
 
+	//! Binds the native functions fact and nCk in @p env. They're ordinary variables, so programs can rebind them.
+	auto import_natives(env_ptr const& env) -> void;
+
 	//! Attempts to import @p lib into @p env and displays an error message on failure.
 	auto import_lib(env_ptr const& env, std::string_view lib) -> void;
 }
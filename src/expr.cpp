@@ -4,223 +4,198 @@
 #include "expr.hpp"
 
 #include "stmt.hpp"
+#include "tokens.hpp"
 
-namespace gynjo {
-	block::block() : stmts{std::make_unique<std::vector<stmt>>()} {}
-
-	block::block(block const& that) : stmts{std::make_unique<std::vector<stmt>>(*that.stmts)} {}
-
-	block::~block() = default;
-
-	auto block::operator=(block const& that) -> block& {
-		stmts = std::make_unique<std::vector<stmt>>(*that.stmts);
-		return *this;
-	}
-
-	auto block::operator==(block const& that) const noexcept -> bool {
-		return *stmts == *that.stmts;
-	}
-
-	auto cond::operator==(cond const& that) const noexcept -> bool {
-		return *test == *that.test && *true_expr == *that.true_expr && *false_expr == *that.false_expr;
-	}
-
-	auto and_::operator==(and_ const& that) const noexcept -> bool {
-		return *left == *that.left && *right == *that.right;
-	}
-
-	auto or_::operator==(or_ const& that) const noexcept -> bool {
-		return *left == *that.left && *right == *that.right;
-	}
-
-	auto not_::operator==(not_ const& that) const noexcept -> bool {
-		return *expr == *that.expr;
-	}
-
-	auto eq::operator==(eq const& that) const noexcept -> bool {
-		return *left == *that.left && *right == *that.right;
-	}
-
-	auto neq::operator==(neq const& that) const noexcept -> bool {
-		return *left == *that.left && *right == *that.right;
-	}
-
-	auto approx::operator==(approx const& that) const noexcept -> bool {
-		return *left == *that.left && *right == *that.right;
-	}
-
-	auto lt::operator==(lt const& that) const noexcept -> bool {
-		return *left == *that.left && *right == *that.right;
-	}
-
-	auto leq::operator==(leq const& that) const noexcept -> bool {
-		return *left == *that.left && *right == *that.right;
-	}
-
-	auto gt::operator==(gt const& that) const noexcept -> bool {
-		return *left == *that.left && *right == *that.right;
-	}
-
-	auto geq::operator==(geq const& that) const noexcept -> bool {
-		return *left == *that.left && *right == *that.right;
-	}
-
-	auto add::operator==(add const& that) const noexcept -> bool {
-		return *addend1 == *that.addend1 && *addend2 == *that.addend2;
-	}
-
-	auto sub::operator==(sub const& that) const noexcept -> bool {
-		return *minuend == *that.minuend && *subtrahend == *that.subtrahend;
-	}
+#include <fmt/format.h>
 
-	cluster::cluster(std::vector<bool> negations, std::unique_ptr<std::vector<expr>> items, std::vector<connector> connectors)
-		: negations{std::move(negations)}, items{std::move(items)}, connectors{std::move(connectors)} {}
+#include <algorithm>
 
-	cluster::cluster(cluster const& that)
-		: negations{that.negations}, items{std::make_unique<std::vector<expr>>(*that.items)}, connectors{that.connectors} {}
-
-	auto cluster::operator=(cluster const& that) -> cluster& {
-		negations = that.negations;
-		items = std::make_unique<std::vector<expr>>(*that.items);
-		connectors = that.connectors;
-		return *this;
-	}
-
-	auto cluster::operator==(cluster const& that) const noexcept -> bool {
-		return items == that.items;
-	}
-
-	tup_expr::tup_expr() : elems{std::make_unique<std::vector<expr>>()} {}
-	tup_expr::tup_expr(std::unique_ptr<std::vector<expr>> elems) : elems{std::move(elems)} {}
-
-	tup_expr::tup_expr(tup_expr const& that) {
-		elems = std::make_unique<std::vector<expr>>(*that.elems);
-	}
-
-	auto tup_expr::operator=(tup_expr const& that) -> tup_expr& {
-		elems = std::make_unique<std::vector<expr>>(*that.elems);
-		return *this;
-	}
-
-	auto tup_expr::operator==(tup_expr const& that) const noexcept -> bool {
-		return *elems == *that.elems;
-	}
-
-	list_expr::list_expr() : elems{std::make_unique<std::deque<expr>>()} {}
-	list_expr::list_expr(std::unique_ptr<std::deque<expr>> elems) : elems{std::move(elems)} {}
-
-	list_expr::list_expr(list_expr const& that) {
-		elems = std::make_unique<std::deque<expr>>(*that.elems);
-	}
-
-	auto list_expr::operator=(list_expr const& that) -> list_expr& {
-		elems = std::make_unique<std::deque<expr>>(*that.elems);
-		return *this;
-	}
-
-	auto list_expr::operator==(list_expr const& that) const noexcept -> bool {
-		return *elems == *that.elems;
-	}
-
-	auto lambda::operator==(lambda const& that) const noexcept -> bool {
-		return *params == *that.params && body == that.body;
-	}
-
-	auto to_string(expr const& expr) -> std::string {
+namespace gynjo {
+	namespace {
+		//! Whether @p a and @p b are the same node of the same tree.
+		auto identical(expr const& a, expr const& b) -> bool {
+			return a.tree == b.tree && a.node == b.node;
+		}
+
+		//! Whether the child lists of @p a and @p b are pairwise equal, as expressions or statements @p T.
+		template <typename T>
+		auto equal_child_lists(expr const& a, expr const& b) -> bool {
+			return std::equal(a.tree->child_list(a.node).begin(),
+				a.tree->child_list(a.node).end(),
+				b.tree->child_list(b.node).begin(),
+				b.tree->child_list(b.node).end(),
+				[&](node_id a_child, node_id b_child) { return T{a.tree, a_child} == T{b.tree, b_child}; });
+		}
+
+		//! Converts the child list of @p e to a string, with each element converted as an expression or statement @p T.
+		template <typename T>
+		auto child_list_to_string(expr const& e, char const* separator, print_form form) -> std::string {
+			std::string result;
+			for (auto const child : e.tree->child_list(e.node)) {
+				if (!result.empty()) { result += separator; }
+				result += to_string(T{e.tree, child}, form);
+			}
+			return result;
+		}
+	}
+
+	auto expr::operator==(expr const& that) const noexcept -> bool {
+		auto const k = kind();
+		if (k != that.kind()) { return false; }
+		switch (k) {
+			case node_kind::cond:
+				return child(0) == that.child(0) && child(1) == that.child(1) && child(2) == that.child(2);
+			case node_kind::block:
+				return equal_child_lists<stmt>(*this, that);
+			case node_kind::not_:
+			case node_kind::neg:
+				return child(0) == that.child(0);
+			case node_kind::and_:
+			case node_kind::or_:
+			case node_kind::eq:
+			case node_kind::neq:
+			case node_kind::approx:
+			case node_kind::lt:
+			case node_kind::leq:
+			case node_kind::gt:
+			case node_kind::geq:
+			case node_kind::add:
+			case node_kind::sub:
+			case node_kind::pow:
+			case node_kind::mul:
+			case node_kind::div:
+			case node_kind::sqrt:
+			case node_kind::int_pow:
+				return child(0) == that.child(0) && child(1) == that.child(1);
+			case node_kind::cluster:
+				return identical(*this, that);
+			case node_kind::lambda: {
+				auto const body = child(1);
+				auto const that_body = that.child(1);
+				bool const bodies_equal = body.kind() == node_kind::intrinsic && that_body.kind() == node_kind::intrinsic
+					? body == that_body
+					: identical(body, that_body);
+				return child(0) == that.child(0) && bodies_equal;
+			}
+			case node_kind::intrinsic:
+				return tree->intrinsic(node) == that.tree->intrinsic(that.node);
+			case node_kind::tup:
+			case node_kind::list:
+				return equal_child_lists<expr>(*this, that);
+			case node_kind::boolean:
+				return tree->boolean(node) == that.tree->boolean(that.node);
+			case node_kind::num:
+			case node_kind::str:
+				return tree->literal(node) == that.tree->literal(that.node);
+			case node_kind::sym:
+				return tree->symbol(node) == that.tree->symbol(that.node);
+			default:
+				// Statements aren't expressions.
+				return false;
+		}
+	}
+
+	auto to_string(expr const& expr, print_form form) -> std::string {
 		using namespace std::string_literals;
-		return match(
-			expr.value,
-			[](cond const& cond) {
+		auto const& tree = *expr.tree;
+		auto const node = expr.node;
+		// Print what the user wrote, not what inference or optimization rewrote it to.
+		if (auto const original = tree.original(node); form == print_form::written && original != node) {
+			return to_string(gynjo::expr{&tree, original}, form);
+		}
+		auto const binary = [&](char const* op) {
+			return fmt::format("({} {} {})", to_string(expr.child(0), form), op, to_string(expr.child(1), form));
+		};
+		switch (expr.kind()) {
+			case node_kind::cond:
 				return fmt::format(
-					"({} ? {} : {})", to_string(*cond.test), to_string(*cond.true_expr), to_string(*cond.false_expr));
-			},
-			[](block const& block) {
-				std::string result = "{ ";
-				if (!block.stmts->empty()) {
-					result += to_string(block.stmts->front());
-					for (auto it = block.stmts->begin() + 1; it != block.stmts->end(); ++it) {
-						result += "; " + to_string(*it);
-					}
-				}
-				result += " }";
-				return result;
-			},
-			[](and_ const& and_) { return fmt::format("({} and {})", to_string(*and_.left), to_string(*and_.right)); },
-			[](or_ const& or_) { return fmt::format("({} or {})", to_string(*or_.left), to_string(*or_.right)); },
-			[](not_ const& not_) { return fmt::format("(not {})", to_string(*not_.expr)); },
-			[](eq const& eq) { return fmt::format("({} == {})", to_string(*eq.left), to_string(*eq.right)); },
-			[](neq const& neq) { return fmt::format("({} != {})", to_string(*neq.left), to_string(*neq.right)); },
-			[](approx const& approx) {
-				return fmt::format("({} ~ {})", to_string(*approx.left), to_string(*approx.right));
-			},
-			[](lt const& lt) { return fmt::format("({} < {})", to_string(*lt.left), to_string(*lt.right)); },
-			[](leq const& leq) { return fmt::format("({} <= {})", to_string(*leq.left), to_string(*leq.right)); },
-			[](gt const& gt) { return fmt::format("({} > {})", to_string(*gt.left), to_string(*gt.right)); },
-			[](geq const& geq) { return fmt::format("({} >= {})", to_string(*geq.left), to_string(*geq.right)); },
-			[](add const& add) { return fmt::format("({} + {})", to_string(*add.addend1), to_string(*add.addend2)); },
-			[](sub const& sub) { return fmt::format("({} - {})", to_string(*sub.minuend), to_string(*sub.subtrahend)); },
-			[](cluster const& cluster) {
+					"({} ? {} : {})", to_string(expr.child(0), form), to_string(expr.child(1), form), to_string(expr.child(2), form));
+			case node_kind::block:
+				return "{ " + child_list_to_string<stmt>(expr, "; ", form) + " }";
+			case node_kind::and_:
+				return binary("and");
+			case node_kind::or_:
+				return binary("or");
+			case node_kind::not_:
+				return fmt::format("(not {})", to_string(expr.child(0), form));
+			case node_kind::eq:
+				return binary("==");
+			case node_kind::neq:
+				return binary("!=");
+			case node_kind::approx:
+				return binary("~");
+			case node_kind::lt:
+				return binary("<");
+			case node_kind::leq:
+				return binary("<=");
+			case node_kind::gt:
+				return binary(">");
+			case node_kind::geq:
+				return binary(">=");
+			case node_kind::add:
+				return binary("+");
+			case node_kind::sub:
+				return binary("-");
+			case node_kind::neg:
+				return fmt::format("(-{})", to_string(expr.child(0), form));
+			case node_kind::pow:
+			case node_kind::sqrt:
+			case node_kind::int_pow:
+				return binary("^");
+			case node_kind::mul:
+				return binary("*");
+			case node_kind::div:
+				return binary("/");
+			case node_kind::cluster: {
+				auto const items = tree.cluster_items(node);
 				std::string result = "(";
-				if (!cluster.items->empty()) {
-					result += (cluster.negations.front() ? "-" : "") + to_string(cluster.items->front());
+				if (!items.empty()) {
+					result += (tree.negated(node, 0) ? "-" : "") + to_string(gynjo::expr{&tree, items.front()}, form);
 				}
-				for (std::size_t i = 0; i < cluster.connectors.size(); ++i) {
-					auto item_string = (cluster.negations[i + 1] ? "-" : "") + to_string((*cluster.items)[i + 1]);
-					switch (cluster.connectors[i]) {
-						case cluster::connector::adj_paren:
+				for (std::size_t i = 0; i + 1 < items.size(); ++i) {
+					auto item_string = (tree.negated(node, i + 1) ? "-" : "") + to_string(gynjo::expr{&tree, items[i + 1]}, form);
+					switch (tree.connector(node, i)) {
+						case connector::adj_paren:
 							result += " (" + item_string + ")";
 							break;
-						case cluster::connector::adj_nonparen:
+						case connector::adj_nonparen:
 							result += " " + item_string;
 							break;
-						case cluster::connector::mul:
+						case connector::mul:
 							result += " * " + item_string;
 							break;
-						case cluster::connector::div:
+						case connector::div:
 							result += " / " + item_string;
 							break;
-						case cluster::connector::exp:
+						case connector::exp:
 							result += " ^ " + item_string;
 							break;
 					}
 					result += ")";
 				}
 				return result;
-			},
-			[](lambda const& f) {
-				return match(
-					f.body,
-					[&](expr_ptr const& body) {
-						return fmt::format("({} -> {})", to_string(*f.params), to_string(*body));
-					},
-					[](intrinsic body) { return name(body); });
-			},
-			[](intrinsic const& f) { return name(f); },
-			[](tup_expr const& tup) {
-				std::string result = "(";
-				if (!tup.elems->empty()) {
-					result += to_string(tup.elems->front());
-					for (auto it = tup.elems->begin() + 1; it != tup.elems->end(); ++it) {
-						result += ", " + to_string(*it);
-					}
-				}
-				result += ")";
-				return result;
-			},
-			[](list_expr const& list) {
-				std::string result = "[";
-				if (!list.elems->empty()) {
-					result += to_string(list.elems->front());
-					for (auto it = list.elems->begin() + 1; it != list.elems->end(); ++it) {
-						result += ", " + to_string(*it);
-					}
-				}
-				result += "]";
-				return result;
-			},
-			[](tok::boolean const& b) { return tok::to_string(b); },
-			[](tok::num const& num) { return num.rep; },
-			[](std::string const& str) { return tok::to_string(str); },
-			[](tok::sym const& sym) { return sym.name; });
+			}
+			case node_kind::lambda: {
+				auto const body = expr.child(1);
+				if (body.kind() == node_kind::intrinsic) { return to_string(body, form); }
+				return fmt::format("({} -> {})", to_string(expr.child(0), form), to_string(body, form));
+			}
+			case node_kind::intrinsic:
+				return name(tree.intrinsic(node));
+			case node_kind::tup:
+				return "(" + child_list_to_string<gynjo::expr>(expr, ", ", form) + ")";
+			case node_kind::list:
+				return "[" + child_list_to_string<gynjo::expr>(expr, ", ", form) + "]";
+			case node_kind::boolean:
+				return tok::to_string(tok::boolean{tree.boolean(node)});
+			case node_kind::num:
+				return std::string{tree.literal(node)};
+			case node_kind::str:
+				return tok::to_string(tok::str{std::string{tree.literal(node)}});
+			case node_kind::sym:
+				return std::string{tree.symbol(node).str()};
+			default:
+				return to_string(stmt{expr.tree, expr.node}, form);
+		}
 	}
 }
@@ -3,10 +3,6 @@
 
 #pragma once
 
-#include <memory>
-
 namespace gynjo {
 	struct expr;
-
-	using expr_ptr = std::shared_ptr<expr>;
 }
@@ -0,0 +1,168 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "inference.hpp"
+
+#include "parser.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace gynjo {
+	namespace {
+		//! What's provable about the value of a node.
+		struct facts {
+			//! Evaluating the node has no side effects.
+			bool pure = false;
+			//! The node's value, if any, isn't a function.
+			bool not_closure = false;
+		};
+
+		//! Infers facts about nodes, from their children's facts.
+		class inference {
+		public:
+			inference(ast& tree, node_id first, node_visitor visitor) : _tree{tree}, _first{first}, _visitor{visitor} {}
+
+			auto run() -> inference_stats {
+				// Children precede their parents, so a single pass in order sees every node's children first.
+				auto const end = static_cast<node_id>(_tree.size());
+				for (node_id node = _first; node < end; ++node) {
+					visit(node);
+				}
+				return _stats;
+			}
+
+		private:
+			ast& _tree;
+			node_id _first;
+			node_visitor _visitor;
+			std::vector<facts> _facts;
+			inference_stats _stats;
+
+			auto visit(node_id node) -> void {
+				auto const node_facts = infer(node);
+				_facts.resize(_tree.size() - _first);
+				_facts[node - _first] = node_facts;
+				if (_visitor != nullptr) { _visitor(_tree, node); }
+			}
+
+			//! Adds a node for part of a resolved cluster and visits it, since its parents will be visited next.
+			auto add(node_kind kind, std::initializer_list<node_id> children) -> node_id {
+				auto const node = _tree.add(kind, children);
+				visit(node);
+				return node;
+			}
+
+			//! The facts about @p node, which must already have been inferred. Nothing is known about earlier nodes.
+			auto get(node_id node) const -> facts {
+				return node < _first ? facts{} : _facts[node - _first];
+			}
+
+			auto all_pure(std::span<node_id const> nodes) const -> bool {
+				return std::all_of(nodes.begin(), nodes.end(), [&](node_id node) { return get(node).pure; });
+			}
+
+			auto infer(node_id node) -> facts {
+				switch (_tree.kind(node)) {
+					case node_kind::cond: {
+						auto const t = get(_tree.child(node, 1));
+						auto const f = get(_tree.child(node, 2));
+						return {get(_tree.child(node, 0)).pure && t.pure && f.pure, t.not_closure && f.not_closure};
+					}
+					case node_kind::not_:
+					case node_kind::neg:
+						return {get(_tree.child(node, 0)).pure, true};
+					case node_kind::and_:
+					case node_kind::or_:
+					case node_kind::eq:
+					case node_kind::neq:
+					case node_kind::approx:
+					case node_kind::lt:
+					case node_kind::leq:
+					case node_kind::gt:
+					case node_kind::geq:
+					case node_kind::add:
+					case node_kind::sub:
+					case node_kind::pow:
+					case node_kind::mul:
+					case node_kind::div:
+						// These produce booleans or numbers, or lists or tuples of numbers.
+						return {get(_tree.child(node, 0)).pure && get(_tree.child(node, 1)).pure, true};
+					case node_kind::cluster:
+						++_stats.clusters;
+						if (resolve(node)) {
+							++_stats.resolved;
+							return {true, true};
+						}
+						// The cluster might call a function.
+						return {};
+					case node_kind::lambda:
+						// Creating a closure has no side effects.
+						return {true, false};
+					case node_kind::tup:
+					case node_kind::list:
+						return {all_pure(_tree.child_list(node)), true};
+					case node_kind::boolean:
+					case node_kind::num:
+					case node_kind::str:
+						return {true, true};
+					case node_kind::sym:
+						return {true, false};
+					default:
+						// Blocks may assign variables, and statements aren't values.
+						return {};
+				}
+			}
+
+			//! Resolves @p cluster if possible, following the same order of operations as runtime evaluation when no
+			//! items are functions.
+			//! @return Whether @p cluster was resolved.
+			auto resolve(node_id cluster) -> bool {
+				auto const items = _tree.cluster_items(cluster);
+				// Resolving a cluster nests its operations about as deeply as it has items, and later passes and the tree
+				// walker recurse through that nesting. So a cluster longer than the parser's nesting limit is left for
+				// evaluation, which handles any length without recursion.
+				if (items.size() > max_nesting_depth()) { return false; }
+				if (!all_pure(items)) { return false; }
+				for (std::size_t i = 0; i + 1 < items.size(); ++i) {
+					auto const connector = _tree.connector(cluster, i);
+					bool const adjacent = connector == connector::adj_paren || connector == connector::adj_nonparen;
+					if (adjacent && !get(items[i]).not_closure) { return false; }
+				}
+				// The operands that each item has combined into so far, and the indices of the items not yet consumed.
+				std::vector<node_id> operands{items.begin(), items.end()};
+				std::vector<std::size_t> remaining(items.size());
+				for (std::size_t i = 0; i < remaining.size(); ++i) {
+					remaining[i] = i;
+				}
+				auto const connector_after = [&](std::size_t i) {
+					return _tree.connector(cluster, remaining[i + 1] - 1);
+				};
+				// An item is negated as it becomes a right operand, and the first item is negated at the end.
+				auto const operand = [&](std::size_t i) {
+					auto const item = remaining[i];
+					return _tree.negated(cluster, item) ? add(node_kind::neg, {operands[item]}) : operands[item];
+				};
+				auto const combine = [&](std::size_t i, node_kind kind) {
+					operands[remaining[i]] = add(kind, {operands[remaining[i]], operand(i + 1)});
+					remaining.erase(remaining.begin() + static_cast<std::ptrdiff_t>(i) + 1);
+				};
+				// Exponentiation is right-associative, so do exponentiations from right to left.
+				for (auto i = remaining.size() - 1; i-- > 0;) {
+					if (connector_after(i) == connector::exp) { combine(i, node_kind::pow); }
+				}
+				// Do multiplication and division, from left to right. Adjacent items are multiplied.
+				while (remaining.size() > 1) {
+					combine(0, connector_after(0) == connector::div ? node_kind::div : node_kind::mul);
+				}
+				auto const result = _tree.negated(cluster, 0) ? add(node_kind::neg, {operands[0]}) : operands[0];
+				_tree.replace(cluster, result);
+				return true;
+			}
+		};
+	}
+
+	auto resolve_clusters(ast& tree, node_id first, node_visitor visitor) -> inference_stats {
+		return inference{tree, first, visitor}.run();
+	}
+}
@@ -0,0 +1,32 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Static type inference, which resolves clusters at parse time where the types of their items are provable.
+
+#pragma once
+
+#include "ast.hpp"
+
+#include <cstddef>
+
+namespace gynjo {
+	//! The numbers of clusters that resolve_clusters considered and resolved.
+	struct inference_stats {
+		std::size_t clusters = 0;
+		std::size_t resolved = 0;
+	};
+
+	//! A function to call on each node of a tree once the node's children are final.
+	using node_visitor = void (*)(ast& tree, node_id node);
+
+	//! Rewrites each cluster among the nodes of @p tree from @p first on into explicit exponentiation, multiplication,
+	//! division, and negation nodes, if its order of operations can be determined without evaluating it.
+	//! @note A cluster's order of operations depends on which items are functions. Because scoping is dynamic, any
+	//! symbol might name a function, so a cluster is only resolved if every item that could be applied to its
+	//! neighbor is provably not a function, in which case no applications occur. Items must also be free of side
+	//! effects, so that interleaving their evaluation with the operations can't change anything except which error is
+	//! reported first. Clusters with more items than the maximum nesting depth (see max_nesting_depth) are also left
+	//! alone, since resolving them would nest deeper than the parser allows.
+	//! @param visitor If not null, called on each node from @p first on, including nodes added to resolved clusters,
+	//! once the node's children are final. It may rewrite the node.
+	auto resolve_clusters(ast& tree, node_id first = 0, node_visitor visitor = nullptr) -> inference_stats;
+}
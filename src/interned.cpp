@@ -0,0 +1,125 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "interned.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace gynjo {
+	namespace {
+		//! Open-addressing hash set of strings, backed by append-only character blocks.
+		struct intern_table {
+			//! Characters are allocated from blocks of at least this size.
+			static constexpr std::size_t block_size = 64 * 1024;
+			//! Marks an unused hash slot.
+			static constexpr std::uint32_t empty_slot = UINT32_MAX;
+
+			//! Character storage. Blocks are never freed or moved, so views into them stay valid.
+			std::vector<std::unique_ptr<char[]>> blocks;
+			//! Unused space at the end of the current block.
+			char* free_begin = nullptr;
+			char* free_end = nullptr;
+
+			//! Interned strings, indexed by ID.
+			std::vector<std::string_view> strings;
+
+			//! Hash slots containing string IDs. The size is always a power of two.
+			std::vector<std::uint32_t> slots;
+
+			//! Guards the table, which embedders may use from several threads at once. Interning happens while lexing,
+			//! and lookups while printing, so the lock is rarely contended.
+			std::mutex mutex;
+
+			intern_table() : slots(1024, empty_slot) {
+				// ID 0 is reserved for the empty string so that default-constructed handles are valid.
+				find_or_insert("");
+			}
+
+			//! FNV-1a hash.
+			static auto hash(std::string_view str) -> std::size_t {
+				std::uint64_t result = 14695981039346656037ull;
+				for (unsigned char c : str) {
+					result = (result ^ c) * 1099511628211ull;
+				}
+				return static_cast<std::size_t>(result);
+			}
+
+			auto find_or_insert(std::string_view str) -> std::uint32_t {
+				std::lock_guard const lock{mutex};
+				auto const h = hash(str);
+				auto const mask = slots.size() - 1;
+				for (auto i = h & mask;; i = (i + 1) & mask) {
+					auto const id = slots[i];
+					if (id == empty_slot) {
+						auto const new_id = append(str);
+						// Keep the load factor at or below one half.
+						if (2 * strings.size() > slots.size()) {
+							rehash(2 * slots.size());
+						} else {
+							slots[i] = new_id;
+						}
+						return new_id;
+					}
+					if (strings[id] == str) { return id; }
+				}
+			}
+
+			//! The string with ID @p id.
+			auto string(std::uint32_t id) -> std::string_view {
+				std::lock_guard const lock{mutex};
+				return strings[id];
+			}
+
+			//! Copies @p str into character storage and assigns it the next ID.
+			auto append(std::string_view str) -> std::uint32_t {
+				// Include room for a null terminator.
+				auto const size = str.size() + 1;
+				if (static_cast<std::size_t>(free_end - free_begin) < size) {
+					auto const new_block_size = std::max(size, block_size);
+					blocks.push_back(std::make_unique<char[]>(new_block_size));
+					free_begin = blocks.back().get();
+					free_end = free_begin + new_block_size;
+				}
+				auto const data = free_begin;
+				str.copy(data, str.size());
+				data[str.size()] = '\0';
+				free_begin += size;
+
+				strings.emplace_back(data, str.size());
+				return static_cast<std::uint32_t>(strings.size() - 1);
+			}
+
+			auto rehash(std::size_t new_size) -> void {
+				slots.assign(new_size, empty_slot);
+				auto const mask = new_size - 1;
+				for (std::uint32_t id = 0; id < strings.size(); ++id) {
+					auto i = hash(strings[id]) & mask;
+					while (slots[i] != empty_slot) {
+						i = (i + 1) & mask;
+					}
+					slots[i] = id;
+				}
+			}
+		};
+
+		auto table() -> intern_table& {
+			static intern_table result;
+			return result;
+		}
+	}
+
+	auto interned::str() const noexcept -> std::string_view {
+		return table().string(id);
+	}
+
+	auto interned::c_str() const noexcept -> char const* {
+		return table().string(id).data();
+	}
+
+	auto interned::intern(std::string_view str) -> interned {
+		return interned{table().find_or_insert(str)};
+	}
+}
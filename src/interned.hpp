@@ -0,0 +1,43 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#pragma once
+
+#include <compare>
+#include <concepts>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace gynjo {
+	//! Handle to an immutable string in the process-wide intern table.
+	//! @note Interned strings live until the process exits, so handles are trivially copyable and never dangle. Two
+	//! handles are equal if and only if their strings are equal. The intern table is thread-safe, so interpreters on
+	//! different threads can share it. Since it only grows, it's meant for names, which a program has a bounded number
+	//! of, and not for literal text.
+	struct interned {
+		//! The index of the string in the intern table. Zero is the empty string.
+		std::uint32_t id = 0;
+
+		interned() = default;
+
+		//! Refers to @p str, interning it first if it hasn't been seen before.
+		template <typename T>
+		requires std::convertible_to<T const&, std::string_view> interned(T const& str)
+			: interned{intern(std::string_view{str})} {}
+
+		//! The interned string.
+		auto str() const noexcept -> std::string_view;
+
+		//! The interned string, as a null-terminated C string.
+		auto c_str() const noexcept -> char const*;
+
+		auto operator<=>(interned const&) const noexcept = default;
+
+	private:
+		explicit interned(std::uint32_t id) : id{id} {}
+
+		//! Looks up or inserts @p str in the intern table.
+		static auto intern(std::string_view str) -> interned;
+	};
+}
@@ -3,16 +3,24 @@
 
 #include "interpreter.hpp"
 
+#include "bytecode.hpp"
 #include "environment.hpp"
 #include "expr.hpp"
+#include "inference.hpp"
 #include "lexer.hpp"
+#include "noinline.hpp"
+#include "operations.hpp"
+#include "optimizer.hpp"
 #include "parser.hpp"
+#include "stack.hpp"
 #include "stmt.hpp"
 #include "visitation.hpp"
+#include "vm.hpp"
 
 #include <boost/multiprecision/number.hpp>
 #include <fmt/format.h>
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <memory>
@@ -21,510 +29,471 @@ using namespace std::string_literals;
 
 namespace gynjo {
 	namespace {
+		//! The engine selected by set_engine.
+		engine selected_engine = engine::tree_walker;
+
+		//! The maximum call depth set by set_max_depth.
+		std::size_t selected_max_depth = default_max_depth;
+
+		//! Whether inference is enabled, as set by set_inference.
+		bool selected_inference = true;
+
+		//! Whether optimization is enabled, as set by set_optimization.
+		bool selected_optimization = true;
+
+		//! The number of tree-walker calls nested on this thread.
+		thread_local std::size_t call_depth = 0;
+
+		//! The stack the tree walker leaves unused, for the work between its checks and for unwinding with an error.
+		constexpr std::size_t stack_reserve = 256 * 1024;
+
+		//! The address below which the tree walker stops recursing, measured on this thread's first call. Zero, which
+		//! disables the check, until then or where the stack can't be measured.
+		thread_local std::uintptr_t stack_floor = 0;
+
+		//! Whether the tree walker has used its stack down to stack_floor.
+		auto out_of_stack() -> bool {
+			char here;
+			return reinterpret_cast<std::uintptr_t>(&here) < stack_floor;
+		}
+
+		GYNJO_NOINLINE auto out_of_stack_error() -> eval_result {
+			return tl::unexpected{fmt::format("out of stack space after {} nested calls", call_depth)};
+		}
+
+		auto walk(env_ptr const& env, expr const& expr, std::optional<deferred_call>* tail = nullptr) -> eval_result;
+		auto walk(env_ptr const& env, stmt const& stmt) -> exec_result;
+
+		auto undefined_error(interned name) -> std::string {
+			return fmt::format("'{}' is undefined", name.str());
+		}
+
+		//! Whether evaluating @p expr can't change any environment.
+		auto is_pure_leaf(expr const& expr) -> bool {
+			switch (expr.kind()) {
+				case node_kind::boolean:
+				case node_kind::num:
+				case node_kind::str:
+				case node_kind::sym:
+					return true;
+				default:
+					return false;
+			}
+		}
+
+		//! Calls @p f with the value of @p expr. A variable's value is passed in place rather than copied, so it's only
+		//! valid until its environment changes.
+		template <typename F>
+		auto with_value(env_ptr const& env, expr const& expr, F&& f) -> eval_result {
+			if (expr.kind() == node_kind::sym) {
+				auto const name = expr.tree->symbol(expr.node);
+				auto const value = env->lookup(name);
+				if (value == nullptr) { return tl::unexpected{undefined_error(name)}; }
+				return std::forward<F>(f)(*value);
+			}
+			return walk(env, expr).and_then(std::forward<F>(f));
+		}
+
 		template <typename F>
-		auto eval_binary(env_ptr const& env, expr const& a, expr const& b, F&& f) -> eval_result {
-			return eval(env, a) //
+		GYNJO_NOINLINE auto walk_binary(env_ptr const& env, expr const& a, expr const& b, F&& f) -> eval_result {
+			// Variables are read in place. The right operand is evaluated after the left, so the left can only be read in
+			// place if evaluating the right can't change the variable or its environment.
+			if (is_pure_leaf(b)) {
+				return with_value(env, a, [&](val::value const& a) { //
+					return with_value(env, b, [&](val::value const& b) { //
+						return std::forward<F>(f)(a, b);
+					});
+				});
+			}
+			return walk(env, a) //
 				.and_then([&](val::value const& a) { //
-					return eval(env, b) //
-						.and_then([&](val::value const& b) { //
-							return std::forward<F>(f)(a, b);
-						});
+					return with_value(env, b, [&](val::value const& b) { //
+						return std::forward<F>(f)(a, b);
+					});
 				});
 		}
 
-		template <typename F>
-		auto bin_num_op(env_ptr const& env, val::value const& left, val::value const& right, std::string_view op_name, F&& op)
+		//! Evaluates the statement block @p expr.
+		GYNJO_NOINLINE auto walk_block(env_ptr const& env, expr const& expr, std::optional<deferred_call>* tail)
 			-> eval_result {
-			return match2(
-				left,
-				right,
-				// Basic
-				[&](val::num const& left, val::num const& right) -> eval_result {
-					return std::forward<F>(op)(left, right);
-				},
-				// Empty list
-				[](val::empty const&, val::num const&) -> eval_result { return val::empty{}; },
-				[](val::num const&, val::empty const&) -> eval_result { return val::empty{}; },
-				// Non-empty list
-				[&](val::list const& left, val::num const& right) -> eval_result {
-					// Perform operation on head.
-					auto head_result = bin_num_op(env, *left.head, right, op_name, op);
-					if (!head_result.has_value()) { return head_result; }
-					// Perform operation on tail.
-					auto tail_result = bin_num_op(env, *left.tail, right, op_name, std::forward<F>(op));
-					if (!tail_result.has_value()) { return tail_result; }
-					// Combine results.
-					return val::list{//
-						val::make_value(std::move(head_result.value())),
-						val::make_value(std::move(tail_result.value()))};
-				},
-				[&](val::num const& left, val::list const& right) -> eval_result {
-					// Perform operation on head.
-					auto head_result = bin_num_op(env, left, *right.head, op_name, op);
-					if (!head_result.has_value()) { return head_result; }
-					// Perform operation on tail.
-					auto tail_result = bin_num_op(env, left, *right.tail, op_name, std::forward<F>(op));
-					if (!tail_result.has_value()) { return tail_result; }
-					// Combine results.
-					return val::list{//
-						val::make_value(std::move(head_result.value())),
-						val::make_value(std::move(tail_result.value()))};
-				},
-				// Invalid
-				[&](auto const&, auto const&) -> eval_result {
-					return tl::unexpected{fmt::format(
-						"cannot perform {} with {} and {}", op_name, to_string(left, env), to_string(right, env))};
-				});
+			auto const& tree = *expr.tree;
+			for (node_id const child : tree.child_list(expr.node)) {
+				stmt const stmt{&tree, child};
+				// A return statement exits the block early and produces a value.
+				if (stmt.kind() == node_kind::ret) { return walk(env, stmt.expr_child(0), tail); }
+				// Otherwise, just execute the statement.
+				auto stmt_result = walk(env, stmt);
+				// Check for error.
+				if (!stmt_result.has_value()) {
+					return tl::unexpected{"in block statement: " + stmt_result.error()};
+				}
+			}
+			// Return nothing if there was no return statement.
+			return val::make_tup();
 		}
 
-		auto application(val::closure const& c, val::tup const& arg) -> eval_result {
-			// The parser guarantees the parameter list is a tuple.
-			auto const& params = std::get<tup_expr>(c.f.params->value);
-			// Ensure correct number of arguments.
-			if (arg.elems->size() != params.elems->size()) {
-				return tl::unexpected{fmt::format("function requires {} argument{}, received {}",
-					params.elems->size(),
-					params.elems->size() == 1 ? "" : "s",
-					arg.elems->size())};
+		//! Evaluates the conjunction @p expr.
+		GYNJO_NOINLINE auto walk_and(env_ptr const& env, expr const& expr) -> eval_result {
+			// Get left.
+			auto const left_result = walk(env, expr.child(0));
+			if (!left_result.has_value()) { return left_result; }
+			if (!left_result.value().is<tok::boolean>()) {
+				return tl::unexpected{fmt::format(
+					"cannot take logical conjunction of non-boolean value {}", to_string(left_result.value(), env))};
 			}
-			// Assign arguments to parameters within a copy of the closure's environment.
-			auto local_env = std::make_shared<environment>(c.env);
-			for (std::size_t i = 0; i < arg.elems->size(); ++i) {
-				// The parser guarantees that each parameter is a symbol.
-				auto param = std::get<tok::sym>((*params.elems)[i].value).name;
-				local_env->local_vars[param] = (*arg.elems)[i];
+			bool const left = left_result.value().as<tok::boolean>().value;
+			// Short-circuit if possible.
+			if (!left) { return tok::boolean{false}; }
+			// Get right.
+			auto const right_result = walk(env, expr.child(1));
+			if (!right_result.has_value()) { return right_result; }
+			if (!right_result.value().is<tok::boolean>()) {
+				return tl::unexpected{fmt::format(
+					"cannot take logical conjunction of non-boolean value {}", to_string(right_result.value(), env))};
 			}
-			// Evaluate function body within the application environment.
-			return match(
-				c.f.body,
-				[&](expr_ptr const& body) -> eval_result { return eval(local_env, *body); },
-				[&](intrinsic body) -> eval_result {
-					switch (body) {
-						case intrinsic::top:
-							return match(
-								*local_env->lookup("list"),
-								[](val::list const& list) -> eval_result { return *list.head; },
-								[&](auto const& arg) -> eval_result {
-									return tl::unexpected{fmt::format(
-										"top() expected a non-empty list, found {}", val::to_string(arg, local_env))};
-								});
-						case intrinsic::pop:
-							return match(
-								*local_env->lookup("list"),
-								[](val::list const& list) -> eval_result { return *list.tail; },
-								[&](auto const& arg) -> eval_result {
-									return tl::unexpected{fmt::format(
-										"pop() expected a non-empty list, found {}", val::to_string(arg, local_env))};
-								});
-						case intrinsic::push:
-							return match(
-								*local_env->lookup("list"),
-								[&](val::empty) -> eval_result {
-									return val::list{
-										val::make_value(*local_env->lookup("value")), val::make_value(val::empty{})};
-								},
-								[&](val::list const& list) -> eval_result {
-									return val::list{val::make_value(*local_env->lookup("value")), val::make_value(list)};
-								},
-								[&](auto const& arg) -> eval_result {
-									return tl::unexpected{
-										fmt::format("push() expected a list, found {}", val::to_string(arg, local_env))};
-								});
-						case intrinsic::print:
-							std::cout << fmt::format("{}\n", to_string(*local_env->lookup("value"), local_env));
-							return val::make_tup();
-						case intrinsic::read: {
-							std::string result;
-							std::getline(std::cin, result);
-							return val::value{result};
-						}
-						default:
-							// unreachable
-							return tl::unexpected{"call to unknown intrinsic function"s};
-					}
-				});
+			auto const right = right_result.value().as<tok::boolean>().value;
+			return tok::boolean{left && right};
 		}
 
-		auto negate(env_ptr const& env, val::value const& value) -> eval_result {
-			return match(
-				value,
-				[](val::num num) -> eval_result { return -num; },
-				[&](auto const&) -> eval_result { return tl::unexpected{"cannot negate " + to_string(value, env)}; });
+		//! Evaluates the disjunction @p expr.
+		GYNJO_NOINLINE auto walk_or(env_ptr const& env, expr const& expr) -> eval_result {
+			// Get left.
+			auto const left_result = walk(env, expr.child(0));
+			if (!left_result.has_value()) { return left_result; }
+			if (!left_result.value().is<tok::boolean>()) {
+				return tl::unexpected{fmt::format(
+					"cannot take logical disjunction of non-boolean value {}", to_string(left_result.value(), env))};
+			}
+			bool const left = left_result.value().as<tok::boolean>().value;
+			// Short-circuit if possible.
+			if (left) { return tok::boolean{true}; }
+			// Get right.
+			auto const right_result = walk(env, expr.child(1));
+			if (!right_result.has_value()) { return right_result; }
+			if (!right_result.value().is<tok::boolean>()) {
+				return tl::unexpected{fmt::format(
+					"cannot take logical disjunction of non-boolean value {}", to_string(right_result.value(), env))};
+			}
+			auto const right = right_result.value().as<tok::boolean>().value;
+			return tok::boolean{left || right};
 		}
-	}
 
-	auto eval(env_ptr const& env, expr const& node) -> eval_result {
-		return match(
-			node.value,
-			[&](cond const& cond) {
-				return eval(env, *cond.test).and_then([&](val::value const& test_value) -> eval_result {
-					return match(
-						test_value,
-						[&](tok::boolean test) -> eval_result {
-							if (test.value) {
-								return eval(env, *cond.true_expr);
-							} else {
-								return eval(env, *cond.false_expr);
-							}
-						},
-						[&](auto const&) -> eval_result {
-							return tl::unexpected{
-								fmt::format("expected boolean in conditional test, found {}", to_string(test_value, env))};
-						});
-				});
-			},
-			[&](block const& block) -> eval_result {
-				for (stmt const& stmt : (*block.stmts)) {
-					// A return statement exits the block early and produces a value.
-					if (std::holds_alternative<ret>(stmt.value)) {
-						return eval(env, *std::get<ret>(stmt.value).result);
-					}
-					// Otherwise, just execute the statement.
-					auto stmt_result = exec(env, stmt);
-					// Check for error.
-					if (!stmt_result.has_value()) {
-						return tl::unexpected{"in block statement: " + stmt_result.error()};
-					}
-				}
-				// Return nothing if there was no return statement.
-				return val::make_tup();
-			},
-			[&](and_ const& and_) -> eval_result {
-				// Get left.
-				auto const left_result = eval(env, *and_.left);
-				if (!left_result.has_value()) { return left_result; }
-				if (!std::holds_alternative<tok::boolean>(left_result.value())) {
-					return tl::unexpected{fmt::format("cannot take logical conjunction of non-boolean value {}",
-						to_string(left_result.value(), env))};
-				}
-				bool const left = std::get<tok::boolean>(left_result.value()).value;
-				// Short-circuit if possible.
-				if (!left) { return tok::boolean{false}; }
-				// Get right.
-				auto const right_result = eval(env, *and_.right);
-				if (!right_result.has_value()) { return right_result; }
-				if (!std::holds_alternative<tok::boolean>(right_result.value())) {
-					return tl::unexpected{fmt::format("cannot take logical conjunction of non-boolean value {}",
-						to_string(right_result.value(), env))};
+		//! Evaluates the cluster @p expr.
+		GYNJO_NOINLINE auto walk_cluster(env_ptr const& env, expr const& expr, std::optional<deferred_call>* tail)
+			-> eval_result {
+			auto const& tree = *expr.tree;
+			auto const item_nodes = tree.cluster_items(expr.node);
+			std::vector<val::value> items;
+			for (node_id const item_node : item_nodes) {
+				auto item_result = walk(env, gynjo::expr{&tree, item_node});
+				if (item_result.has_value()) {
+					items.push_back(std::move(item_result.value()));
+				} else {
+					return item_result;
 				}
-				auto const right = std::get<tok::boolean>(right_result.value()).value;
-				return tok::boolean{left && right};
-			},
-			[&](or_ const& or_) -> eval_result {
-				// Get left.
-				auto const left_result = eval(env, *or_.left);
-				if (!left_result.has_value()) { return left_result; }
-				if (!std::holds_alternative<tok::boolean>(left_result.value())) {
-					return tl::unexpected{fmt::format("cannot take logical disjunction of non-boolean value {}",
-						to_string(left_result.value(), env))};
+			}
+			return eval_cluster(env, expr, std::move(items), tail);
+		}
+
+		//! Evaluates the tuple @p expr.
+		GYNJO_NOINLINE auto walk_tup(env_ptr const& env, expr const& expr) -> eval_result {
+			auto const& tree = *expr.tree;
+			val::tup tup;
+			for (node_id const elem : tree.child_list(expr.node)) {
+				auto elem_result = walk(env, gynjo::expr{&tree, elem});
+				if (elem_result.has_value()) {
+					tup.elems->push_back(std::move(elem_result.value()));
+				} else {
+					return elem_result;
 				}
-				bool const left = std::get<tok::boolean>(left_result.value()).value;
-				// Short-circuit if possible.
-				if (left) { return tok::boolean{true}; }
-				// Get right.
-				auto const right_result = eval(env, *or_.right);
-				if (!right_result.has_value()) { return right_result; }
-				if (!std::holds_alternative<tok::boolean>(right_result.value())) {
-					return tl::unexpected{fmt::format("cannot take logical disjunction of non-boolean value {}",
-						to_string(right_result.value(), env))};
+			}
+			return tup;
+		}
+
+		//! Evaluates the list @p expr.
+		GYNJO_NOINLINE auto walk_list(env_ptr const& env, expr const& expr) -> eval_result {
+			auto const& tree = *expr.tree;
+			val::value list = val::empty{};
+			for (node_id const elem : tree.child_list(expr.node)) {
+				auto elem_result = walk(env, gynjo::expr{&tree, elem});
+				if (elem_result.has_value()) {
+					list = val::list{std::move(elem_result.value()), std::move(list)};
+				} else {
+					return elem_result;
 				}
-				auto const right = std::get<tok::boolean>(right_result.value()).value;
-				return tok::boolean{left || right};
-			},
-			[&](not_ const& not_) {
-				return eval(env, *not_.expr).and_then([&](val::value const& val) -> eval_result {
-					return match(
-						val,
-						[](tok::boolean b) -> eval_result { return tok::boolean{!b.value}; },
-						[&](auto const&) -> eval_result {
-							return tl::unexpected{fmt::format("cannot take logical negation of {}", to_string(val, env))};
-						});
-				});
-			},
-			[&](eq const& eq) {
-				return eval_binary(env, *eq.left, *eq.right, [](val::value const& left, val::value const& right) -> eval_result {
-					return tok::boolean{left == right};
-				});
-			},
-			[&](neq const& neq) {
-				return eval_binary(env, *neq.left, *neq.right, [](val::value const& left, val::value const& right) -> eval_result {
-					return tok::boolean{left != right};
-				});
-			},
-			[&](approx const& approx) {
-				return eval_binary(
-					env, *approx.left, *approx.right, [&](val::value const& left, val::value const& right) -> eval_result {
-						return tok::boolean{to_string(left, env) == to_string(right, env)};
-					});
-			},
-			[&](lt const& lt) {
-				return eval_binary(env, *lt.left, *lt.right, [&](val::value const& a, val::value const& b) -> eval_result {
-					return match2(
-						a,
-						b,
-						[&](val::num const& left, val::num const& right) -> eval_result {
-							return tok::boolean{left < right};
-						},
-						[&](auto const&, auto const&) -> eval_result {
-							return tl::unexpected{
-								fmt::format("cannot compare {} and {}", to_string(a, env), to_string(b, env))};
-						});
-				});
-			},
-			[&](leq const& leq) {
-				return eval_binary(env, *leq.left, *leq.right, [&](val::value const& a, val::value const& b) -> eval_result {
-					return match2(
-						a,
-						b,
-						[&](val::num const& left, val::num const& right) -> eval_result {
-							return tok::boolean{left <= right};
-						},
-						[&](auto const&, auto const&) -> eval_result {
-							return tl::unexpected{
-								fmt::format("cannot compare {} and {}", to_string(a, env), to_string(b, env))};
-						});
-				});
-			},
-			[&](gt const& gt) {
-				return eval_binary(env, *gt.left, *gt.right, [&](val::value const& a, val::value const& b) -> eval_result {
-					return match2(
-						a,
-						b,
-						[&](val::num const& left, val::num const& right) -> eval_result {
-							return tok::boolean{left > right};
-						},
-						[&](auto const&, auto const&) -> eval_result {
-							return tl::unexpected{
-								fmt::format("cannot compare {} and {}", to_string(a, env), to_string(b, env))};
-						});
-				});
-			},
-			[&](geq const& geq) {
-				return eval_binary(env, *geq.left, *geq.right, [&](val::value const& a, val::value const& b) -> eval_result {
-					return match2(
-						a,
-						b,
-						[&](val::num const& left, val::num const& right) -> eval_result {
-							return tok::boolean{left >= right};
-						},
-						[&](auto const&, auto const&) -> eval_result {
-							return tl::unexpected{
-								fmt::format("cannot compare {} and {}", to_string(a, env), to_string(b, env))};
-						});
-				});
-			},
-			[&](add const& add) {
-				return eval_binary(
-					env, *add.addend1, *add.addend2, [&](val::value const& addend1, val::value const& addend2) -> eval_result {
-						return bin_num_op(
-							env, addend1, addend2, "addition", [](val::num const& addend1, val::num const& addend2) -> eval_result {
-								return addend1 + addend2;
+			}
+			return list;
+		}
+
+		//! Evaluates @p expr by walking its syntax tree.
+		//! @param tail If not null, a call in tail position is stored here instead of being made. See eval_cluster.
+		auto walk(env_ptr const& env, expr const& expr, std::optional<deferred_call>* tail) -> eval_result {
+			// Each call and each level of nesting recurses, so the native stack bounds how deep calls can nest.
+			if (out_of_stack()) { return out_of_stack_error(); }
+			auto const& tree = *expr.tree;
+			auto const node = expr.node;
+			switch (expr.kind()) {
+				case node_kind::cond:
+					return walk(env, expr.child(0)).and_then([&](val::value const& test_value) -> eval_result {
+						return match(
+							test_value,
+							[&](tok::boolean test) -> eval_result {
+								if (test.value) {
+									return walk(env, expr.child(1), tail);
+								} else {
+									return walk(env, expr.child(2), tail);
+								}
+							},
+							[&](auto const&) -> eval_result {
+								return tl::unexpected{
+									fmt::format("expected boolean in conditional test, found {}", to_string(test_value, env))};
 							});
 					});
-			},
-			[&](sub const& sub) {
-				return eval_binary(
-					env, *sub.minuend, *sub.subtrahend, [&](val::value const& minuend, val::value const& subtrahend) -> eval_result {
-						return bin_num_op(
-							env, minuend, subtrahend, "subtraction", [](val::num const& minuend, val::num const& subtrahend) -> eval_result {
-								return minuend - subtrahend;
+				case node_kind::block:
+					return walk_block(env, expr, tail);
+				case node_kind::and_:
+					return walk_and(env, expr);
+				case node_kind::or_:
+					return walk_or(env, expr);
+				case node_kind::not_:
+					return walk(env, expr.child(0)).and_then([&](val::value const& val) -> eval_result {
+						return match(
+							val,
+							[](tok::boolean b) -> eval_result { return tok::boolean{!b.value}; },
+							[&](auto const&) -> eval_result {
+								return tl::unexpected{fmt::format("cannot take logical negation of {}", to_string(val, env))};
 							});
 					});
-			},
-			[&](cluster const& cluster) -> eval_result {
-				std::vector<val::value> items;
-				for (auto const& item_ast : *(cluster.items)) {
-					auto item_result = eval(env, item_ast);
-					if (item_result.has_value()) {
-						items.push_back(std::move(item_result.value()));
+				case node_kind::eq:
+				case node_kind::neq:
+				case node_kind::approx:
+				case node_kind::lt:
+				case node_kind::leq:
+				case node_kind::gt:
+				case node_kind::geq:
+				case node_kind::add:
+				case node_kind::sub:
+				case node_kind::pow:
+				case node_kind::mul:
+				case node_kind::div:
+				case node_kind::sqrt:
+				case node_kind::int_pow:
+					return walk_binary(env, expr.child(0), expr.child(1), [&](val::value const& left, val::value const& right) {
+						return binary_op(expr.kind(), env, left, right);
+					});
+				case node_kind::neg:
+					return walk(env, expr.child(0)).and_then([&](val::value const& val) { return negate(env, val); });
+				case node_kind::cluster:
+					return walk_cluster(env, expr, tail);
+				case node_kind::lambda:
+					return val::closure{expr, std::make_shared<environment>(env), tree.shared_from_this()};
+				case node_kind::tup:
+					return walk_tup(env, expr);
+				case node_kind::list:
+					return walk_list(env, expr);
+				case node_kind::boolean:
+					return tok::boolean{tree.boolean(node)};
+				case node_kind::num:
+					return tree.number(node);
+				case node_kind::str:
+					return std::string{tree.literal(node)};
+				case node_kind::sym: {
+					auto const name = tree.symbol(node);
+					if (auto const value = env->lookup(name)) {
+						return *value;
 					} else {
-						return item_result;
+						return tl::unexpected{undefined_error(name)};
 					}
 				}
-				auto connectors = cluster.connectors;
-
-				// Common functionality of the two function application evaluation loops.
-				// Returns an error string if something went wrong or nullopt otherwise.
-				auto do_applications = [&](cluster::connector connector) -> std::optional<std::string> {
-					for (std::size_t i = 0; i < connectors.size();) {
-						if (connectors[i] == connector && std::holds_alternative<val::closure>(items[i])) {
-							auto const& f = items[i];
-							// Apply negation if necessary.
-							if (cluster.negations[i + 1]) {
-								auto negate_result = negate(env, items[i + 1]);
-								if (negate_result.has_value()) {
-									items[i + 1] = negate_result.value();
-								} else {
-									return negate_result.error();
-								}
-							}
-							auto const& arg = items[i + 1];
-							// Apply function.
-							auto result = std::holds_alternative<val::tup>(arg)
-								// Argument is already a tuple.
-								? application(std::get<val::closure>(f), std::get<val::tup>(arg))
-								// Wrap argument in a tuple.
-								: application(std::get<val::closure>(f), val::make_tup(arg));
-							if (result.has_value()) {
-								items[i] = std::move(result.value());
-								// Erase consumed item.
-								items.erase(items.begin() + i + 1);
-								connectors.erase(connectors.begin() + i);
-							} else {
-								return result.error();
-							}
-						} else {
-							++i;
-						}
+				default:
+					return tl::unexpected{"cannot evaluate imperative statement: " + to_string(expr)};
+			}
+		}
+
+		//! Executes @p stmt by walking its syntax tree.
+		auto walk(env_ptr const& env, stmt const& stmt) -> exec_result {
+			auto const& tree = *stmt.tree;
+			auto const node = stmt.node;
+			switch (stmt.kind()) {
+				case node_kind::nop:
+					return std::monostate();
+				case node_kind::imp:
+					return import_module(env, tree.literal(node));
+				case node_kind::assign: {
+					auto rhs_result = walk(env, stmt.expr_child(1));
+					// Check for error in RHS.
+					if (!rhs_result.has_value()) { return tl::unexpected{"in RHS of assignment: " + rhs_result.error()}; }
+					// If the symbol is undefined, initialize it to empty. This allows recursive functions.
+					auto const name = tree.symbol(tree.child(node, 0));
+					env->local_vars.try_emplace(name, val::empty{});
+					// Now perform the actual assignment, overwriting whatever's there.
+					env->local_vars.insert_or_assign(name, std::move(rhs_result.value()));
+					return std::monostate{};
+				}
+				case node_kind::branch: {
+					auto test_result = walk(env, stmt.expr_child(0));
+					if (!test_result.has_value()) {
+						return tl::unexpected{"in branch test expression: " + test_result.error()};
 					}
-					return std::nullopt;
-				};
-
-				// Do parenthesized function applications.
-				if (auto error = do_applications(cluster::connector::adj_paren)) { return tl::unexpected{*error}; }
-				// Do exponentiations.
-				for (std::ptrdiff_t i = connectors.size() - 1; i >= 0; --i) {
-					if (connectors[i] == cluster::connector::exp) {
-						auto const& base = items[i];
-						// Apply negation if necessary.
-						if (cluster.negations[i + 1]) {
-							auto negate_result = negate(env, items[i + 1]);
-							if (negate_result.has_value()) {
-								items[i + 1] = negate_result.value();
+					return match(
+						test_result.value(),
+						[&](tok::boolean test) -> exec_result {
+							if (test.value) {
+								return walk(env, stmt.stmt_child(1));
 							} else {
-								return negate_result;
+								return walk(env, stmt.stmt_child(2));
 							}
+						},
+						[&](auto const&) -> exec_result {
+							return tl::unexpected{fmt::format(
+								"expected boolean in conditional test, found {}", to_string(test_result.value(), env))};
+						});
+				}
+				case node_kind::while_loop: {
+					auto const test_expr = stmt.expr_child(0);
+					auto const body = stmt.stmt_child(1);
+					for (;;) {
+						// Evaluate the test condition.
+						auto test_result = walk(env, test_expr);
+						// Check for error in the test expression.
+						if (!test_result.has_value()) {
+							return tl::unexpected{"in while-loop test expression: " + test_result.error()};
 						}
-						auto const& exp = items[i + 1];
-						auto power = bin_num_op(
-							env, base, exp, "exponentiation", [](val::num const& base, val::num const& exponent) -> eval_result {
-								return boost::multiprecision::pow(base, exponent);
-							});
-						if (power.has_value()) {
-							items[i] = std::move(power.value());
-							items.erase(items.begin() + i + 1);
-							connectors.erase(connectors.begin() + i);
+						// Check for non-boolean in the test expression.
+						if (!test_result.value().is<tok::boolean>()) {
+							return tl::unexpected{
+								"while-loop test value must be boolean, found " + to_string(test_result.value(), env)};
+						}
+						auto const test = test_result.value().as<tok::boolean>();
+						if (test.value) {
+							// Execute next iteration.
+							auto body_result = walk(env, body);
+							// Check for error in body.
+							if (!body_result.has_value()) { return body_result; }
 						} else {
-							return power;
+							// End of loop.
+							return std::monostate{};
 						}
-					} else {
-						--i;
 					}
 				}
-				// Do non-parenthesized function applications.
-				if (auto error = do_applications(cluster::connector::adj_nonparen)) { return tl::unexpected{*error}; }
-				// Do multiplication and division.
-				for (std::size_t i = 0; i < connectors.size();) {
-					switch (connectors[i]) {
-						case cluster::connector::adj_paren:
-							[[fallthrough]];
-						case cluster::connector::adj_nonparen:
-							[[fallthrough]];
-						case cluster::connector::mul: {
-							auto const& factor1 = items[i];
-							// Apply negation if necessary.
-							if (cluster.negations[i + 1]) {
-								auto negate_result = negate(env, items[i + 1]);
-								if (negate_result.has_value()) {
-									items[i + 1] = negate_result.value();
-								} else {
-									return negate_result;
+				case node_kind::for_loop: {
+					auto range_result = walk(env, stmt.expr_child(1));
+					if (!range_result.has_value()) { return tl::unexpected{range_result.error()}; }
+					auto const loop_var = tree.symbol(tree.child(node, 0));
+					auto const body = stmt.stmt_child(2);
+					return match(
+						range_result.value(),
+						[](val::empty) -> exec_result { return std::monostate{}; },
+						[&](val::list const& list) -> exec_result {
+							val::list const* current = &list;
+							for (;;) {
+								// Assign the loop variable to the current value in the range list.
+								env->local_vars[loop_var] = current->head;
+								// Execute the loop body in this context.
+								auto body_result = walk(env, body);
+								// Check for error in body.
+								if (!body_result.has_value()) {
+									return tl::unexpected{"in body of for-loop: " + body_result.error()};
 								}
-							}
-							auto const& factor2 = items[i + 1];
-							auto product = bin_num_op(
-								env, factor1, factor2, "multiplication", [](val::num const& factor1, val::num const& factor2) -> eval_result {
-									return factor1 * factor2;
-								});
-							if (product.has_value()) {
-								items[i] = std::move(product.value());
-								items.erase(items.begin() + i + 1);
-								connectors.erase(connectors.begin() + i);
-							} else {
-								return product;
-							}
-							break;
-						}
-						default: {
-							// Division is the only remaining possibility.
-							auto const& dividend = items[i];
-							// Apply negation if necessary.
-							if (cluster.negations[i + 1]) {
-								auto negate_result = negate(env, items[i + 1]);
-								if (negate_result.has_value()) {
-									items[i + 1] = negate_result.value();
+								// Iterate.
+								if (current->tail.is<val::list>()) {
+									// Move to the next range element.
+									current = &current->tail.as<val::list>();
 								} else {
-									return negate_result;
+									// End of the range.
+									break;
 								}
 							}
-							auto const& divisor = items[i + 1];
-							auto quotient = bin_num_op(
-								env, dividend, divisor, "division", [](val::num const& dividend, val::num const& divisor) -> eval_result {
-									if (divisor == 0) { return tl::unexpected{"division by zero"s}; }
-									return dividend / divisor;
-								});
-							if (quotient.has_value()) {
-								items[i] = std::move(quotient.value());
-								items.erase(items.begin() + i + 1);
-								connectors.erase(connectors.begin() + i);
-							} else {
-								return quotient;
-							}
-						}
-					}
-				}
-				// At this point, all values should be folded into the front of items.
-				// Apply final negation if necessary.
-				if (cluster.negations.front()) {
-					auto negate_result = negate(env, items.front());
-					if (negate_result.has_value()) {
-						items.front() = negate_result.value();
-					} else {
-						return negate_result;
-					}
-				}
-				return items.front();
-			},
-			[&](lambda const& f) -> eval_result {
-				return val::closure{f, std::make_shared<environment>(env)};
-			},
-			[&](tup_expr const& tup_expr) -> eval_result {
-				val::tup tup;
-				for (auto const& elem_expr : *tup_expr.elems) {
-					auto elem_result = eval(env, elem_expr);
-					if (elem_result.has_value()) {
-						tup.elems->push_back(std::move(elem_result.value()));
-					} else {
-						return elem_result;
-					}
+							return std::monostate{};
+						},
+						[&](auto const&) -> exec_result {
+							return tl::unexpected{fmt::format("expected a list, found {}", to_string(range_result.value(), env))};
+						});
 				}
-				return tup;
-			},
-			[&](list_expr const& list_expr) -> eval_result {
-				val::value list = val::empty{};
-				for (auto const& elem_expr : *(list_expr.elems)) {
-					auto elem_result = eval(env, elem_expr);
-					if (elem_result.has_value()) {
-						list = val::list{val::make_value(std::move(elem_result.value())), val::make_value(std::move(list))};
-					} else {
-						return elem_result;
+				case node_kind::ret:
+					return tl::unexpected{"cannot return outside statement block"s};
+				case node_kind::expr_stmt: {
+					auto eval_result = walk(env, stmt.expr_child(0));
+					if (!eval_result.has_value()) { return tl::unexpected{eval_result.error()}; }
+					// Expression statements must evaluate to nothing.
+					if (eval_result.value() != val::value{val::make_tup()}) {
+						return tl::unexpected{"unused expression result: " + to_string(eval_result.value(), env)};
 					}
+					return std::monostate{};
 				}
-				return list;
-			},
-			[](tok::boolean const& b) -> eval_result { return b; },
-			[](tok::num const& num) -> eval_result { return val::num{num.rep}; },
-			[](std::string const& str) -> eval_result { return str; },
-			[&](tok::sym const& sym) -> eval_result {
-				if (auto lookup = env->lookup(sym.name)) {
-					return *lookup;
-				} else {
-					return tl::unexpected{fmt::format("'{}' is undefined", sym.name)};
+				default: {
+					// Any other node is an expression, which isn't a statement.
+					return tl::unexpected{"cannot execute expression: " + to_string(stmt)};
 				}
-			},
-			[&](auto const&) -> eval_result {
-				return tl::unexpected{"cannot evaluate imperative statement: " + to_string(node)};
-			});
+			}
+		}
+	}
+
+	auto walk_call(val::closure c, val::tup arg) -> eval_result {
+		if (call_depth >= selected_max_depth) { return tl::unexpected{max_depth_error(selected_max_depth)}; }
+		if (stack_floor == 0) { stack_floor = stack_limit(stack_reserve); }
+		++call_depth;
+		struct depth_guard {
+			~depth_guard() {
+				--call_depth;
+			}
+		} const guard;
+		for (;;) {
+			auto const local_env = call_env(c, std::move(arg), nullptr);
+			if (!local_env.has_value()) { return tl::unexpected{local_env.error()}; }
+			std::optional<deferred_call> tail;
+			auto result = walk(local_env.value(), c.f.child(1), &tail);
+			if (!tail.has_value()) { return result; }
+			// Replace this call with the tail call.
+			c = std::move(tail->f);
+			arg = std::move(tail->arg);
+		}
+	}
+
+	auto set_engine(engine e) -> void {
+		selected_engine = e;
+	}
+
+	auto current_engine() -> engine {
+		return selected_engine;
+	}
+
+	auto set_max_depth(std::size_t depth) -> void {
+		selected_max_depth = depth;
+	}
+
+	auto max_depth() -> std::size_t {
+		return selected_max_depth;
+	}
+
+	auto set_inference(bool enabled) -> void {
+		selected_inference = enabled;
+	}
+
+	auto inference_enabled() -> bool {
+		return selected_inference;
+	}
+
+	auto set_optimization(bool enabled) -> void {
+		selected_optimization = enabled;
+	}
+
+	auto optimization_enabled() -> bool {
+		return selected_optimization;
+	}
+
+	auto prepare(ast& tree, node_id first) -> void {
+		if (selected_inference) {
+			// Optimize as inference goes, so that resolved clusters are optimized before their parents.
+			resolve_clusters(tree, first, selected_optimization ? optimize_node : nullptr);
+		} else if (selected_optimization) {
+			optimize(tree, first);
+		}
+	}
+
+	auto eval(env_ptr const& env, expr const& expr) -> eval_result {
+		if (selected_engine == engine::vm) { return run(env, compile(expr)); }
+		return walk(env, expr);
 	}
 
 	auto eval(env_ptr const& env, std::string_view input) -> eval_result {
@@ -533,143 +502,112 @@ namespace gynjo {
 		if (!lex_result.has_value()) { return tl::unexpected{"(lex error) " + lex_result.error()}; }
 		auto tokens = std::move(lex_result.value());
 		// Parse.
-		auto const parse_result = parse_expr(tokens.begin(), tokens.end());
+		auto const tree = ast::make();
+		auto const parse_result = parse_expr(*tree, tokens.begin(), tokens.end());
 		if (!parse_result.has_value()) { return tl::unexpected{"(parse error) " + parse_result.error()}; }
 		auto const expr_end = parse_result.value().it;
 		if (expr_end != tokens.end()) {
 			return tl::unexpected{"(parse_error) unused tokens starting at " + to_string(*expr_end)};
 		}
+		prepare(*tree);
 		// Evaluate.
 		return eval(env, parse_result.value().expr);
 	}
 
 	auto exec(env_ptr const& env, stmt const& stmt) -> exec_result {
-		return match(
-			stmt.value,
-			[](nop) -> exec_result { return std::monostate(); },
-			[&](imp const& imp) -> exec_result {
-				std::ifstream fin{imp.filename};
-				if (!fin.is_open()) {
-					return tl::unexpected{fmt::format("failed to load library \"{}\"", imp.filename)};
-				}
-				std::stringstream ss;
-				ss << fin.rdbuf();
-				return exec(env, ss.str());
-			},
-			[&](assign const& assign) -> exec_result {
-				auto rhs_result = eval(env, *assign.rhs);
-				// Check for error in RHS.
-				if (!rhs_result.has_value()) { return tl::unexpected{"in RHS of assignment: " + rhs_result.error()}; }
-				// If the symbol is undefined, initialize it to empty. This allows recursive functions.
-				env->local_vars.emplace(assign.symbol.name, val::empty{});
-				// Now perform the actual assignment, overwriting whatever's there.
-				env->local_vars.insert_or_assign(assign.symbol.name, std::move(rhs_result.value()));
-				return std::monostate{};
-			},
-			[&](branch const& branch) -> exec_result {
-				auto test_result = eval(env, *branch.test);
-				if (!test_result.has_value()) {
-					return tl::unexpected{"in branch test expression: " + test_result.error()};
-				}
-				return match(
-					test_result.value(),
-					[&](tok::boolean test) -> exec_result {
-						if (test.value) {
-							return exec(env, *branch.true_stmt);
-						} else {
-							return exec(env, *branch.false_stmt);
-						}
-					},
-					[&](auto const&) -> exec_result {
-						return tl::unexpected{fmt::format(
-							"expected boolean in conditional test, found {}", to_string(test_result.value(), env))};
-					});
-			},
-			[&](while_loop const& loop) -> exec_result {
-				for (;;) {
-					// Evaluate the test condition.
-					auto test_result = eval(env, *loop.test);
-					// Check for error in the test expression.
-					if (!test_result.has_value()) {
-						return tl::unexpected{"in while-loop test expression: " + test_result.error()};
-					}
-					// Check for non-boolean in the test expression.
-					if (!std::holds_alternative<tok::boolean>(test_result.value())) {
-						return tl::unexpected{
-							"while-loop test value must be boolean, found " + to_string(test_result.value(), env)};
-					}
-					auto const test = std::get<tok::boolean>(test_result.value());
-					if (test.value) {
-						// Execute next iteration.
-						auto body_result = exec(env, *loop.body);
-						// Check for error in body.
-						if (!body_result.has_value()) { return body_result; }
-					} else {
-						// End of loop.
-						return std::monostate{};
-					}
-				}
-			},
-			[&](for_loop const& loop) -> exec_result {
-				auto range_result = eval(env, *loop.range);
-				if (!range_result.has_value()) { return tl::unexpected{range_result.error()}; }
-				return match(
-					range_result.value(),
-					[](val::empty) -> exec_result { return std::monostate{}; },
-					[&](val::list const& list) -> exec_result {
-						auto current = list;
-						for (;;) {
-							// Assign the loop variable to the current value in the range list.
-							env->local_vars[loop.loop_var.name] = *current.head;
-							// Execute the loop body in this context.
-							auto body_result = exec(env, *loop.body);
-							// Check for error in body.
-							if (!body_result.has_value()) {
-								return tl::unexpected{"in body of for-loop: " + body_result.error()};
-							}
-							// Iterate.
-							if (std::holds_alternative<val::list>(*current.tail)) {
-								// Move to the next range element.
-								current = std::get<val::list>(*current.tail);
-							} else {
-								// End of the range.
-								break;
-							}
-						}
-						return std::monostate{};
-					},
-					[&](auto const&) -> exec_result {
-						return tl::unexpected{fmt::format("expected a list, found {}", to_string(range_result.value(), env))};
-					});
-			},
-			[&](ret const&) -> exec_result { return tl::unexpected{"cannot return outside statement block"s}; },
-			[&](expr_stmt const& expr_stmt) -> exec_result {
-				auto eval_result = eval(env, *expr_stmt.expr);
-				if (!eval_result.has_value()) { return tl::unexpected{eval_result.error()}; }
-				// Expression statements must evaluate to nothing.
-				if (eval_result.value() != val::value{val::make_tup()}) {
-					return tl::unexpected{"unused expression result: " + to_string(eval_result.value(), env)};
+		if (selected_engine == engine::vm) {
+			return run(env, compile(stmt)).map([](val::value const&) { return std::monostate{}; });
+		}
+		return walk(env, stmt);
+	}
+
+	namespace {
+		//! Parses and executes statements from the tokens @p begin to @p end in the context of @p env.
+		//! @param tree Stores the parsed statements. Closures created by executing them keep it alive.
+		//! @param final Whether @p end is the end of the input. If not, execution stops before any statement that more
+		//! tokens could extend or complete.
+		//! @return An iterator to the first unexecuted token, or an error message.
+		auto exec_tokens(env_ptr const& env, ast& tree, token_it begin, token_it end, bool final)
+			-> tl::expected<token_it, std::string> {
+			auto it = begin;
+			while (it != end) {
+				// Parse.
+				auto const first = static_cast<node_id>(tree.size());
+				auto const parse_result = parse_stmt(tree, it, end);
+				if (!parse_result.has_value()) {
+					// The error might be due to missing tokens.
+					if (!final) { break; }
+					return tl::unexpected{"(parse error) " + parse_result.error()};
 				}
-				return std::monostate{};
-			});
+				if (!final && !stmt_is_final(parse_result.value().it, end)) { break; }
+				it = parse_result.value().it;
+				prepare(tree, first);
+				// Execute.
+				auto exec_result = exec(env, parse_result.value().stmt);
+				if (!exec_result.has_value()) { return tl::unexpected{"(runtime error) " + exec_result.error()}; }
+			}
+			return it;
+		}
 	}
 
 	auto exec(env_ptr const& env, std::string_view input) -> exec_result {
 		// Lex.
 		lex_result const lex_result = lex(input);
 		if (!lex_result.has_value()) { return tl::unexpected{"(lex error) " + lex_result.error()}; }
-		// While there is still input left, parse and execute.
-		auto it = lex_result.value().begin();
-		auto end = lex_result.value().end();
-		while (it != end) {
-			// Parse.
-			auto const parse_result = parse_stmt(it, end);
-			if (!parse_result.has_value()) { return tl::unexpected{"(parse error) " + parse_result.error()}; }
-			it = parse_result.value().it;
-			// Execute.
-			auto exec_result = exec(env, parse_result.value().stmt);
-			if (!exec_result.has_value()) { return tl::unexpected{"(runtime error) " + exec_result.error()}; }
+		// Parse and execute.
+		auto const& tokens = lex_result.value();
+		return exec_tokens(env, *ast::make(), tokens.begin(), tokens.end(), true).map([](token_it) { return std::monostate{}; });
+	}
+
+	auto exec(env_ptr const& env, std::istream& input, std::size_t chunk_size) -> exec_result {
+		chunked_lexer lexer;
+		std::vector<tok::token> tokens;
+		std::string chunk(chunk_size, '\0');
+		// Statements that don't parse yet are retried only once the pending tokens double, keeping the total parsing work
+		// linear in the length of long statements.
+		std::size_t retry_size = 0;
+		for (bool final = false; !final;) {
+			// Lex the next chunk.
+			input.read(chunk.data(), static_cast<std::streamsize>(chunk_size));
+			auto const count = static_cast<std::size_t>(input.gcount());
+			final = count < chunk_size;
+			auto lex_result = lexer.feed(std::string_view{chunk.data(), count}, tokens);
+			if (lex_result.has_value() && final) { lex_result = lexer.finish(tokens); }
+			if (!lex_result.has_value()) { return tl::unexpected{"(lex error) " + lex_result.error()}; }
+			if (!final && tokens.size() < retry_size) { continue; }
+			// Parse and execute whatever statements are complete.
+			auto const exec_result = exec_tokens(env, *ast::make(), tokens.begin(), tokens.end(), final);
+			if (!exec_result.has_value()) { return tl::unexpected{exec_result.error()}; }
+			tokens.erase(tokens.cbegin(), exec_result.value());
+			retry_size = 2 * tokens.size();
 		}
 		return std::monostate{};
 	}
+
+	auto interpret(env_ptr const& env, std::vector<tok::token> const& tokens) -> interpret_result {
+		auto const end = tokens.end();
+		auto const tree = ast::make();
+		auto parse_result = parse_expr_or_stmt(*tree, tokens.begin(), end);
+		if (!parse_result.has_value()) { return tl::unexpected{"(parse error) " + parse_result.error()}; }
+		prepare(*tree);
+		return match(
+			parse_result.value(),
+			[&](it_expr const& expr_result) -> interpret_result {
+				return eval(env, expr_result.expr).map([](val::value value) { return std::make_optional(std::move(value)); });
+			},
+			[&](it_stmt const& stmt_result) -> interpret_result {
+				// Execute the first statement and then any others.
+				auto const exec_result = exec(env, stmt_result.stmt);
+				if (!exec_result.has_value()) { return tl::unexpected{"(runtime error) " + exec_result.error()}; }
+				return exec_tokens(env, *tree, stmt_result.it, end, true).map([](token_it) {
+					return std::optional<val::value>{};
+				});
+			});
+	}
+
+	auto interpret(env_ptr const& env, std::string_view input) -> interpret_result {
+		lex_result const lex_result = lex(input);
+		if (!lex_result.has_value()) { return tl::unexpected{"(lex error) " + lex_result.error()}; }
+		return interpret(env, lex_result.value());
+	}
 }
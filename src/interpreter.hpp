@@ -9,6 +9,10 @@
 
 #include <tl/expected.hpp>
 
+#include <cstddef>
+#include <istream>
+#include <optional>
+
 namespace gynjo {
 	//! Result of evaluation: either a Gynjo value or an error message.
 	using eval_result = tl::expected<val::value, std::string>;
@@ -16,6 +20,51 @@ namespace gynjo {
 	//! Result of execution: either a @p std::monostate or an error message.
 	using exec_result = tl::expected<std::monostate, std::string>;
 
+	//! Result of interpretation: the value of an expression, nothing for statements, or an error message.
+	using interpret_result = tl::expected<std::optional<val::value>, std::string>;
+
+	//! Strategies for evaluating parsed code.
+	enum class engine {
+		//! Evaluates syntax trees directly.
+		tree_walker,
+		//! Compiles syntax trees to bytecode and runs it on a virtual machine.
+		vm,
+	};
+
+	//! Selects the engine that eval and exec use from now on. The default is the tree walker.
+	auto set_engine(engine e) -> void;
+
+	//! The engine that eval and exec use.
+	auto current_engine() -> engine;
+
+	//! The default maximum depth of nested function calls. Calls in tail position don't nest.
+	constexpr std::size_t default_max_depth = 100'000;
+
+	//! Sets the maximum depth of nested function calls. Exceeding it is an error.
+	//! @note The tree walker nests native calls for each Gynjo call, so it also stops with an error when the native stack
+	//! runs low, which on an 8 MiB stack is after several thousand calls. The VM keeps its calls on the heap.
+	auto set_max_depth(std::size_t depth) -> void;
+
+	//! The maximum depth of nested function calls.
+	auto max_depth() -> std::size_t;
+
+	//! Sets whether parsed code is passed through static type inference before it's run, resolving the order of
+	//! operations of clusters where possible (see resolve_clusters). The default is true.
+	auto set_inference(bool enabled) -> void;
+
+	//! Whether parsed code is passed through static type inference before it's run.
+	auto inference_enabled() -> bool;
+
+	//! Sets whether parsed code is optimized before it's run, by folding constants and simplifying operations (see
+	//! optimize_node). The default is true.
+	auto set_optimization(bool enabled) -> void;
+
+	//! Whether parsed code is optimized before it's run.
+	auto optimization_enabled() -> bool;
+
+	//! Runs the enabled static passes over the nodes of @p tree from @p first on, which must be newly parsed.
+	auto prepare(ast& tree, node_id first = 0) -> void;
+
 	//! If possible, computes the value of @p expr in the context of @env.
 	auto eval(env_ptr const& env, expr const& expr) -> eval_result;
 
@@ -27,4 +76,16 @@ namespace gynjo {
 
 	//! If possible, executes the statements contained in @p input in the context of @env.
 	auto exec(env_ptr const& env, std::string_view input) -> exec_result;
+
+	//! If possible, executes the statements read from @p input in the context of @env.
+	//! @note Input is read @p chunk_size characters at a time, and each statement is executed as soon as it's parsed, so
+	//! memory use depends on the size of the largest statement rather than the size of the input.
+	auto exec(env_ptr const& env, std::istream& input, std::size_t chunk_size = 4096) -> exec_result;
+
+	//! If possible, evaluates @p tokens as an expression if they form one or else executes them as statements, in the
+	//! context of @p env. This is how the REPL interprets each line of input.
+	auto interpret(env_ptr const& env, std::vector<tok::token> const& tokens) -> interpret_result;
+
+	//! If possible, interprets @p input in the context of @p env. See the overload taking a vector of tokens.
+	auto interpret(env_ptr const& env, std::string_view input) -> interpret_result;
 }
@@ -16,6 +16,10 @@ namespace gynjo {
 				return "print";
 			case intrinsic::read:
 				return "read";
+			case intrinsic::fact:
+				return "fact";
+			case intrinsic::nCk:
+				return "nCk";
 			default:
 				// unreachable
 				return "unknown";
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 namespace gynjo {
@@ -14,9 +15,15 @@ namespace gynjo {
 		push,
 		// I/O
 		print,
-		read
+		read,
+		// Combinatorics
+		fact,
+		nCk
 	};
 
+	//! The number of intrinsic functions.
+	constexpr std::uint32_t intrinsic_count = static_cast<std::uint32_t>(intrinsic::nCk) + 1;
+
 	//! The user-readable name of intrinsic function @p f.
 	auto name(intrinsic f) -> std::string;
 }
@@ -3,121 +3,424 @@
 
 #include "lexer.hpp"
 
+#include "simd.hpp"
 #include "visitation.hpp"
 
 #include <fmt/format.h>
 
-#include <functional>
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <optional>
-#include <regex>
 
 namespace gynjo {
 	namespace {
 		// For a little brevity...
 		using sv = std::string_view;
-		using str_to_tok_t = std::function<std::optional<tok::token>(sv)>;
-		constexpr auto flags = std::regex::ECMAScript | std::regex::optimize;
+		using sv_it = sv::const_iterator;
 
-		//! Handles the simplest regex/str_to_tok_t cases.
-		auto simple(std::string regex, std::optional<tok::token> token) {
-			return std::pair{std::regex{regex, flags}, [token](sv) { return token; }};
+		//! Character classes used by the scanner, as bit flags.
+		enum char_class : std::uint8_t {
+			//! Whitespace, in the sense of the ECMAScript "\s" character class.
+			space = 1 << 0,
+			//! A line terminator, i.e. a character not matched by the ECMAScript "." character class.
+			line_end = 1 << 1,
+			//! A decimal digit.
+			digit = 1 << 2,
+			//! An ASCII letter.
+			alpha = 1 << 3,
+			//! The underscore, which with letters and digits makes up the ECMAScript "\w" character class.
+			underscore = 1 << 4,
+		};
+
+		//! The classes of each character, indexed by unsigned character value.
+		constexpr auto char_classes = [] {
+			std::array<std::uint8_t, 256> result{};
+			for (unsigned char c : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+				result[c] |= space;
+			}
+			result['\n'] |= line_end;
+			result['\r'] |= line_end;
+			for (unsigned char c = '0'; c <= '9'; ++c) {
+				result[c] |= digit;
+			}
+			for (unsigned char c = 'a'; c <= 'z'; ++c) {
+				result[c] |= alpha;
+				result[c - 'a' + 'A'] |= alpha;
+			}
+			result['_'] |= underscore;
+			return result;
+		}();
+
+		//! Whether @p c belongs to any of the character classes in @p classes.
+		constexpr auto is(char c, std::uint8_t classes) -> bool {
+			return (char_classes[static_cast<unsigned char>(c)] & classes) != 0;
+		}
+
+		//! Whether @p c is whitespace.
+		auto is_space(char c) -> bool {
+			return is(c, space);
+		}
+
+		//! Whether @p c is a line terminator.
+		auto is_line_end(char c) -> bool {
+			return is(c, line_end);
+		}
+
+		//! Whether @p c is a decimal digit.
+		auto is_digit(char c) -> bool {
+			return is(c, digit);
+		}
+
+		//! Whether @p c is an ASCII letter.
+		auto is_alpha(char c) -> bool {
+			return is(c, alpha);
+		}
+
+		//! Whether @p c is a word character, in the sense of the ECMAScript "\w" character class.
+		auto is_word(char c) -> bool {
+			return is(c, alpha | digit | underscore);
+		}
+
+		//! Returns an iterator to the first character in [@p it, @p end) that doesn't satisfy @p pred.
+		template <typename Pred>
+		auto skip_while(sv_it it, sv_it end, Pred pred) -> sv_it {
+			while (it != end && pred(*it)) {
+				++it;
+			}
+			return it;
 		}
 
-		//! Handles the reserved-word-based regex/str_to_tok_t cases.
-		auto reserved(std::string word, tok::token token) {
-			return std::pair{std::regex{word + "(?![a-zA-Z])", flags}, [token](sv) { return token; }};
+		//! Like skip_while, but scans long runs with the vectorized @p kernel. Most runs in source code are short, so the
+		//! first few characters are checked inline to avoid the cost of calling the kernel.
+		template <typename Pred>
+		auto skip_run(sv_it it, sv_it end, Pred pred, char const* (*kernel)(char const*, char const*)) -> sv_it {
+			constexpr int inline_length = 4;
+			for (int i = 0; i < inline_length; ++i) {
+				if (it == end || !pred(*it)) { return it; }
+				++it;
+			}
+			if (it == end) { return it; }
+			auto const first = &*it;
+			return it + (kernel(first, first + (end - it)) - first);
 		}
 
-		std::initializer_list<std::pair<std::regex, str_to_tok_t>> const regexes_to_tokens = {
-			// Whitespace (ignored)
-			simple(R"...(\s+)...", std::nullopt),
-			// Comment (ignored)
-			simple(R"...(//.*)...", std::nullopt),
-			// Operators/separators
-			simple(R"...(=)...", tok::eq{}),
-			simple(R"...(!=)...", tok::neq{}),
-			simple(R"...(~)...", tok::approx{}),
-			simple(R"...(<=)...", tok::leq{}),
-			simple(R"...(<)...", tok::lt{}),
-			simple(R"...(>=)...", tok::geq{}),
-			simple(R"...(>)...", tok::gt{}),
-			simple(R"...(\+)...", tok::plus{}),
-			simple(R"...(->)...", tok::arrow{}),
-			simple(R"...(-)...", tok::minus{}),
-			simple(R"...((\*\*)|\^)...", tok::exp{}),
-			simple(R"...(\*)...", tok::mul{}),
-			simple(R"...(/)...", tok::div{}),
-			simple(R"...(\()...", tok::lparen{}),
-			simple(R"...(\))...", tok::rparen{}),
-			simple(R"...(\[)...", tok::lsquare{}),
-			simple(R"...(\])...", tok::rsquare{}),
-			simple(R"...(\{)...", tok::lcurly{}),
-			simple(R"...(\})...", tok::rcurly{}),
-			simple(R"...(,)...", tok::com{}),
-			simple(R"...(;)...", tok::semicolon{}),
-			simple(R"...(\?)...", tok::que{}),
-			simple(R"...(:)...", tok::colon{}),
+		//! A word that lexes as a keyword, intrinsic, or boolean instead of a symbol.
+		struct reserved_word {
+			sv spelling;
+			tok::token token;
+		};
+
+		constexpr std::array reserved_words{
 			// Value literals
-			{std::regex{R"...((\.\d+)|(0|[1-9]\d*)(\.\d+)?)...", flags}, [](sv sv) { return tok::num{sv.data()}; }},
-			reserved("true", tok::boolean{true}),
-			reserved("false", tok::boolean{false}),
-			{std::regex{R"...("([^"\\]|\\["\\])*")..."},
-				[](sv sv) {
-					// Strip quotes and escape characters.
-					std::string result;
-					for (auto it = sv.begin() + 1; it != sv.end() - 1; ++it) {
-						if (*it == '\\') { ++it; }
-						result += *it;
-					}
-					return result;
-				}},
+			reserved_word{"true", tok::boolean{true}},
+			reserved_word{"false", tok::boolean{false}},
 			// Intrinsic functions
-			reserved("top", intrinsic::top),
-			reserved("pop", intrinsic::pop),
-			reserved("push", intrinsic::push),
-			reserved("print", intrinsic::print),
-			reserved("read", intrinsic::read),
+			reserved_word{"top", intrinsic::top},
+			reserved_word{"pop", intrinsic::pop},
+			reserved_word{"push", intrinsic::push},
+			reserved_word{"print", intrinsic::print},
+			reserved_word{"read", intrinsic::read},
 			// Keywords
-			reserved("import", tok::imp{}),
-			reserved("let", tok::let{}),
-			reserved("if", tok::if_{}),
-			reserved("then", tok::then{}),
-			reserved("else", tok::else_{}),
-			reserved("while", tok::while_{}),
-			reserved("for", tok::for_{}),
-			reserved("in", tok::in{}),
-			reserved("do", tok::do_{}),
-			reserved("return", tok::ret{}),
-			reserved("and", tok::and_{}),
-			reserved("or", tok::or_{}),
-			reserved("not", tok::not_{}),
-			// Symbol
-			{std::regex{R"...([a-zA-Z_]+)...", flags}, [](sv sv) { return tok::sym{sv.data()}; }}};
-	}
+			reserved_word{"import", tok::imp{}},
+			reserved_word{"let", tok::let{}},
+			reserved_word{"if", tok::if_{}},
+			reserved_word{"then", tok::then{}},
+			reserved_word{"else", tok::else_{}},
+			reserved_word{"while", tok::while_{}},
+			reserved_word{"for", tok::for_{}},
+			reserved_word{"in", tok::in{}},
+			reserved_word{"do", tok::do_{}},
+			reserved_word{"return", tok::ret{}},
+			reserved_word{"and", tok::and_{}},
+			reserved_word{"or", tok::or_{}},
+			reserved_word{"not", tok::not_{}}};
 
-	auto lex(std::string_view input) -> tl::expected<std::vector<tok::token>, std::string> {
-		using namespace std::string_literals;
+		//! Length of the longest reserved word. Longer words can be classified as symbols without hashing.
+		constexpr std::size_t max_reserved_length = [] {
+			std::size_t result = 0;
+			for (auto const& word : reserved_words) {
+				result = std::max(result, word.spelling.size());
+			}
+			return result;
+		}();
 
-		std::vector<tok::token> result;
-		for (auto it = input.cbegin(); it != input.cend();) {
-			bool found = false;
-			std::match_results<std::string_view::const_iterator> token_match;
-			// std::smatch token_match;
-			for (auto const& [regex, match_to_token] : regexes_to_tokens) {
-				if (std::regex_search(it, input.cend(), token_match, regex, std::regex_constants::match_continuous)) {
-					found = true;
-					if (auto const maybe_token = match_to_token(token_match.str())) {
-						if (maybe_token) { result.push_back(*maybe_token); }
-					}
-					std::advance(it, token_match.length());
-					break;
+		//! Number of bits in a reserved word hash table slot index.
+		constexpr int reserved_slot_bits = 6;
+		constexpr std::size_t reserved_table_size = std::size_t{1} << reserved_slot_bits;
+
+		//! Seeded FNV-1a hash of @p word, reduced to a reserved word table slot. Uses the high bits of the hash since the
+		//! low bits of an FNV hash depend only on the low bits of the input.
+		constexpr auto reserved_slot(sv word, std::uint32_t seed) -> std::size_t {
+			std::uint32_t hash = 2166136261u ^ seed;
+			for (char c : word) {
+				hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+			}
+			return hash >> (32 - reserved_slot_bits);
+		}
+
+		//! The first seed for which no two reserved words hash to the same slot.
+		constexpr std::uint32_t reserved_seed = [] {
+			for (std::uint32_t seed = 0;; ++seed) {
+				std::array<bool, reserved_table_size> used{};
+				bool collision = false;
+				for (auto const& word : reserved_words) {
+					auto const slot = reserved_slot(word.spelling, seed);
+					collision = collision || used[slot];
+					used[slot] = true;
+				}
+				if (!collision) { return seed; }
+			}
+		}();
+
+		//! Perfect hash table from slot to one plus the index of the reserved word in that slot, or zero if empty.
+		constexpr auto reserved_table = [] {
+			std::array<std::uint8_t, reserved_table_size> result{};
+			for (std::size_t i = 0; i < reserved_words.size(); ++i) {
+				result[reserved_slot(reserved_words[i].spelling, reserved_seed)] = static_cast<std::uint8_t>(i + 1);
+			}
+			return result;
+		}();
+
+		//! Looks up the keyword, intrinsic, or boolean token spelled by @p word, if any.
+		constexpr auto keyword(sv word) -> tok::token const* {
+			if (word.size() > max_reserved_length) { return nullptr; }
+			auto const entry = reserved_table[reserved_slot(word, reserved_seed)];
+			if (entry == 0 || reserved_words[entry - 1].spelling != word) { return nullptr; }
+			return &reserved_words[entry - 1].token;
+		}
+
+		static_assert(keyword("let") != nullptr && std::holds_alternative<tok::let>(*keyword("let")));
+		static_assert(keyword("lets") == nullptr && keyword("") == nullptr);
+
+		//! Scans a numerical literal starting at @p begin, if there is one.
+		//! @return An iterator to the end of the literal, or nullopt if there's no number at @p begin.
+		auto scan_num(sv_it begin, sv_it end) -> std::optional<sv_it> {
+			// Scans an optional fractional part, which requires at least one digit after the decimal point.
+			auto const fraction = [end](sv_it it) {
+				if (it != end && *it == '.' && it + 1 != end && is_digit(*(it + 1))) {
+					return skip_run(it + 1, end, is_digit, simd::skip_digits);
+				}
+				return it;
+			};
+			switch (*begin) {
+				case '.':
+					// Fraction without a whole part.
+					if (auto const frac_end = fraction(begin); frac_end != begin) { return frac_end; }
+					return std::nullopt;
+				case '0':
+					// A leading zero can only be a lone zero.
+					return fraction(begin + 1);
+				default:
+					if (is_digit(*begin)) { return fraction(skip_run(begin + 1, end, is_digit, simd::skip_digits)); }
+					return std::nullopt;
+			}
+		}
+
+		//! Ways in which a string literal can fail to scan.
+		enum class str_error { unterminated, bad_escape };
+
+		//! Scans a string literal starting at the open quote @p begin.
+		//! @return An iterator past the close quote, or the reason the literal is invalid.
+		auto scan_str(sv_it begin, sv_it end) -> tl::expected<sv_it, str_error> {
+			for (auto it = begin + 1; it != end; ++it) {
+				switch (*it) {
+					case '"':
+						return it + 1;
+					case '\\':
+						// Only quotes and backslashes may be escaped.
+						++it;
+						if (it == end) { return tl::unexpected{str_error::unterminated}; }
+						if (*it != '"' && *it != '\\') { return tl::unexpected{str_error::bad_escape}; }
+						break;
+					default:
+						break;
 				}
 			}
-			if (!found) {
-				std::regex_search(it, input.cend(), token_match, std::regex{R"...(\W+)..."});
-				return tl::unexpected{fmt::format("unrecognized token: '{}'", token_match.str())};
+			return tl::unexpected{str_error::unterminated};
+		}
+
+		//! The string view over [@p begin, @p end).
+		auto view(sv_it begin, sv_it end) -> sv {
+			return sv{&*begin, static_cast<std::size_t>(end - begin)};
+		}
+
+		//! Strips the quotes and escape characters from the string literal @p literal.
+		//! @param buffer Scratch space for the result, used only if @p literal contains escape characters.
+		auto unescape(sv literal, std::string& buffer) -> sv {
+			auto const contents = literal.substr(1, literal.size() - 2);
+			if (contents.find('\\') == sv::npos) { return contents; }
+			buffer.clear();
+			for (auto it = contents.begin(); it != contents.end(); ++it) {
+				if (*it == '\\') { ++it; }
+				buffer += *it;
+			}
+			return buffer;
+		}
+
+		//! Lexes tokens from the front of @p input, appending them to @p tokens.
+		//! @param final Whether @p input is the end of the input. If not, lexing stops before any token that could
+		//! change given more input, and before any error that more input could fix.
+		//! @param unescape_buffer Scratch space for unescaping string literals.
+		//! @return The number of characters consumed, or an error message.
+		auto lex_some(std::string_view input, bool final, std::vector<tok::token>& tokens, std::string& unescape_buffer)
+			-> tl::expected<std::size_t, std::string> {
+			// How far past the end of a token the scanner can look: a number followed by a decimal point and a digit.
+			constexpr std::ptrdiff_t lookahead = 2;
+
+			auto const begin = input.cbegin();
+			auto const end = input.cend();
+			auto it = begin;
+			// Pushes a token spanning a fixed number of characters.
+			auto const push = [&](tok::token token, std::ptrdiff_t length) {
+				tokens.push_back(std::move(token));
+				it += length;
+			};
+			// Checks whether the character after the current one is @p c.
+			auto const next_is = [&](char c) { return it + 1 != end && *(it + 1) == c; };
+			// The start of the most recently scanned token and the number of tokens before it.
+			auto token_begin = it;
+			auto token_count = tokens.size();
+			for (;;) {
+				if (!final && end - it < lookahead) {
+					// The last token might continue into the next chunk. Hold it back.
+					tokens.resize(token_count);
+					return token_begin - begin;
+				}
+				if (it == end) { return input.size(); }
+				token_begin = it;
+				token_count = tokens.size();
+				char const c = *it;
+				// Whitespace (ignored)
+				if (is_space(c)) {
+					it = skip_run(it + 1, end, is_space, simd::skip_space);
+					continue;
+				}
+				// Keywords, intrinsics, booleans, and symbols
+				if (is(c, alpha | underscore)) {
+					// Reserved words can't be immediately followed by a letter but may be followed by an underscore.
+					auto const alpha_end = skip_while(it, end, is_alpha);
+					if (auto const token = keyword(view(it, alpha_end))) {
+						push(*token, alpha_end - it);
+					} else {
+						auto const sym_end = skip_while(alpha_end, end, [](char c) { return is(c, alpha | underscore); });
+						push(tok::sym{view(it, sym_end)}, sym_end - it);
+					}
+					continue;
+				}
+				// Numbers
+				if (is_digit(c) || c == '.') {
+					if (auto const num_end = scan_num(it, end)) {
+						push(tok::num{std::string{view(it, *num_end)}}, *num_end - it);
+						continue;
+					}
+				}
+				switch (c) {
+					// Strings
+					case '"':
+						if (auto const str_end = scan_str(it, end)) {
+							push(tok::str{std::string{unescape(view(it, *str_end), unescape_buffer)}}, *str_end - it);
+							continue;
+						} else if (!final && str_end.error() == str_error::unterminated) {
+							// The rest of the string may be in the next chunk.
+							return it - begin;
+						}
+						break;
+					// Operators/separators
+					case '/':
+						if (next_is('/')) {
+							// Comment (ignored)
+							it = skip_run(it + 2, end, [](char c) { return !is_line_end(c); }, simd::find_line_end);
+						} else {
+							push(tok::div{}, 1);
+						}
+						continue;
+					case '=':
+						push(tok::eq{}, 1);
+						continue;
+					case '!':
+						if (next_is('=')) {
+							push(tok::neq{}, 2);
+							continue;
+						}
+						break;
+					case '~':
+						push(tok::approx{}, 1);
+						continue;
+					case '<':
+						next_is('=') ? push(tok::leq{}, 2) : push(tok::lt{}, 1);
+						continue;
+					case '>':
+						next_is('=') ? push(tok::geq{}, 2) : push(tok::gt{}, 1);
+						continue;
+					case '+':
+						push(tok::plus{}, 1);
+						continue;
+					case '-':
+						next_is('>') ? push(tok::arrow{}, 2) : push(tok::minus{}, 1);
+						continue;
+					case '*':
+						next_is('*') ? push(tok::exp{}, 2) : push(tok::mul{}, 1);
+						continue;
+					case '^':
+						push(tok::exp{}, 1);
+						continue;
+					case '(':
+						push(tok::lparen{}, 1);
+						continue;
+					case ')':
+						push(tok::rparen{}, 1);
+						continue;
+					case '[':
+						push(tok::lsquare{}, 1);
+						continue;
+					case ']':
+						push(tok::rsquare{}, 1);
+						continue;
+					case '{':
+						push(tok::lcurly{}, 1);
+						continue;
+					case '}':
+						push(tok::rcurly{}, 1);
+						continue;
+					case ',':
+						push(tok::com{}, 1);
+						continue;
+					case ';':
+						push(tok::semicolon{}, 1);
+						continue;
+					case '?':
+						push(tok::que{}, 1);
+						continue;
+					case ':':
+						push(tok::colon{}, 1);
+						continue;
+					default:
+						break;
+				}
+				// Nothing matched. Report the run of non-word characters starting here.
+				auto const bad_end = skip_while(it, end, [](char c) { return !is_word(c); });
+				// Wait for the rest of the run, if necessary, so the error message is the same regardless of chunking.
+				if (!final && bad_end == end) { return it - begin; }
+				return tl::unexpected{fmt::format("unrecognized token: '{}'", view(it, bad_end))};
 			}
 		}
-		return result;
+	}
+
+	auto lex(std::string_view input) -> lex_result {
+		std::vector<tok::token> result;
+		std::string unescape_buffer;
+		return lex_some(input, true, result, unescape_buffer).map([&](std::size_t) { return std::move(result); });
+	}
+
+	auto chunked_lexer::feed(std::string_view chunk, std::vector<tok::token>& tokens) -> tl::expected<void, std::string> {
+		_pending += chunk;
+		return lex_some(_pending, false, tokens, _unescape_buffer).map([&](std::size_t consumed) {
+			_pending.erase(0, consumed);
+		});
+	}
+
+	auto chunked_lexer::finish(std::vector<tok::token>& tokens) -> tl::expected<void, std::string> {
+		return lex_some(_pending, true, tokens, _unescape_buffer).map([&](std::size_t) { _pending.clear(); });
 	}
 }
@@ -16,4 +16,20 @@ namespace gynjo {
 
 	//! Lexes @p input into a vector of tokens, if possible.
 	auto lex(std::string_view input) -> lex_result;
+
+	//! Lexes input that arrives in chunks. A token that might continue into the next chunk is held back until more
+	//! input arrives, so splitting the input at any point produces the same tokens as lexing it all at once.
+	struct chunked_lexer {
+		//! Lexes as much of the input received so far as possible, appending the tokens to @p tokens.
+		auto feed(std::string_view chunk, std::vector<tok::token>& tokens) -> tl::expected<void, std::string>;
+
+		//! Lexes any held-back input, appending the tokens to @p tokens. Call this after the last chunk.
+		auto finish(std::vector<tok::token>& tokens) -> tl::expected<void, std::string>;
+
+	private:
+		//! Input that hasn't been lexed yet, at most one token plus one chunk.
+		std::string _pending;
+		//! Scratch space for unescaping string literals.
+		std::string _unescape_buffer;
+	};
 }
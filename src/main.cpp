@@ -2,6 +2,7 @@
 //! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
 
 #include "interpreter.hpp"
+#include "lexer.hpp"
 
 #ifndef _DEBUG
 #define DOCTEST_CONFIG_DISABLE
@@ -10,24 +11,59 @@
 #include <doctest/doctest.h>
 
 #include <array>
+#include <charconv>
+#include <cstddef>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 auto main(int argc, char* argv[]) -> int {
+	using namespace gynjo;
+
+	// Select the evaluation engine, the maximum call depth, the static passes, and the number representations and
+	// precision, for both the tests and the REPL.
+	for (int i = 1; i < argc; ++i) {
+		std::string_view const arg{argv[i]};
+		if (arg == "--engine=vm") {
+			set_engine(engine::vm);
+		} else if (arg == "--engine=tree") {
+			set_engine(engine::tree_walker);
+		} else if (arg == "--no-inference") {
+			set_inference(false);
+		} else if (arg == "--no-optimization") {
+			set_optimization(false);
+		} else if (arg == "--binary-floats") {
+			val::set_binary_floats(true);
+		} else if (arg == "--exact-numbers") {
+			val::set_exact_numbers(true);
+		} else if (constexpr std::string_view prefix = "--working-precision="; arg.starts_with(prefix)) {
+			unsigned digits;
+			auto const text = arg.substr(prefix.size());
+			if (auto const [end, ec] = std::from_chars(text.data(), text.data() + text.size(), digits);
+				ec != std::errc{} || end != text.data() + text.size() || !val::set_working_precision(digits)) {
+				std::cerr << "Invalid working precision: " << text << '\n';
+			}
+		} else if (constexpr std::string_view prefix = "--max-depth="; arg.starts_with(prefix)) {
+			std::size_t depth;
+			auto const digits = arg.substr(prefix.size());
+			if (auto const [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), depth);
+				ec == std::errc{} && end == digits.data() + digits.size()) {
+				set_max_depth(depth);
+			} else {
+				std::cerr << "Invalid maximum depth: " << digits << '\n';
+			}
+		}
+	}
+
 #ifdef _DEBUG
 	doctest::Context context;
 	context.setOption("no-breaks", true);
 	context.setOption("success", false);
 	context.applyCommandLine(argc, argv);
 	context.run();
-#else
-	// Command-line arguments unused in release build. Supress unused variable warnings.
-	(void)argc;
-	(void)argv;
 #endif
 
-	using namespace gynjo;
-
 	// Create environment with core libs.
 	auto env = environment::make_with_core_libs();
 
@@ -37,26 +73,32 @@ auto main(int argc, char* argv[]) -> int {
 	// REPL
 	for (;;) {
 		std::cout << ">> ";
-		std::string input;
-		std::getline(std::cin, input);
-		while (!input.empty() && input.back() == '\\') {
-			// Continue line. Add a space to ensure new token on next line.
-			input.back() = ' ';
+		// Lex each line as it's read, so continued lines don't have to be joined into one string.
+		chunked_lexer lexer;
+		std::vector<tok::token> tokens;
+		tl::expected<void, std::string> lex_result;
+		std::string line;
+		std::getline(std::cin, line);
+		while (!line.empty() && line.back() == '\\') {
+			// Continue line. Replace the backslash with a space to ensure new token on next line.
+			line.back() = ' ';
+			if (lex_result.has_value()) { lex_result = lexer.feed(line, tokens); }
 			std::cout << "   ";
-			std::string next_line;
-			std::getline(std::cin, next_line);
-			input += next_line;
+			std::getline(std::cin, line);
+		}
+		if (lex_result.has_value()) { lex_result = lexer.feed(line, tokens); }
+		if (lex_result.has_value()) { lex_result = lexer.finish(tokens); }
+		if (!lex_result.has_value()) {
+			fmt::print("(lex error) {}\n", lex_result.error());
+			continue;
 		}
-		// First try to interpret the line as an expression.
-		auto eval_result = eval(env, input);
-		if (eval_result.has_value()) {
+		// Evaluate the line if it's an expression or execute it otherwise.
+		auto const result = interpret(env, tokens);
+		if (!result.has_value()) {
+			fmt::print("{}\n", result.error());
+		} else if (result.value().has_value()) {
 			// Print the computed value.
-			fmt::print("{}\n", val::to_string(eval_result.value(), env));
-		} else {
-			// Invalid expression. Try a statement instead.
-			auto exec_result = exec(env, input);
-			// Still didn't work; report statement error.
-			if (!exec_result.has_value()) { fmt::print("{}\n", exec_result.error()); }
+			fmt::print("{}\n", val::to_string(result.value().value(), env));
 		}
 	}
 }
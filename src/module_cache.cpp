@@ -0,0 +1,159 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "module_cache.hpp"
+
+#include "lexer.hpp"
+#include "parser.hpp"
+
+#include <fmt/format.h>
+
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+namespace gynjo {
+	namespace {
+		//! Identifies Gynjo module caches.
+		constexpr char magic[4] = {'G', 'Y', 'N', 'C'};
+
+		//! Incremented whenever the cache format or the syntax tree layout changes, invalidating existing caches.
+		constexpr std::uint32_t format_version = 5;
+
+		//! Identifies the source file a cache was written for, and checks the integrity of the cache itself.
+		struct header {
+			char magic[4];
+			std::uint32_t format_version;
+			std::uint64_t source_size;
+			std::int64_t source_mtime;
+			std::uint64_t source_hash;
+			std::uint64_t payload_size;
+			std::uint64_t payload_hash;
+		};
+
+		//! FNV-1a hash.
+		auto hash(std::string_view bytes) -> std::uint64_t {
+			std::uint64_t result = 14695981039346656037ull;
+			for (unsigned char c : bytes) {
+				result = (result ^ c) * 1099511628211ull;
+			}
+			return result;
+		}
+
+		//! Reads the entire file at @p path, in binary mode if @p binary is set.
+		auto read_file(std::filesystem::path const& path, bool binary) -> std::optional<std::string> {
+			std::ifstream fin{path, binary ? std::ios::binary : std::ios::in};
+			if (!fin.is_open()) { return std::nullopt; }
+			std::stringstream ss;
+			ss << fin.rdbuf();
+			return std::move(ss).str();
+		}
+
+		//! Lexes and parses @p source into a module.
+		auto parse_module(std::string_view source) -> std::optional<module> {
+			auto const lex_result = lex(source);
+			if (!lex_result.has_value()) { return std::nullopt; }
+			auto const& tokens = lex_result.value();
+			module result{ast::make(), {}};
+			for (auto it = tokens.begin(); it != tokens.end();) {
+				auto const parse_result = parse_stmt(*result.tree, it, tokens.end());
+				if (!parse_result.has_value()) { return std::nullopt; }
+				it = parse_result.value().it;
+				result.stmts.push_back(parse_result.value().stmt.node);
+			}
+			return result;
+		}
+
+		//! A read-only stream buffer over bytes owned elsewhere.
+		class view_buf : public std::streambuf {
+		public:
+			explicit view_buf(std::string_view bytes) {
+				// The get area is only read from, so casting away const is safe.
+				auto const data = const_cast<char*>(bytes.data());
+				setg(data, data, data + bytes.size());
+			}
+		};
+
+		//! Reads a module from @p payload, checking that its statements are nodes of its tree.
+		auto read_payload(std::string_view payload) -> std::optional<module> {
+			view_buf buf{payload};
+			std::istream in{&buf};
+			std::uint32_t stmt_count;
+			if (!in.read(reinterpret_cast<char*>(&stmt_count), sizeof(stmt_count))) { return std::nullopt; }
+			std::vector<node_id> stmts(stmt_count);
+			if (!in.read(reinterpret_cast<char*>(stmts.data()), stmt_count * sizeof(node_id))) { return std::nullopt; }
+			auto tree = ast::read(in);
+			if (tree == nullptr) { return std::nullopt; }
+			for (auto const stmt : stmts) {
+				if (stmt >= tree->size()) { return std::nullopt; }
+			}
+			return module{std::move(tree), std::move(stmts)};
+		}
+
+		auto write_payload(module const& module) -> std::string {
+			std::ostringstream out;
+			auto const stmt_count = static_cast<std::uint32_t>(module.stmts.size());
+			out.write(reinterpret_cast<char const*>(&stmt_count), sizeof(stmt_count));
+			out.write(reinterpret_cast<char const*>(module.stmts.data()), stmt_count * sizeof(node_id));
+			module.tree->write(out);
+			return std::move(out).str();
+		}
+	}
+
+	auto cache_path(std::filesystem::path const& source_path) -> std::filesystem::path {
+		auto result = source_path;
+		result += "c";
+		return result;
+	}
+
+	auto load_module(std::filesystem::path const& path) -> std::optional<module> {
+		std::error_code ec;
+		auto const source_size = std::filesystem::file_size(path, ec);
+		if (ec || source_size > max_cached_source_size) { return std::nullopt; }
+		auto const source_mtime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+		if (ec) { return std::nullopt; }
+		auto source = read_file(path, false);
+		if (!source.has_value()) { return std::nullopt; }
+		auto const source_hash = hash(*source);
+
+		// Try the cache. The size and modification time are checked first since they're cheap to compare, and the
+		// content hash catches edits that preserve both.
+		auto const cache_file = cache_path(path);
+		if (auto const cache = read_file(cache_file, true); cache.has_value() && cache->size() >= sizeof(header)) {
+			header h;
+			std::memcpy(&h, cache->data(), sizeof(header));
+			std::string_view const payload{cache->data() + sizeof(header), cache->size() - sizeof(header)};
+			bool const valid = std::memcmp(h.magic, magic, sizeof(magic)) == 0 && h.format_version == format_version &&
+				h.source_size == source_size && h.source_mtime == source_mtime && h.source_hash == source_hash &&
+				h.payload_size == payload.size() && h.payload_hash == hash(payload);
+			if (valid) {
+				if (auto result = read_payload(payload)) { return result; }
+			}
+		}
+
+		// Parse the source and rewrite the cache. Failing to write the cache isn't an error.
+		auto result = parse_module(*source);
+		source.reset();
+		if (!result.has_value()) { return std::nullopt; }
+		auto const payload = write_payload(*result);
+		header h{{}, format_version, source_size, source_mtime, source_hash, payload.size(), hash(payload)};
+		std::memcpy(h.magic, magic, sizeof(magic));
+		// The cache is written to a temporary file and renamed into place, so a reader never sees a partial cache. The
+		// temporary name is unique so that concurrent writers don't interleave their writes.
+		auto temp_file = cache_file;
+		temp_file += fmt::format(".{:x}.tmp", std::random_device{}());
+		{
+			std::ofstream fout{temp_file, std::ios::binary | std::ios::trunc};
+			fout.write(reinterpret_cast<char const*>(&h), sizeof(header));
+			fout.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+			if (!fout.flush()) { ec = std::make_error_code(std::errc::io_error); }
+		}
+		if (!ec) { std::filesystem::rename(temp_file, cache_file, ec); }
+		if (ec) { std::filesystem::remove(temp_file, ec); }
+		return result;
+	}
+}
@@ -0,0 +1,34 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Binary cache of parsed source files, so that imports can skip lexing and parsing.
+
+#pragma once
+
+#include "ast.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace gynjo {
+	//! A parsed source file: its syntax tree and its top-level statements, in order.
+	struct module {
+		ast_ptr tree;
+		std::vector<node_id> stmts;
+	};
+
+	//! The path of the binary cache for the source file at @p source_path, which sits next to the source.
+	auto cache_path(std::filesystem::path const& source_path) -> std::filesystem::path;
+
+	//! The size in bytes of the largest source file that's cached. Loading a module holds its source, syntax tree and
+	//! cache in memory at once, so larger files are better interpreted a statement at a time.
+	constexpr std::uintmax_t max_cached_source_size = 1 << 18;
+
+	//! Loads the source file at @p path as a module. If its cache was written for a file of the same size, modification
+	//! time, and contents, the module is read from the cache. Otherwise, the source is lexed and parsed, and the cache is
+	//! rewritten if possible.
+	//! @return The module, or @p std::nullopt if the file can't be read, is larger than @p max_cached_source_size, or
+	//! doesn't lex and parse.
+	auto load_module(std::filesystem::path const& path) -> std::optional<module>;
+}
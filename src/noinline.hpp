@@ -0,0 +1,12 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Keeps rarely taken paths out of the stack frames of deeply recursive functions.
+
+#pragma once
+
+//! Marks a function as never inlined, so its locals don't enlarge the frames of its callers.
+#ifdef _MSC_VER
+#define GYNJO_NOINLINE __declspec(noinline)
+#else
+#define GYNJO_NOINLINE [[gnu::noinline]]
+#endif
@@ -0,0 +1,455 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "num.hpp"
+
+#include <boost/multiprecision/number.hpp>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+
+namespace gynjo::val {
+	namespace {
+		//! Whether binary floats are enabled, as set by set_binary_floats.
+		bool selected_binary_floats = false;
+
+		//! Whether exact numbers are enabled, as set by set_exact_numbers.
+		bool selected_exact_numbers = false;
+
+		//! The index of the working precision in working_precisions, as set by set_working_precision.
+		std::size_t selected_working_precision = working_precisions.size() - 1;
+
+		//! The largest magnitude up to which every integer is exactly a double.
+		constexpr std::int64_t max_exact_double = std::int64_t{1} << 53;
+
+		//! The most bits in the numerator or denominator of an exact power. Larger powers are computed in decimals,
+		//! since the time to compute them exactly grows with the square of their size.
+		constexpr std::uint64_t max_exact_power_bits = std::uint64_t{1} << 20;
+
+		//! The number of bits in the magnitude of @p i.
+		auto bit_count(big_int const& i) -> std::uint64_t {
+			return i == 0 ? 0 : msb(abs(i)) + 1;
+		}
+
+		//! Whether @p text is an integer literal, optionally preceded by a minus sign and followed by a fractional part
+		//! of zeros.
+		auto is_integer_literal(char const* text) -> bool {
+			if (*text == '-') { ++text; }
+			if (*text < '0' || *text > '9') { return false; }
+			while (*text >= '0' && *text <= '9') {
+				++text;
+			}
+			if (*text == '.') {
+				do {
+					++text;
+				} while (*text == '0');
+			}
+			return *text == '\0';
+		}
+
+		//! The product of @p a and @p b, or nullopt if it doesn't fit.
+		auto checked_mul(std::int64_t a, std::int64_t b) -> std::optional<std::int64_t> {
+			constexpr auto min = std::numeric_limits<std::int64_t>::min();
+			constexpr auto max = std::numeric_limits<std::int64_t>::max();
+			bool const overflow =
+				a > 0 ? (b > 0 ? a > max / b : b < min / a) : (b > 0 ? a < min / b : a != 0 && b < max / a);
+			if (overflow) { return std::nullopt; }
+			return a * b;
+		}
+
+		//! Calls @p f with the std::type_identity of the type at index @p tier of @p Tiers, which is at least @p I.
+		template <typename Tiers, std::size_t I = 0, typename F>
+		auto at_tier(std::size_t tier, F const& f) {
+			if constexpr (I + 1 < std::tuple_size_v<Tiers>) {
+				if (tier != I) { return at_tier<Tiers, I + 1>(tier, f); }
+			}
+			return f(std::type_identity<std::tuple_element_t<I, Tiers>>{});
+		}
+
+		//! Parses @p text, which is a number literal, as a @p D.
+		template <typename D>
+		auto parse(char const* text) -> D {
+			if constexpr (std::is_same_v<D, double>) {
+				// Out-of-range literals become infinities.
+				return std::strtod(text, nullptr);
+			} else {
+				return D{text};
+			}
+		}
+
+		//! The text of @p d with at most @p precision significant digits, or as many as needed if @p precision is 0.
+		template <typename D>
+		auto text(D const& d, int precision) -> std::string {
+			if constexpr (std::is_same_v<D, double>) {
+				// Written as a decimal would be, in fixed or scientific notation, whichever is shorter.
+				std::array<char, 512> buffer;
+				auto const end = precision == 0
+					? std::to_chars(buffer.data(), buffer.data() + buffer.size(), d)
+					: std::to_chars(buffer.data(), buffer.data() + buffer.size(), d, std::chars_format::general, precision);
+				return std::string(buffer.data(), end.ptr);
+			} else {
+				return d.str(precision);
+			}
+		}
+	}
+
+	auto set_binary_floats(bool enabled) -> void {
+		selected_binary_floats = enabled;
+	}
+
+	auto binary_floats_enabled() -> bool {
+		return selected_binary_floats;
+	}
+
+	auto set_exact_numbers(bool enabled) -> void {
+		selected_exact_numbers = enabled;
+	}
+
+	auto exact_numbers_enabled() -> bool {
+		return selected_exact_numbers;
+	}
+
+	auto set_working_precision(unsigned digits) -> bool {
+		for (std::size_t i = 0; i < working_precisions.size(); ++i) {
+			if (digits <= working_precisions[i]) {
+				selected_working_precision = i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	auto working_precision() -> unsigned {
+		return working_precisions[selected_working_precision];
+	}
+
+	num::num(double value) {
+		if (std::trunc(value) == value && value >= -0x1p63 && value < 0x1p63) {
+			_value = static_cast<std::int64_t>(value);
+		} else if (selected_binary_floats) {
+			_value = value;
+		} else {
+			_value = decimal(value);
+		}
+	}
+
+	num::num(big_int const& value) {
+		if (min <= value && value <= max) {
+			_value = static_cast<std::int64_t>(value);
+		} else if (selected_exact_numbers) {
+			_value = value;
+		} else {
+			// Converting only the leading bits and scaling them is much faster for huge integers, and still exact far
+			// beyond any working precision.
+			constexpr std::uint64_t kept_bits = 512;
+			auto const shift = std::max(bit_count(value), kept_bits) - kept_bits;
+			*this = at_working_precision([&]<typename D>(std::type_identity<D>) {
+				using std::ldexp;
+				return num{D{ldexp(D(big_int{value >> shift}), static_cast<int>(shift))}};
+			});
+		}
+	}
+
+	num::num(rational const& value) {
+		if (denominator(value) == 1) {
+			*this = num{numerator(value)};
+		} else if (selected_exact_numbers) {
+			_value = value;
+		} else {
+			*this = at_working_precision([&]<typename D>(std::type_identity<D>) { return num{D(value)}; });
+		}
+	}
+
+	num::num(char const* text) {
+		auto const end = text + std::strlen(text);
+		if (std::int64_t i = 0; std::from_chars(text, end, i) == std::from_chars_result{end, std::errc{}}) {
+			_value = i;
+			return;
+		}
+		if (selected_exact_numbers && is_integer_literal(text)) {
+			// Integer literals are exact, ignoring any fractional zeros.
+			auto const point = std::strchr(text, '.');
+			*this = num{big_int{std::string(text, point == nullptr ? end : point)}};
+			return;
+		}
+		if (selected_binary_floats) {
+			if (double d = 0; std::from_chars(text, end, d) == std::from_chars_result{end, std::errc{}}) {
+				*this = num{d};
+				return;
+			}
+		}
+		using std::trunc;
+		auto d = parse<decimal>(text);
+		if (trunc(d) == d && decimal(min) <= d && d < -decimal(min)) {
+			_value = static_cast<std::int64_t>(d);
+		} else {
+			_value = std::move(d);
+		}
+	}
+
+	auto num::str(int precision) const -> std::string {
+		if (auto const i = std::get_if<std::int64_t>(&_value)) {
+			// A decimal integer is written out in full if it has no more digits than the precision.
+			auto text = std::to_string(*i);
+			auto const digits = static_cast<int>(text.size()) - (*i < 0 ? 1 : 0);
+			if (precision == 0 || (precision > 0 && digits <= precision)) { return text; }
+		}
+		if (auto const i = std::get_if<big_int>(&_value)) {
+			// Likewise for big integers.
+			auto text = i->str();
+			auto const digits = static_cast<int>(text.size()) - (*i < 0 ? 1 : 0);
+			if (precision == 0 || (precision > 0 && digits <= precision)) { return text; }
+		}
+		if (auto const d = std::get_if<double>(&_value); d != nullptr && precision == 0) {
+			// The shortest text that reads back as the same double.
+			std::array<char, 32> buffer;
+			return std::string(buffer.data(), std::to_chars(buffer.data(), buffer.data() + buffer.size(), *d).ptr);
+		}
+		return text(to_decimal(), precision);
+	}
+
+	auto num::to_decimal() const -> decimal {
+		return std::visit([](auto const& value) { return decimal(value); }, _value);
+	}
+
+	auto num::is_finite() const -> bool {
+		return std::visit(
+			[](auto const& value) {
+				using std::isfinite;
+				using type = std::remove_cvref_t<decltype(value)>;
+				if constexpr (std::is_same_v<type, std::int64_t> || std::is_same_v<type, big_int> ||
+					std::is_same_v<type, rational>) {
+					return true;
+				} else {
+					return static_cast<bool>(isfinite(value));
+				}
+			},
+			_value);
+	}
+
+	auto num::is_integer() const -> bool {
+		return std::visit(
+			[](auto const& value) {
+				using std::trunc;
+				using type = std::remove_cvref_t<decltype(value)>;
+				if constexpr (std::is_same_v<type, std::int64_t> || std::is_same_v<type, big_int>) {
+					return true;
+				} else if constexpr (std::is_same_v<type, rational>) {
+					// Rationals are in lowest terms, and integral ones are integers instead.
+					return false;
+				} else {
+					return trunc(value) == value;
+				}
+			},
+			_value);
+	}
+
+	auto num::negated() const -> num {
+		return std::visit(
+			[](auto const& value) -> num {
+				using type = std::remove_cvref_t<decltype(value)>;
+				if constexpr (std::is_same_v<type, double>) {
+					return binary(-value);
+				} else if constexpr (std::is_same_v<type, std::int64_t>) {
+					// Only the least machine integer has no negation that fits.
+					if (selected_exact_numbers) { return num{big_int{-big_int{value}}}; }
+					return num{-decimal(value)};
+				} else if constexpr (std::is_same_v<type, big_int> || std::is_same_v<type, rational>) {
+					return num{type{-value}};
+				} else {
+					// Decimals keep their precision.
+					return type{-value};
+				}
+			},
+			_value);
+	}
+
+	auto num::as_double(num const& value) -> std::optional<double> {
+		if (auto const d = std::get_if<double>(&value._value)) { return *d; }
+		auto const i = std::get_if<std::int64_t>(&value._value);
+		if (i != nullptr && -max_exact_double <= *i && *i <= max_exact_double) { return static_cast<double>(*i); }
+		return std::nullopt;
+	}
+
+	auto num::as_rational(num const& value) -> rational {
+		return std::visit(
+			[](auto const& v) -> rational {
+				using type = std::remove_cvref_t<decltype(v)>;
+				if constexpr (std::is_same_v<type, std::int64_t> || std::is_same_v<type, big_int> ||
+					std::is_same_v<type, rational>) {
+					return rational{v};
+				} else {
+					// unreachable
+					return rational{};
+				}
+			},
+			value._value);
+	}
+
+	template <typename D>
+	auto num::as_decimal(num const& value, D& storage) -> D const& {
+		if (auto const d = std::get_if<D>(&value._value)) { return *d; }
+		storage = std::visit([](auto const& v) { return D(v); }, value._value);
+		return storage;
+	}
+
+	template <typename F>
+	auto num::at_working_precision(F f) -> num {
+		static_assert(std::tuple_size_v<numbers::tiers> == working_precisions.size());
+		return at_tier<numbers::tiers>(selected_working_precision, f);
+	}
+
+	template <typename Op>
+	auto num::promoted(num const& a, num const& b, Op op, bool inexact) -> num {
+		bool const doubles = std::holds_alternative<double>(a._value) || std::holds_alternative<double>(b._value) ||
+			(inexact && selected_binary_floats);
+		if (doubles && !a.is_decimal() && !b.is_decimal()) {
+			auto const x = as_double(a);
+			auto const y = as_double(b);
+			if (x.has_value() && y.has_value()) {
+				if (double const result = op(*x, *y); std::isfinite(result)) {
+					return binary(result);
+				}
+			}
+		}
+		return at_working_precision([&]<typename D>(std::type_identity<D>) {
+			D x;
+			D y;
+			return num{D{op(as_decimal(a, x), as_decimal(b, y))}};
+		});
+	}
+
+	template <typename Op>
+	auto num::exactly(num const& a, num const& b, Op op) -> std::optional<num> {
+		if (!selected_exact_numbers || !a.is_exact() || !b.is_exact()) { return std::nullopt; }
+		if (std::holds_alternative<rational>(a._value) || std::holds_alternative<rational>(b._value)) {
+			return num{rational{op(as_rational(a), as_rational(b))}};
+		}
+		auto const as_big_int = [](num const& value) {
+			if (auto const i = std::get_if<std::int64_t>(&value._value)) { return big_int{*i}; }
+			return std::get<big_int>(value._value);
+		};
+		return num{big_int{op(as_big_int(a), as_big_int(b))}};
+	}
+
+	auto num::sum(num const& a, num const& b) -> num {
+		auto const op = [](auto const& x, auto const& y) { return x + y; };
+		if (auto result = exactly(a, b, op)) { return std::move(*result); }
+		return promoted(a, b, op);
+	}
+
+	auto num::difference(num const& a, num const& b) -> num {
+		auto const op = [](auto const& x, auto const& y) { return x - y; };
+		if (auto result = exactly(a, b, op)) { return std::move(*result); }
+		return promoted(a, b, op);
+	}
+
+	auto num::product(num const& a, num const& b) -> num {
+		if (auto const [x, y] = machine_ints(a, b); x != nullptr) {
+			if (auto const result = checked_mul(*x, *y)) { return *result; }
+		}
+		auto const op = [](auto const& x, auto const& y) { return x * y; };
+		if (auto result = exactly(a, b, op)) { return std::move(*result); }
+		return promoted(a, b, op);
+	}
+
+	auto operator/(num const& a, num const& b) -> num {
+		bool inexact = false;
+		if (auto const [x, y] = num::machine_ints(a, b); x != nullptr && *y != 0 && !(*x == num::min && *y == -1)) {
+			if (*x % *y == 0) { return *x / *y; }
+			inexact = true;
+		}
+		if (selected_exact_numbers && a.is_exact() && b.is_exact()) {
+			// Division by zero is left to decimals, which give an infinity or NaN.
+			if (auto const y = num::as_rational(b); y != 0) { return num{rational{num::as_rational(a) / y}}; }
+		}
+		return num::promoted(a, b, [](auto const& x, auto const& y) { return x / y; }, inexact);
+	}
+
+	auto pow(num const& base, num const& exponent) -> num {
+		bool inexact = false;
+		if (auto const [x, y] = num::machine_ints(base, exponent); x != nullptr) {
+			if (*y >= 0) {
+				// Square and multiply, which is also how decimals handle integer exponents, unless the result doesn't
+				// fit, in which case the decimal result is the same as if there were no machine integers.
+				std::optional<std::int64_t> result = 1;
+				std::optional<std::int64_t> square = *x;
+				for (auto n = *y; n > 0 && result.has_value() && square.has_value(); n >>= 1) {
+					if ((n & 1) != 0) { result = checked_mul(*result, *square); }
+					if (n > 1) { square = checked_mul(*square, *square); }
+				}
+				if (result.has_value() && square.has_value()) { return *result; }
+			} else {
+				inexact = true;
+			}
+		}
+		if (auto const e = std::get_if<std::int64_t>(&exponent._value);
+			e != nullptr && *e != num::min && selected_exact_numbers && base.is_exact()) {
+			// An integer power of an exact number is exact, unless it's too big or a negative power of zero.
+			auto const x = num::as_rational(base);
+			auto const magnitude = static_cast<std::uint64_t>(*e < 0 ? -*e : *e);
+			auto const bits = std::max(bit_count(numerator(x)), bit_count(denominator(x)));
+			if ((x != 0 || *e >= 0) && magnitude <= max_exact_power_bits && bits * magnitude <= max_exact_power_bits) {
+				auto const n = static_cast<unsigned>(magnitude);
+				rational const power{pow(numerator(x), n), pow(denominator(x), n)};
+				return num{*e < 0 ? rational{1 / power} : power};
+			}
+		}
+		return num::promoted(
+			base,
+			exponent,
+			[](auto const& x, auto const& y) {
+				using std::pow;
+				return pow(x, y);
+			},
+			inexact);
+	}
+
+	auto sqrt(num const& radicand) -> num {
+		bool const doubles = std::holds_alternative<double>(radicand._value) ||
+			(std::holds_alternative<std::int64_t>(radicand._value) && selected_binary_floats);
+		if (doubles) {
+			if (auto const x = num::as_double(radicand)) {
+				if (double const result = std::sqrt(*x); std::isfinite(result)) { return num::binary(result); }
+			}
+		}
+		return num::at_working_precision([&]<typename D>(std::type_identity<D>) {
+			using std::sqrt;
+			D storage;
+			return num{D{sqrt(num::as_decimal(radicand, storage))}};
+		});
+	}
+
+	auto num::compare(num const& a, num const& b) -> std::partial_ordering {
+		if (a.is_exact() && b.is_exact()) {
+			auto const x = as_rational(a);
+			auto const y = as_rational(b);
+			if (x < y) { return std::partial_ordering::less; }
+			if (y < x) { return std::partial_ordering::greater; }
+			return std::partial_ordering::equivalent;
+		}
+		if (!a.is_decimal() && !b.is_decimal()) {
+			auto const x = as_double(a);
+			auto const y = as_double(b);
+			if (x.has_value() && y.has_value()) { return *x <=> *y; }
+		}
+		// Widening decimals is exact.
+		decimal x_storage;
+		decimal y_storage;
+		auto const& x = as_decimal(a, x_storage);
+		auto const& y = as_decimal(b, y_storage);
+		using std::isnan;
+		if (isnan(x) || isnan(y)) {
+			return std::partial_ordering::unordered;
+		}
+		if (x < y) { return std::partial_ordering::less; }
+		if (y < x) { return std::partial_ordering::greater; }
+		return std::partial_ordering::equivalent;
+	}
+}
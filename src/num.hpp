@@ -0,0 +1,305 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Gynjo's number type, which syntax trees also use for their pool of number literals.
+
+#pragma once
+
+#include <boost/multiprecision/cpp_dec_float.hpp>
+#include <boost/multiprecision/cpp_int.hpp>
+#if defined(GYNJO_NUMBERS_BIN_FLOAT_50)
+#include <boost/multiprecision/cpp_bin_float.hpp>
+#elif defined(GYNJO_NUMBERS_FLOAT128)
+#include <boost/multiprecision/float128.hpp>
+#endif
+
+#include <array>
+#include <compare>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace gynjo::val {
+	//! Decimal floating-point number with @p Digits significant digits.
+	template <unsigned Digits>
+	using decimal_of = boost::multiprecision::number<boost::multiprecision::cpp_dec_float<Digits>>;
+
+	// A numeric policy chooses the types of the numbers that don't fit a machine integer: one per working precision,
+	// from fastest to most precise, with its number of significant digits. Each build selects one policy, by defining
+	// at most one GYNJO_NUMBERS_* macro, and the rest of the interpreter works the same with any of them.
+
+	//! Decimals of up to 100 digits, so that results are those of decimal arithmetic. The default policy.
+	struct decimal_numbers {
+		using tiers = std::tuple<decimal_of<16>, decimal_of<34>, decimal_of<50>, decimal_of<100>>;
+		static constexpr std::array<unsigned, 4> working_precisions{16, 34, 50, 100};
+	};
+
+#if defined(GYNJO_NUMBERS_DOUBLE)
+	//! Binary doubles only, for speed over precision and range.
+	struct double_numbers {
+		using tiers = std::tuple<double>;
+		static constexpr std::array<unsigned, 1> working_precisions{std::numeric_limits<double>::digits10};
+	};
+
+	using numbers = double_numbers;
+#elif defined(GYNJO_NUMBERS_BIN_FLOAT_50)
+	//! 50-digit binary floats, which are faster than decimals of the same precision.
+	struct bin_float_50_numbers {
+		using tiers = std::tuple<boost::multiprecision::cpp_bin_float_50>;
+		static constexpr std::array<unsigned, 1> working_precisions{50};
+	};
+
+	using numbers = bin_float_50_numbers;
+#elif defined(GYNJO_NUMBERS_FLOAT128)
+	//! Quadruple-precision binary floats, which need compiler support for __float128.
+	struct float128_numbers {
+		using tiers = std::tuple<boost::multiprecision::float128>;
+		static constexpr std::array<unsigned, 1> working_precisions{33};
+	};
+
+	using numbers = float128_numbers;
+#else
+	using numbers = decimal_numbers;
+#endif
+
+	//! The widest number type of the policy, which represents any number that doesn't fit a machine representation.
+	//! A decimal unless the build selects a binary policy.
+	using decimal = std::tuple_element_t<std::tuple_size_v<numbers::tiers> - 1, numbers::tiers>;
+
+	//! An integer of any size.
+	using big_int = boost::multiprecision::cpp_int;
+
+	//! A fraction of big integers, in lowest terms.
+	using rational = boost::multiprecision::cpp_rational;
+
+	//! Whether @p T is one of the number types of the policy, other than double.
+	template <typename T, typename Tiers = numbers::tiers>
+	inline constexpr bool is_tier = false;
+
+	template <typename T, typename... Tiers>
+	inline constexpr bool is_tier<T, std::tuple<Tiers...>> =
+		!std::is_same_v<T, double> && (std::is_same_v<T, Tiers> || ...);
+
+	//! The numbers of significant digits at which decimal arithmetic can run, from fastest to most precise.
+	inline constexpr auto working_precisions = numbers::working_precisions;
+
+	//! Makes decimal arithmetic run at the smallest working precision of at least @p digits. Results are rounded to the
+	//! working precision, and operands with more digits are truncated to it. Defaults to 100 digits.
+	//! @return Whether there is such a working precision. If not, the working precision is unchanged.
+	auto set_working_precision(unsigned digits) -> bool;
+
+	//! The number of significant digits at which decimal arithmetic runs.
+	auto working_precision() -> unsigned;
+
+	//! Sets whether non-integral numbers may be binary doubles instead of decimals. Doubles are much faster, but they
+	//! round differently, so results can differ from those with decimals. Disabled by default.
+	auto set_binary_floats(bool enabled) -> void;
+
+	//! Whether non-integral numbers may be binary doubles instead of decimals.
+	auto binary_floats_enabled() -> bool;
+
+	//! Sets whether integers that don't fit a machine integer, and quotients of integers, are exact big integers and
+	//! rationals instead of decimals. Exact numbers never round, but their arithmetic slows down as they grow. Disabled
+	//! by default.
+	auto set_exact_numbers(bool enabled) -> void;
+
+	//! Whether integers that don't fit a machine integer, and quotients of integers, are exact.
+	auto exact_numbers_enabled() -> bool;
+
+	//! A number, which is a machine integer, a decimal, or if binary floats are enabled, a double. Integers that fit in
+	//! 64 bits start out as machine integers. An operation on machine numbers stays on machine numbers as long as the
+	//! result is exact, or for doubles, finite, and is otherwise promoted to decimals at the working precision. So with
+	//! binary floats disabled, every result is the same as if all numbers were decimals.
+	//!
+	//! If exact numbers are enabled, integer literals and the results of +, -, *, / and integer powers of integers and
+	//! rationals are instead promoted to big integers or rationals, which are demoted back to machine integers whenever
+	//! they fit. Any other operation, or one with a decimal or double operand, is done in decimals or doubles.
+	class num {
+	public:
+		num() noexcept = default;
+
+		template <std::integral T>
+		num(T value) : _value{std::in_range<std::int64_t>(value) ? rep{std::int64_t(value)} : rep{decimal(value)}} {}
+
+		//! An integral @p value becomes a machine integer if it fits, and a non-integral one becomes a double if binary
+		//! floats are enabled, or else a decimal.
+		num(double value);
+
+		template <typename T>
+			requires is_tier<T>
+		num(T value) noexcept : _value{std::move(value)} {}
+
+		//! A machine integer if @p value fits, or else a big integer if exact numbers are enabled, or else a decimal at
+		//! the working precision.
+		num(big_int const& value);
+
+		//! An integer if @p value is one, or else a rational if exact numbers are enabled, or else a decimal at the
+		//! working precision.
+		num(rational const& value);
+
+		//! Parses @p text, which is a Gynjo number literal, optionally preceded by a minus sign.
+		explicit num(char const* text);
+
+		//! This number's text, with at most @p precision significant digits, or as many as needed if @p precision is 0.
+		//! The text is the same as that of the equal decimal, except that a double's full text is the shortest that
+		//! reads back as the same double.
+		auto str(int precision = 0) const -> std::string;
+
+		//! This number converted to @p T, as a decimal would be.
+		template <typename T>
+		auto convert_to() const -> T {
+			if (auto const i = std::get_if<std::int64_t>(&_value); i != nullptr && std::in_range<T>(*i)) {
+				return static_cast<T>(*i);
+			}
+			return static_cast<T>(to_decimal());
+		}
+
+		//! This number as a widest decimal, which is exact unless it's a double that needs more digits than that.
+		auto to_decimal() const -> decimal;
+
+		//! Whether this is a machine integer.
+		auto is_machine_int() const noexcept -> bool {
+			return std::holds_alternative<std::int64_t>(_value);
+		}
+
+		//! This number's machine integer, or null if it isn't one.
+		auto machine_int() const noexcept -> std::int64_t const* {
+			return std::get_if<std::int64_t>(&_value);
+		}
+
+		//! This number's double, or null if it isn't one.
+		auto machine_double() const noexcept -> double const* {
+			return std::get_if<double>(&_value);
+		}
+
+		//! A double number, even if binary floats aren't enabled.
+		static auto binary(double value) -> num {
+			num result;
+			result._value = value;
+			return result;
+		}
+
+		auto is_finite() const -> bool;
+
+		auto is_integer() const -> bool;
+
+		auto operator-() const -> num {
+			if (auto const i = std::get_if<std::int64_t>(&_value); i != nullptr && *i != min) { return -*i; }
+			return negated();
+		}
+
+		friend auto operator+(num const& a, num const& b) -> num {
+			if (auto const [x, y] = machine_ints(a, b); x != nullptr) {
+				if (*y >= 0 ? *x <= max - *y : *x >= min - *y) { return *x + *y; }
+			}
+			return sum(a, b);
+		}
+
+		friend auto operator-(num const& a, num const& b) -> num {
+			if (auto const [x, y] = machine_ints(a, b); x != nullptr) {
+				if (*y >= 0 ? *x >= min + *y : *x <= max + *y) { return *x - *y; }
+			}
+			return difference(a, b);
+		}
+
+		friend auto operator*(num const& a, num const& b) -> num {
+			// Products of 32-bit integers always fit.
+			constexpr std::int64_t half = std::int64_t{1} << 31;
+			if (auto const [x, y] = machine_ints(a, b); x != nullptr) {
+				if (-half < *x && *x < half && -half < *y && *y < half) { return *x * *y; }
+			}
+			return product(a, b);
+		}
+
+		friend auto operator/(num const& a, num const& b) -> num;
+
+		friend auto pow(num const& base, num const& exponent) -> num;
+
+		friend auto sqrt(num const& radicand) -> num;
+
+		friend auto operator==(num const& a, num const& b) -> bool {
+			if (auto const [x, y] = machine_ints(a, b); x != nullptr) { return *x == *y; }
+			return compare(a, b) == std::partial_ordering::equivalent;
+		}
+
+		friend auto operator<=>(num const& a, num const& b) -> std::partial_ordering {
+			if (auto const [x, y] = machine_ints(a, b); x != nullptr) { return *x <=> *y; }
+			return compare(a, b);
+		}
+
+	private:
+		template <typename... Tiers>
+		static auto rep_of(std::tuple<Tiers...>) -> std::variant<std::int64_t, double, big_int, rational, Tiers...>;
+		static auto rep_of(std::tuple<double>) -> std::variant<std::int64_t, double, big_int, rational>;
+
+		//! A representation. The policy's numbers of each working precision follow the machine and exact
+		//! representations, unless the policy's only numbers are doubles.
+		using rep = decltype(rep_of(numbers::tiers{}));
+
+		//! The index of the first of the policy's numbers in a representation.
+		static constexpr std::size_t first_tier = 4;
+
+		static constexpr std::int64_t min = std::numeric_limits<std::int64_t>::min();
+		static constexpr std::int64_t max = std::numeric_limits<std::int64_t>::max();
+
+		rep _value;
+
+		//! The machine integers of @p a and @p b if both are machine integers, or else nulls.
+		static auto machine_ints(num const& a, num const& b) noexcept
+			-> std::pair<std::int64_t const*, std::int64_t const*> {
+			auto const x = std::get_if<std::int64_t>(&a._value);
+			auto const y = std::get_if<std::int64_t>(&b._value);
+			if (x == nullptr || y == nullptr) { return {nullptr, nullptr}; }
+			return {x, y};
+		}
+
+		//! @p value as a double, if it's a double or a machine integer that's exactly a double.
+		static auto as_double(num const& value) -> std::optional<double>;
+
+		//! Whether this is a decimal of any precision, or for a binary policy, one of its numbers other than a double.
+		auto is_decimal() const noexcept -> bool {
+			return _value.index() >= first_tier;
+		}
+
+		//! Whether this is a machine integer, a big integer, or a rational.
+		auto is_exact() const noexcept -> bool {
+			return _value.index() != 1 && _value.index() < first_tier;
+		}
+
+		//! @p value, which must be exact, as a rational.
+		static auto as_rational(num const& value) -> rational;
+
+		//! @p value as a decimal of type @p D, converted into @p storage unless it already has that type.
+		template <typename D>
+		static auto as_decimal(num const& value, D& storage) -> D const&;
+
+		//! Calls @p f with the std::type_identity of the decimal type of the working precision.
+		template <typename F>
+		static auto at_working_precision(F f) -> num;
+
+		// The operations for operands that aren't both machine integers or whose results don't fit one.
+
+		auto negated() const -> num;
+		static auto sum(num const& a, num const& b) -> num;
+		static auto difference(num const& a, num const& b) -> num;
+		static auto product(num const& a, num const& b) -> num;
+		static auto compare(num const& a, num const& b) -> std::partial_ordering;
+
+		//! Applies @p op to @p a and @p b as big integers if both are integers, or else as rationals, if exact numbers
+		//! are enabled and both are exact.
+		template <typename Op>
+		static auto exactly(num const& a, num const& b, Op op) -> std::optional<num>;
+
+		//! Applies @p op to @p a and @p b as doubles if either is a double and the result is finite, or else as
+		//! decimals at the working precision.
+		//! @param inexact Whether the result isn't an integer, so that for machine integers, it may be a double if
+		//! binary floats are enabled.
+		template <typename Op>
+		static auto promoted(num const& a, num const& b, Op op, bool inexact = false) -> num;
+	};
+}
@@ -0,0 +1,514 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "operations.hpp"
+
+#include "combinatorics.hpp"
+#include "environment.hpp"
+#include "module_cache.hpp"
+#include "noinline.hpp"
+#include "vm.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+using namespace std::string_literals;
+
+namespace gynjo {
+	namespace {
+		//! Whether @p n is a natural number small enough for exact combinatorics.
+		auto exact_combinatorics_argument(val::num const& n) -> bool {
+			return n.is_integer() && n >= 0 && n <= val::max_exact_combinatorics;
+		}
+
+		//! @p n!, or for other than a natural number, the product of @p n, n - 1, n - 2, ... while greater than 1.
+		auto fact(val::num n) -> val::num {
+			if (exact_combinatorics_argument(n)) { return val::factorial(n.convert_to<std::uint64_t>()); }
+			val::num result = 1;
+			for (; n > 1; n = n - 1) {
+				result = n * result;
+			}
+			return result;
+		}
+
+		//! @p n choose @p k, where @p k is a natural number.
+		auto choose(val::num const& n, val::num const& k) -> val::num {
+			if (exact_combinatorics_argument(n)) {
+				if (k > n) { return 0; }
+				return val::binomial(n.convert_to<std::uint64_t>(), k.convert_to<std::uint64_t>());
+			}
+			// The falling factorial n (n - 1) ... (n - k + 1), over k!.
+			val::num falling = 1;
+			for (val::num i = 0; i < k; i = i + 1) {
+				falling = falling * (n - i);
+			}
+			return falling / fact(k);
+		}
+
+		//! Calls the intrinsic function closure @p c with @p arg. Kept out of apply, whose frame is on the stack once
+		//! for every nested call.
+		GYNJO_NOINLINE auto apply_intrinsic(val::closure const& c, val::tup arg) -> eval_result {
+			auto const& tree = *c.f.tree;
+			auto const body = c.f.child(1);
+			auto const call_env_result = call_env(c, std::move(arg), nullptr);
+			if (!call_env_result.has_value()) { return tl::unexpected{call_env_result.error()}; }
+			auto const& local_env = call_env_result.value();
+			// The intrinsics' parameter names.
+			static interned const list_param{"list"};
+			static interned const value_param{"value"};
+			static interned const n_param{"n"};
+			static interned const k_param{"k"};
+			switch (tree.intrinsic(body.node)) {
+				case intrinsic::top:
+					return match(
+						*local_env->lookup(list_param),
+						[](val::list const& list) -> eval_result { return list.head; },
+						[&](auto const& arg) -> eval_result {
+							return tl::unexpected{fmt::format(
+								"top() expected a non-empty list, found {}", val::to_string(arg, local_env))};
+						});
+				case intrinsic::pop:
+					return match(
+						*local_env->lookup(list_param),
+						[](val::list const& list) -> eval_result { return list.tail; },
+						[&](auto const& arg) -> eval_result {
+							return tl::unexpected{fmt::format(
+								"pop() expected a non-empty list, found {}", val::to_string(arg, local_env))};
+						});
+				case intrinsic::push:
+					return match(
+						*local_env->lookup(list_param),
+						[&](val::empty) -> eval_result {
+							return val::list{*local_env->lookup(value_param), val::empty{}};
+						},
+						[&](val::list const& list) -> eval_result {
+							return val::list{*local_env->lookup(value_param), list};
+						},
+						[&](auto const& arg) -> eval_result {
+							return tl::unexpected{
+								fmt::format("push() expected a list, found {}", val::to_string(arg, local_env))};
+						});
+				case intrinsic::print:
+					std::cout << fmt::format("{}\n", to_string(*local_env->lookup(value_param), local_env));
+					return val::make_tup();
+				case intrinsic::read: {
+					std::string result;
+					std::getline(std::cin, result);
+					return val::value{result};
+				}
+				case intrinsic::fact:
+					return match(
+						*local_env->lookup(n_param),
+						[](val::num const& n) -> eval_result { return fact(n); },
+						[&](auto const& arg) -> eval_result {
+							return tl::unexpected{
+								fmt::format("fact() expected a number, found {}", val::to_string(arg, local_env))};
+						});
+				case intrinsic::nCk:
+					return match2(
+						*local_env->lookup(n_param),
+						*local_env->lookup(k_param),
+						[&](val::num const& n, val::num const& k) -> eval_result {
+							if (!k.is_integer() || k < 0) {
+								return tl::unexpected{fmt::format(
+									"nCk() expected a natural number k, found {}", val::to_string(k, local_env))};
+							}
+							return choose(n, k);
+						},
+						[&](auto const& n, auto const& k) -> eval_result {
+							return tl::unexpected{fmt::format("nCk() expected numbers, found {} and {}",
+								val::to_string(n, local_env),
+								val::to_string(k, local_env))};
+						});
+				default:
+					// unreachable
+					return tl::unexpected{"call to unknown intrinsic function"s};
+			}
+		}
+	}
+
+	auto negate(env_ptr const& env, val::value const& value) -> eval_result {
+		return match(
+			value,
+			[](val::num num) -> eval_result { return -num; },
+			[&](auto const&) -> eval_result { return tl::unexpected{"cannot negate " + to_string(value, env)}; });
+	}
+
+	auto logical_not(env_ptr const& env, val::value const& value) -> eval_result {
+		return match(
+			value,
+			[](tok::boolean b) -> eval_result { return tok::boolean{!b.value}; },
+			[&](auto const&) -> eval_result {
+				return tl::unexpected{fmt::format("cannot take logical negation of {}", to_string(value, env))};
+			});
+	}
+
+	auto binary_op(node_kind op, env_ptr const& env, val::value const& left, val::value const& right) -> eval_result {
+		// Applies a numerical comparison.
+		auto const compare = [&](auto cmp) -> eval_result {
+			return match2(
+				left,
+				right,
+				[&](val::num const& left, val::num const& right) -> eval_result {
+					return tok::boolean{cmp(left, right)};
+				},
+				[&](auto const&, auto const&) -> eval_result {
+					return tl::unexpected{fmt::format("cannot compare {} and {}", to_string(left, env), to_string(right, env))};
+				});
+		};
+		switch (op) {
+			case node_kind::eq:
+				return tok::boolean{left == right};
+			case node_kind::neq:
+				return tok::boolean{left != right};
+			case node_kind::approx:
+				return tok::boolean{to_string(left, env) == to_string(right, env)};
+			case node_kind::lt:
+				return compare(std::less<>{});
+			case node_kind::leq:
+				return compare(std::less_equal<>{});
+			case node_kind::gt:
+				return compare(std::greater<>{});
+			case node_kind::geq:
+				return compare(std::greater_equal<>{});
+			case node_kind::add:
+				return bin_num_op(env, left, right, "addition", [](val::num const& addend1, val::num const& addend2) -> eval_result {
+					return addend1 + addend2;
+				});
+			case node_kind::sub:
+				return bin_num_op(
+					env, left, right, "subtraction", [](val::num const& minuend, val::num const& subtrahend) -> eval_result {
+						return minuend - subtrahend;
+					});
+			case node_kind::pow:
+				return bin_num_op(
+					env, left, right, "exponentiation", [](val::num const& base, val::num const& exponent) -> eval_result {
+						return pow(base, exponent);
+					});
+			case node_kind::mul:
+				return bin_num_op(
+					env, left, right, "multiplication", [](val::num const& factor1, val::num const& factor2) -> eval_result {
+						return factor1 * factor2;
+					});
+			case node_kind::div:
+				return bin_num_op(
+					env, left, right, "division", [](val::num const& dividend, val::num const& divisor) -> eval_result {
+						if (divisor == 0) { return tl::unexpected{"division by zero"s}; }
+						return dividend / divisor;
+					});
+			case node_kind::sqrt:
+				return bin_num_op(
+					env, left, right, "exponentiation", [](val::num const& radicand, val::num const&) -> eval_result {
+						return sqrt(radicand);
+					});
+			case node_kind::int_pow:
+				return bin_num_op(
+					env, left, right, "exponentiation", [](val::num const& base, val::num const& exponent) -> eval_result {
+						// Square and multiply, which is how pow handles integer exponents, so the result is the same.
+						val::num result = 1;
+						val::num square = base;
+						for (auto n = exponent.convert_to<unsigned>(); n > 0; n >>= 1) {
+							if ((n & 1) != 0) { result = result * square; }
+							if (n > 1) { square = square * square; }
+						}
+						return result;
+					});
+			default:
+				// unreachable
+				return tl::unexpected{"unknown binary operator"s};
+		}
+	}
+
+	auto apply(val::closure const& c, val::tup arg) -> eval_result {
+		if (c.f.child(1).kind() == node_kind::intrinsic) { return apply_intrinsic(c, std::move(arg)); }
+		if (current_engine() == engine::vm) {
+			auto const& code = bytecode(c.f);
+			return call_env(c, std::move(arg), &code).and_then([&](env_ptr const& local_env) {
+				return run(local_env, code);
+			});
+		}
+		return walk_call(c, std::move(arg));
+	}
+
+	auto max_depth_error(std::size_t depth) -> std::string {
+		return fmt::format("maximum call depth of {} exceeded", depth);
+	}
+
+	auto call_env(val::closure const& c, val::tup arg, chunk const* code) -> tl::expected<env_ptr, std::string> {
+		auto const& tree = *c.f.tree;
+		// The parser guarantees the parameter list is a tuple.
+		auto const params = tree.child_list(c.f.child(0).node);
+		// Ensure correct number of arguments.
+		if (arg.elems->size() != params.size()) {
+			return tl::unexpected{fmt::format("function requires {} argument{}, received {}",
+				params.size(),
+				params.size() == 1 ? "" : "s",
+				arg.elems->size())};
+		}
+		// Move the arguments into the frame, unless the tuple is shared, e.g. with a variable.
+		bool const unshared = arg.elems.use_count() == 1;
+		auto const take = [&](std::size_t i) -> val::value {
+			return unshared ? std::move((*arg.elems)[i]) : (*arg.elems)[i];
+		};
+		auto local_env = std::make_shared<environment>(c.env);
+		if (code != nullptr) {
+			// Assign arguments to parameter slots within a frame for the function's bytecode.
+			local_env->slot_names = code->slot_names;
+			local_env->slots.resize(code->slot_names.size());
+			for (std::size_t i = 0; i < arg.elems->size(); ++i) {
+				local_env->slots[code->param_slots[i]] = take(i);
+			}
+		} else {
+			// Assign arguments to parameters within a copy of the closure's environment.
+			for (std::size_t i = 0; i < arg.elems->size(); ++i) {
+				// The parser guarantees that each parameter is a symbol.
+				local_env->local_vars.insert_or_assign(tree.symbol(params[i]), take(i));
+			}
+		}
+		return local_env;
+	}
+
+	cluster_eval::cluster_eval(expr const& cluster, std::vector<val::value> items)
+		: _cluster{cluster}
+		, _items{std::move(items)}
+		, _remaining{_items.size()}
+		, _plan{cluster.tree->cached_plan(cluster.node)} {
+		// Follow the cached plan if the same items are closures as when it was recorded.
+		if (_plan != nullptr) {
+			for (std::size_t i = 0; i < _items.size(); ++i) {
+				if (_items[i].is<val::closure>() != _plan->closures[i]) {
+					_plan = nullptr;
+					break;
+				}
+			}
+		}
+		if (_plan == nullptr) {
+			auto trace = std::make_shared<cluster_plan>();
+			trace->closures.reserve(_items.size());
+			for (auto const& item : _items) {
+				trace->closures.push_back(item.is<val::closure>());
+			}
+			resolve_after(std::move(trace));
+		}
+	}
+
+	auto cluster_eval::advance(env_ptr const& env) -> tl::expected<std::optional<val::value>, std::string> {
+		// Follow the plan, unless a call's result doesn't fit it.
+		while (_plan != nullptr && _step < _plan->steps.size()) {
+			auto const done = perform(env, _plan->steps[_step++]);
+			if (!done.has_value()) { return tl::unexpected{done.error()}; }
+			if (!done.value()) { return std::nullopt; }
+		}
+		if (_plan == nullptr) {
+			auto const done = resolve(env);
+			if (!done.has_value()) { return tl::unexpected{done.error()}; }
+			if (!done.value()) { return std::nullopt; }
+			_cluster.tree->cache_plan(_cluster.node, std::move(_trace));
+		}
+		// At this point, all values are folded into the first item. Apply final negation if necessary.
+		if (_cluster.tree->negated(_cluster.node, 0)) {
+			auto negate_result = negate(env, _items.front());
+			if (!negate_result.has_value()) { return tl::unexpected{negate_result.error()}; }
+			_items.front() = std::move(negate_result.value());
+		}
+		return std::move(_items.front());
+	}
+
+	auto cluster_eval::call_is_last() const -> bool {
+		// Only a final negation could follow the call.
+		return _remaining == 2 && !_cluster.tree->negated(_cluster.node, 0);
+	}
+
+	auto cluster_eval::resume(val::value result) -> void {
+		bool const closure = result.is<val::closure>();
+		combine(_pending, std::move(result));
+		if (_plan == nullptr) {
+			_trace->steps.back().closure_result = closure;
+		} else if (closure != _pending.closure_result) {
+			// The rest of the plan depends on the result's type, so resolve the rest of the order of operations.
+			auto trace = std::make_shared<cluster_plan>();
+			trace->closures = _plan->closures;
+			trace->steps.assign(_plan->steps.begin(), _plan->steps.begin() + _step);
+			trace->steps.back().closure_result = closure;
+			resolve_after(std::move(trace));
+		}
+	}
+
+	auto cluster_eval::resolve_after(std::shared_ptr<cluster_plan> trace) -> void {
+		auto const end = static_cast<std::uint32_t>(_items.size());
+		_links.resize(_items.size());
+		for (std::uint32_t i = 0; i < end; ++i) {
+			_links[i] = {i + 1, i == 0 ? end : i - 1, i + 1 < end ? _cluster.tree->connector(_cluster.node, i) : connector{}};
+		}
+		for (auto const& step : trace->steps) {
+			unlink(step);
+		}
+		// Continue the application phase of the last step, with the application's result.
+		if (trace->steps.empty()) {
+			_phase = phase::paren_applications;
+			_index = 0;
+		} else {
+			auto const& last = trace->steps.back();
+			_phase = last.kind == cluster_plan::op::apply_paren ? phase::paren_applications : phase::nonparen_applications;
+			_index = last.left;
+		}
+		_trace = std::move(trace);
+		_plan = nullptr;
+	}
+
+	auto cluster_eval::resolve(env_ptr const& env) -> tl::expected<bool, std::string> {
+		auto const end = static_cast<std::uint32_t>(_items.size());
+		auto const record = [&](cluster_plan::op op, std::uint32_t left) {
+			_trace->steps.push_back({op, false, left, _links[left].next});
+			return _trace->steps.back();
+		};
+		if (_phase == phase::paren_applications) {
+			auto const finished = applications(env, connector::adj_paren);
+			if (!finished.has_value() || !finished.value()) { return finished; }
+			_phase = phase::exponentiations;
+		}
+		if (_phase == phase::exponentiations) {
+			// Exponentiation is right-associative, so do exponentiations from right to left.
+			std::uint32_t last = 0;
+			while (_links[last].next != end) {
+				last = _links[last].next;
+			}
+			for (auto i = _links[last].prev; i != end; i = _links[i].prev) {
+				if (_links[i].conn == connector::exp) {
+					auto const done = perform(env, record(cluster_plan::op::pow, i));
+					if (!done.has_value()) { return done; }
+				}
+			}
+			_phase = phase::nonparen_applications;
+			_index = 0;
+		}
+		if (_phase == phase::nonparen_applications) {
+			auto const finished = applications(env, connector::adj_nonparen);
+			if (!finished.has_value() || !finished.value()) { return finished; }
+			_phase = phase::products;
+		}
+		// Do multiplication and division, from left to right.
+		while (_links[0].next != end) {
+			// Division is the only explicit operation left besides multiplication.
+			auto const op = _links[0].conn == connector::div ? cluster_plan::op::div : cluster_plan::op::mul;
+			auto const done = perform(env, record(op, 0));
+			if (!done.has_value()) { return done; }
+		}
+		return true;
+	}
+
+	auto cluster_eval::applications(env_ptr const& env, connector conn) -> tl::expected<bool, std::string> {
+		auto const end = static_cast<std::uint32_t>(_items.size());
+		auto const op = conn == connector::adj_paren ? cluster_plan::op::apply_paren : cluster_plan::op::apply_nonparen;
+		while (_links[_index].next != end) {
+			auto const i = _index;
+			if (_links[i].conn != conn || !_items[i].is<val::closure>()) {
+				_index = _links[i].next;
+				continue;
+			}
+			// The result might be a function too, so the next application to try is of the same item.
+			_trace->steps.push_back({op, false, i, _links[i].next});
+			auto const done = perform(env, _trace->steps.back());
+			if (!done.has_value() || !done.value()) { return done; }
+		}
+		return true;
+	}
+
+	auto cluster_eval::perform(env_ptr const& env, cluster_plan::step const& step) -> tl::expected<bool, std::string> {
+		// Apply negation if necessary.
+		if (_cluster.tree->negated(_cluster.node, step.right)) {
+			auto negate_result = negate(env, _items[step.right]);
+			if (!negate_result.has_value()) { return tl::unexpected{negate_result.error()}; }
+			_items[step.right] = std::move(negate_result.value());
+		}
+		auto const& left = _items[step.left];
+		auto const& right = _items[step.right];
+		eval_result result;
+		switch (step.kind) {
+			case cluster_plan::op::apply_paren:
+			case cluster_plan::op::apply_nonparen: {
+				// Wrap the argument in a tuple if it isn't one already. Both items are replaced on resumption, so they
+				// can be moved from.
+				auto f = _items[step.left].take<val::closure>();
+				auto& arg = _items[step.right];
+				val::tup args = arg.is<val::tup>() ? arg.take<val::tup>() : val::make_tup(arg);
+				_pending = step;
+				if (f.f.child(1).kind() != node_kind::intrinsic) {
+					// Stop here so that the caller can make the call.
+					_call.emplace(std::move(f), std::move(args));
+					return false;
+				}
+				// Intrinsics don't evaluate any Gynjo code, so they can be applied here.
+				result = apply(f, std::move(args));
+				if (!result.has_value()) { return tl::unexpected{result.error()}; }
+				resume(std::move(result.value()));
+				return true;
+			}
+			case cluster_plan::op::pow:
+				result = binary_op(node_kind::pow, env, left, right);
+				break;
+			case cluster_plan::op::mul:
+				result = binary_op(node_kind::mul, env, left, right);
+				break;
+			case cluster_plan::op::div:
+				result = binary_op(node_kind::div, env, left, right);
+				break;
+		}
+		if (!result.has_value()) { return tl::unexpected{result.error()}; }
+		combine(step, std::move(result.value()));
+		return true;
+	}
+
+	auto cluster_eval::combine(cluster_plan::step const& step, val::value result) -> void {
+		_items[step.left] = std::move(result);
+		--_remaining;
+		if (_plan == nullptr) { unlink(step); }
+	}
+
+	auto cluster_eval::unlink(cluster_plan::step const& step) -> void {
+		auto const next = _links[step.right].next;
+		_links[step.left].next = next;
+		_links[step.left].conn = _links[step.right].conn;
+		if (next != _items.size()) { _links[next].prev = step.left; }
+	}
+
+	auto eval_cluster(env_ptr const& env,
+		expr const& cluster,
+		std::vector<val::value> items,
+		std::optional<deferred_call>* tail) -> eval_result {
+		cluster_eval evaluation{cluster, std::move(items)};
+		for (;;) {
+			auto result = evaluation.advance(env);
+			if (!result.has_value()) { return tl::unexpected{result.error()}; }
+			if (result.value().has_value()) { return std::move(*result.value()); }
+			auto& call = evaluation.call();
+			if (tail != nullptr && evaluation.call_is_last()) {
+				*tail = std::move(call);
+				return val::make_tup();
+			}
+			auto call_result = apply(call.f, std::move(call.arg));
+			if (!call_result.has_value()) { return call_result; }
+			evaluation.resume(std::move(call_result.value()));
+		}
+	}
+
+	auto import_module(env_ptr const& env, std::string_view filename) -> exec_result {
+		std::filesystem::path const path{filename};
+		// Execute the cached module, if it's valid or can be made so.
+		if (auto const module = load_module(path)) {
+			prepare(*module->tree);
+			for (auto const module_stmt : module->stmts) {
+				auto const exec_result = exec(env, gynjo::stmt{module->tree.get(), module_stmt});
+				if (!exec_result.has_value()) { return tl::unexpected{"(runtime error) " + exec_result.error()}; }
+			}
+			return std::monostate{};
+		}
+		// Otherwise, interpret the source incrementally, which holds only a statement at a time in memory and reports any
+		// errors in the source.
+		std::ifstream fin{path};
+		if (!fin.is_open()) { return tl::unexpected{fmt::format("failed to load library \"{}\"", filename)}; }
+		return exec(env, fin);
+	}
+}
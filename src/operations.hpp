@@ -0,0 +1,204 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Operations on values, shared by the tree walker and the virtual machine.
+
+#pragma once
+
+#include "bytecode.hpp"
+#include "interpreter.hpp"
+#include "visitation.hpp"
+
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace gynjo {
+	//! Applies @p f to each element of @p list. This is iterative, so long lists can't overflow the stack.
+	//! @return The list of results, or the first error.
+	template <typename F>
+	auto map_list(val::list const& list, F&& f) -> eval_result {
+		std::vector<val::value> results;
+		for (val::list const* node = &list;;) {
+			auto result = f(node->head);
+			if (!result.has_value()) { return result; }
+			results.push_back(std::move(result.value()));
+			if (!node->tail.is<val::list>()) { break; }
+			node = &node->tail.as<val::list>();
+		}
+		// Build the result from the back.
+		val::value tail = val::empty{};
+		for (auto it = results.rbegin(); it != results.rend(); ++it) {
+			tail = val::list{std::move(*it), std::move(tail)};
+		}
+		return tail;
+	}
+
+	template <typename F>
+	auto bin_num_op(env_ptr const& env, val::value const& left, val::value const& right, std::string_view op_name, F&& op)
+		-> eval_result {
+		return match2(
+			left,
+			right,
+			// Basic
+			[&](val::num const& left, val::num const& right) -> eval_result {
+				return std::forward<F>(op)(left, right);
+			},
+			// Empty list
+			[](val::empty const&, val::num const&) -> eval_result { return val::empty{}; },
+			[](val::num const&, val::empty const&) -> eval_result { return val::empty{}; },
+			// Non-empty list
+			[&](val::list const& left, val::num const& right) -> eval_result {
+				return map_list(left, [&](val::value const& head) { return bin_num_op(env, head, right, op_name, op); });
+			},
+			[&](val::num const& left, val::list const& right) -> eval_result {
+				return map_list(right, [&](val::value const& head) { return bin_num_op(env, left, head, op_name, op); });
+			},
+			// Invalid
+			[&](auto const&, auto const&) -> eval_result {
+				return tl::unexpected{fmt::format(
+					"cannot perform {} with {} and {}", op_name, to_string(left, env), to_string(right, env))};
+			});
+	}
+
+	//! Negates @p value, which must be a number.
+	auto negate(env_ptr const& env, val::value const& value) -> eval_result;
+
+	//! Takes the logical negation of @p value, which must be a boolean.
+	auto logical_not(env_ptr const& env, val::value const& value) -> eval_result;
+
+	//! Applies the binary operator @p op, which is an equality check, comparison, or arithmetic operation, to @p left and
+	//! @p right.
+	auto binary_op(node_kind op, env_ptr const& env, val::value const& left, val::value const& right) -> eval_result;
+
+	//! A call to a function with a Gynjo body, deferred so that the caller can make it without nesting.
+	struct deferred_call {
+		val::closure f;
+		val::tup arg;
+	};
+
+	//! Applies the closure @p c to the arguments @p arg.
+	auto apply(val::closure const& c, val::tup arg) -> eval_result;
+
+	//! The error for a call that would nest more than @p depth calls deep.
+	auto max_depth_error(std::size_t depth) -> std::string;
+
+	//! Creates the environment in which to apply @p c to @p arg, or an error if the arguments don't fit the parameters.
+	//! @param code The bytecode for the function's body, if it's to be run on the VM, in which case the environment
+	//! holds the arguments in the slots of a frame for @p code.
+	auto call_env(val::closure const& c, val::tup arg, chunk const* code) -> tl::expected<env_ptr, std::string>;
+
+	//! Applies @p c, which has a Gynjo body, to @p arg by walking the body's syntax tree. Calls in tail position are
+	//! made without nesting.
+	auto walk_call(val::closure c, val::tup arg) -> eval_result;
+
+	//! The order of operations of a cluster, recorded while evaluating it, so that later evaluations can follow it instead
+	//! of resolving the order again. Which items are function applications depends on which values are closures, so a
+	//! plan only applies while the same items are closures.
+	struct cluster_plan {
+		enum class op : std::uint8_t { apply_paren, apply_nonparen, pow, mul, div };
+
+		//! An operation on two adjacent remaining items, whose result replaces the left item.
+		struct step {
+			op kind;
+			//! For an application, whether the result was a closure, which the rest of the plan depends on.
+			bool closure_result;
+			std::uint32_t left;
+			std::uint32_t right;
+		};
+
+		//! Which items were closures.
+		std::vector<bool> closures;
+		std::vector<step> steps;
+	};
+
+	//! Evaluation of a cluster, given the values of its items. Which items are function applications depends on the
+	//! values, so this is where clusters are finally parsed. The order of operations is cached in a plan for the
+	//! cluster's node, which is followed as long as the items' types fit it.
+	//! @note Evaluation stops at each call to a function with a Gynjo body, so that the caller can make the call without
+	//! nesting it inside the evaluation.
+	class cluster_eval {
+	public:
+		cluster_eval(expr const& cluster, std::vector<val::value> items);
+
+		//! Continues evaluation in @p env.
+		//! @return The value of the cluster, nullopt if evaluation stopped at a call, or an error.
+		auto advance(env_ptr const& env) -> tl::expected<std::optional<val::value>, std::string>;
+
+		//! The call at which evaluation stopped. The caller may move from it.
+		auto call() noexcept -> deferred_call& {
+			return *_call;
+		}
+
+		//! Whether the result of the call at which evaluation stopped is the value of the cluster.
+		auto call_is_last() const -> bool;
+
+		//! Supplies @p result as the result of the call at which evaluation stopped. Continue with advance.
+		auto resume(val::value result) -> void;
+
+	private:
+		//! The order in which the operations of a cluster are resolved.
+		enum class phase : std::uint8_t { paren_applications, exponentiations, nonparen_applications, products };
+
+		//! A remaining item's neighbors, by index, and its connector to the next one.
+		struct link {
+			std::uint32_t next;
+			std::uint32_t prev;
+			connector conn;
+		};
+
+		expr _cluster;
+		//! The items, by their index in the cluster. An operation's result replaces its left item.
+		std::vector<val::value> _items;
+		//! The number of items not yet consumed as the right operand of an operation.
+		std::size_t _remaining;
+		//! The plan being followed, or null if the order of operations is being resolved.
+		std::shared_ptr<cluster_plan const> _plan;
+		//! The index of the next step of the plan.
+		std::size_t _step = 0;
+		//! While resolving, the plan recorded so far.
+		std::shared_ptr<cluster_plan> _trace;
+		//! While resolving, the links between remaining items.
+		std::vector<link> _links;
+		phase _phase = phase::paren_applications;
+		//! While resolving an application phase, the item that might be applied next.
+		std::uint32_t _index = 0;
+		std::optional<deferred_call> _call;
+		//! The application awaiting the result of the call.
+		cluster_plan::step _pending{};
+
+		//! Starts resolving the order of operations from the state after the steps of @p trace, recording into it.
+		auto resolve_after(std::shared_ptr<cluster_plan> trace) -> void;
+
+		//! Continues resolving the order of operations, recording each operation and performing it.
+		//! @return Whether all operations are done, false if evaluation stopped at a call, or an error.
+		auto resolve(env_ptr const& env) -> tl::expected<bool, std::string>;
+
+		//! Applies functions joined to their arguments by @p conn, from left to right.
+		//! @return Whether all such applications are done, or an error.
+		auto applications(env_ptr const& env, connector conn) -> tl::expected<bool, std::string>;
+
+		//! Performs @p step.
+		//! @return Whether it's done, false if evaluation stopped at a call, or an error.
+		auto perform(env_ptr const& env, cluster_plan::step const& step) -> tl::expected<bool, std::string>;
+
+		//! Replaces the left item of @p step with @p result and consumes the right item.
+		auto combine(cluster_plan::step const& step, val::value result) -> void;
+
+		//! Removes the right item of @p step from the links.
+		auto unlink(cluster_plan::step const& step) -> void;
+	};
+
+	//! Evaluates @p cluster, given the values of its @p items, making any calls it contains.
+	//! @param tail If not null and the cluster's last operation is a call to a function with a Gynjo body, the call is
+	//! stored here instead of being made, and the result is the empty tuple.
+	auto eval_cluster(env_ptr const& env,
+		expr const& cluster,
+		std::vector<val::value> items,
+		std::optional<deferred_call>* tail = nullptr) -> eval_result;
+
+	//! Executes the statements in the file @p filename in the context of @p env.
+	auto import_module(env_ptr const& env, std::string_view filename) -> exec_result;
+}
@@ -0,0 +1,153 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "optimizer.hpp"
+
+#include "environment.hpp"
+#include "operations.hpp"
+
+#include <optional>
+#include <string>
+
+namespace gynjo {
+	namespace {
+		//! The largest exponent for which exponentiation is rewritten into repeated multiplication.
+		constexpr unsigned max_int_pow = 64;
+
+		//! The value of @p node if it's a literal.
+		auto literal_value(ast const& tree, node_id node) -> std::optional<val::value> {
+			switch (tree.kind(node)) {
+				case node_kind::boolean:
+					return tok::boolean{tree.boolean(node)};
+				case node_kind::num:
+					return tree.number(node);
+				case node_kind::str:
+					return std::string{tree.literal(node)};
+				default:
+					return std::nullopt;
+			}
+		}
+
+		//! The value of @p node if it's a number literal or a quotient of two, for choosing how to compute a power by
+		//! it. A quotient isn't folded, since its value can depend on the numeric mode, but its being one half can't.
+		auto exponent_value(ast const& tree, node_id node) -> std::optional<val::num> {
+			switch (tree.kind(node)) {
+				case node_kind::num:
+					return tree.number(node);
+				case node_kind::div: {
+					auto const dividend = tree.child(node, 0);
+					auto const divisor = tree.child(node, 1);
+					bool const literals = tree.kind(dividend) == node_kind::num && tree.kind(divisor) == node_kind::num;
+					if (!literals || tree.number(divisor) == 0) { return std::nullopt; }
+					return tree.number(dividend) / tree.number(divisor);
+				}
+				default:
+					return std::nullopt;
+			}
+		}
+
+		//! Whether @p value is the same in any numeric mode and at any working precision, i.e. it's not a number other
+		//! than a machine integer.
+		auto is_mode_independent(val::value const& value) -> bool {
+			val::num storage;
+			return !value.is<val::num>() || value.as(storage).is_machine_int();
+		}
+
+		//! Replaces @p node with a literal of @p result, if the result is a machine integer or a boolean. Other numbers
+		//! depend on the working precision and numeric modes in effect when the code runs, so they're left to
+		//! evaluation.
+		auto fold(ast& tree, node_id node, eval_result const& result) -> void {
+			if (!result.has_value()) { return; }
+			auto const& value = result.value();
+			if (value.is<val::num>()) {
+				val::num storage;
+				if (auto const i = value.as(storage).machine_int()) { tree.replace(node, tree.add_number(*i)); }
+			} else if (value.is<tok::boolean>()) {
+				tree.replace(node, tree.add_boolean(value.as<tok::boolean>().value));
+			}
+		}
+	}
+
+	auto optimize_node(ast& tree, node_id node) -> void {
+		// Evaluation only consults the environment to describe values in error messages, and errors aren't folded.
+		static env_ptr const env = environment::make_empty();
+		switch (tree.kind(node)) {
+			case node_kind::cond:
+				// Keep just the branch that a constant test selects.
+				if (tree.kind(tree.child(node, 0)) == node_kind::boolean) {
+					tree.replace(node, tree.child(node, tree.boolean(tree.child(node, 0)) ? 1 : 2));
+				}
+				break;
+			case node_kind::and_:
+			case node_kind::or_: {
+				auto const left = tree.child(node, 0);
+				auto const right = tree.child(node, 1);
+				if (tree.kind(left) == node_kind::boolean && tree.kind(right) == node_kind::boolean) {
+					bool const result = tree.kind(node) == node_kind::and_ ? tree.boolean(left) && tree.boolean(right)
+																			: tree.boolean(left) || tree.boolean(right);
+					tree.replace(node, tree.add_boolean(result));
+				}
+				break;
+			}
+			case node_kind::not_:
+				if (auto const operand = literal_value(tree, tree.child(node, 0))) {
+					fold(tree, node, logical_not(env, *operand));
+				}
+				break;
+			case node_kind::neg: {
+				auto const operand = tree.child(node, 0);
+				if (tree.kind(operand) == node_kind::num) {
+					// Negative literals are common, and flipping the sign of the text is much cheaper than formatting
+					// the negated value.
+					auto const text = tree.literal(operand);
+					auto const negated = text.starts_with('-') ? std::string{text.substr(1)} : "-" + std::string{text};
+					tree.replace(node, tree.add_literal(node_kind::num, negated));
+				} else if (auto const value = literal_value(tree, operand)) {
+					fold(tree, node, negate(env, *value));
+				}
+				break;
+			}
+			case node_kind::eq:
+			case node_kind::neq:
+			case node_kind::lt:
+			case node_kind::leq:
+			case node_kind::gt:
+			case node_kind::geq:
+			case node_kind::add:
+			case node_kind::sub:
+			case node_kind::mul:
+			case node_kind::div:
+			case node_kind::pow: {
+				// Approximate equality isn't folded, since it depends on the precision at the time of evaluation.
+				auto const left = literal_value(tree, tree.child(node, 0));
+				auto const right = literal_value(tree, tree.child(node, 1));
+				if (left.has_value() && right.has_value() && is_mode_independent(*left) &&
+					is_mode_independent(*right)) {
+					fold(tree, node, binary_op(tree.kind(node), env, *left, *right));
+					break;
+				}
+				if (tree.kind(node) != node_kind::pow) { break; }
+				// Rewrite exponentiation by a constant into a cheaper operation with the same result.
+				static val::num const one_half{"0.5"};
+				auto const exponent = exponent_value(tree, tree.child(node, 1));
+				if (!exponent.has_value()) { break; }
+				bool const small_integer = *exponent >= 2 && *exponent <= max_int_pow && exponent->is_integer();
+				if (*exponent == one_half) {
+					tree.replace(node, tree.add(node_kind::sqrt, {tree.child(node, 0), tree.child(node, 1)}));
+				} else if (small_integer) {
+					tree.replace(node, tree.add(node_kind::int_pow, {tree.child(node, 0), tree.child(node, 1)}));
+				}
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	auto optimize(ast& tree, node_id first) -> void {
+		auto const end = static_cast<node_id>(tree.size());
+		for (node_id node = first; node < end; ++node) {
+			optimize_node(tree, node);
+		}
+	}
+}
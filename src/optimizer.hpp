@@ -0,0 +1,22 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Constant folding and algebraic simplification of syntax trees.
+
+#pragma once
+
+#include "ast.hpp"
+
+namespace gynjo {
+	//! Folds @p node into a literal if it's an operation on literals, or otherwise rewrites it into an equivalent but
+	//! cheaper operation if possible. The node's children must already be optimized.
+	//! @note Folding never changes a result, and a rewritten operation gives the same result, except that a square root
+	//! can differ from the general power it replaces in guard digits beyond the working precision. Only operations on
+	//! booleans, strings and machine integers that give a machine integer or a boolean are folded, since other numbers
+	//! depend on the precision and numeric modes in effect when the code runs. Operations that fail are left for
+	//! evaluation to report. Symbols are never folded, not even core constants, since any code can rebind
+	//! them.
+	auto optimize_node(ast& tree, node_id node) -> void;
+
+	//! Optimizes each node of @p tree from @p first on, in order.
+	auto optimize(ast& tree, node_id first = 0) -> void;
+}
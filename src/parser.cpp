@@ -3,167 +3,227 @@
 
 #include "parser.hpp"
 
+#include "noinline.hpp"
 #include "visitation.hpp"
 
+#include <fmt/format.h>
+
 #include <algorithm>
+#include <optional>
+#include <utility>
 
 namespace gynjo {
 	namespace {
 		using namespace std::string_literals;
 
-		//! Parses a function body.
-		auto parse_body(token_it begin, token_it end) -> parse_expr_result {
-			if (begin == end || !std::holds_alternative<tok::arrow>(*begin)) {
-				return tl::unexpected{"expected function body"s};
+		//! The maximum nesting depth set by set_max_nesting_depth.
+		std::size_t selected_max_nesting_depth = default_max_nesting_depth;
+
+		//! The number of levels of nested expressions and statements being parsed on this thread.
+		thread_local std::size_t nesting_depth = 0;
+
+		//! Whether the current parse on this thread has exceeded the maximum nesting depth.
+		thread_local bool nesting_exceeded = false;
+
+		//! Whether a parse is in progress on this thread.
+		thread_local bool parsing = false;
+
+		//! The error for a parse that exceeded the maximum nesting depth.
+		auto nesting_error() -> std::string {
+			return fmt::format("maximum nesting depth of {} exceeded", selected_max_nesting_depth);
+		}
+
+		//! A level of nesting, for as long as it's in scope.
+		class nesting_level {
+		public:
+			//! @param counts Whether this level counts toward the maximum nesting depth.
+			explicit nesting_level(bool counts = true) : _outermost{!parsing}, _counts{counts} {
+				parsing = true;
+				if (_counts) { ++nesting_depth; }
+			}
+
+			~nesting_level() {
+				if (_counts) { --nesting_depth; }
+				if (_outermost) {
+					parsing = false;
+					nesting_exceeded = false;
+				}
 			}
-			return parse_expr(begin + 1, end);
+
+			nesting_level(nesting_level const&) = delete;
+			auto operator=(nesting_level const&) -> nesting_level& = delete;
+
+			//! Whether this level is too deep to parse. Once the limit is exceeded, the rest of the parse fails fast.
+			auto too_deep() const -> bool {
+				if (nesting_depth > selected_max_nesting_depth) { nesting_exceeded = true; }
+				return nesting_exceeded;
+			}
+
+			//! @p result, or if this is the outermost level and the limit was exceeded, the error for that. Callers
+			//! replace the errors of the levels they contain with their own, so the limit is reported only here.
+			template <typename Result>
+			auto checked(Result result) const -> Result {
+				if (_outermost && nesting_exceeded) { return tl::unexpected{nesting_error()}; }
+				return result;
+			}
+
+		private:
+			bool _outermost;
+			bool _counts;
+		};
+
+		//! Whether the token at @p it exists and is a @p T.
+		template <typename T>
+		auto next_is(token_it it, token_it end) -> bool {
+			return it != end && std::holds_alternative<T>(*it);
+		}
+
+		//! Whether the token at @p it can begin a value. Used to predict whether a cluster continues.
+		auto starts_value(token_it it, token_it end) -> bool {
+			if (it == end) { return false; }
+			return match(
+				*it,
+				[](tok::lparen) { return true; },
+				[](tok::lsquare) { return true; },
+				[](tok::lcurly) { return true; },
+				[](intrinsic) { return true; },
+				[](tok::boolean) { return true; },
+				[](tok::num) { return true; },
+				[](tok::str) { return true; },
+				[](tok::sym) { return true; },
+				[](auto const&) { return false; });
+		}
+
+		//! Parses a function body, starting after "->".
+		auto parse_body(ast& tree, token_it begin, token_it end) -> parse_expr_result {
+			auto body_result = parse_expr(tree, begin, end);
+			if (!body_result.has_value()) { return tl::unexpected{"expected function body"s}; }
+			return body_result;
+		}
+
+		//! Parses a comma-separated series of expressions, starting after the opening bracket and ending with the closing
+		//! bracket @p Close. Calls @p push on each expression in order.
+		//! @return An iterator past the closing bracket, or an error message.
+		template <typename Close, typename Push>
+		auto parse_elems(ast& tree, token_it begin, token_it end, Push push, char const* close_error)
+			-> tl::expected<token_it, std::string> {
+			auto it = begin;
+			if (!next_is<Close>(it, end)) {
+				for (;;) {
+					auto elem_result = parse_expr(tree, it, end);
+					if (!elem_result.has_value()) { return tl::unexpected{std::move(elem_result.error())}; }
+					it = elem_result.value().it;
+					push(std::move(elem_result.value().expr));
+					if (!next_is<tok::com>(it, end)) { break; }
+					++it;
+				}
+			}
+			if (!next_is<Close>(it, end)) { return tl::unexpected{std::string{close_error}}; }
+			return it + 1;
+		}
+
+		//! Parses a tuple or a lambda with a parenthesized parameter list, starting after "(".
+		auto parse_tup_or_lambda(ast& tree, token_it begin, token_it end) -> parse_expr_result {
+			std::vector<node_id> elems;
+			// Keep track of whether all tup elements are symbols (possible lambda parameter list).
+			bool could_be_lambda = true;
+			auto const elems_result = parse_elems<tok::rparen>(
+				tree,
+				begin,
+				end,
+				[&](expr elem) {
+					could_be_lambda = could_be_lambda && elem.kind() == node_kind::sym;
+					elems.push_back(elem.node);
+				},
+				"expected ')'");
+			if (!elems_result.has_value()) { return tl::unexpected{elems_result.error()}; }
+			auto const it = elems_result.value();
+			// A parameter list followed by an arrow is a lambda.
+			if (could_be_lambda && next_is<tok::arrow>(it, end)) {
+				auto body_result = parse_body(tree, it + 1, end);
+				if (!body_result.has_value()) { return body_result; }
+				// Assemble lambda from parameter tuple and body.
+				auto const [body_end, body] = body_result.value();
+				auto const params = tree.add_list(node_kind::tup, elems);
+				return it_expr{body_end, expr{&tree, tree.add(node_kind::lambda, {params, body.node})}};
+			}
+			// Collapse singletons back into their contained values. This allows use of parentheses for value grouping
+			// without having to special-case interpretation when an argument is a singleton.
+			return it_expr{it,
+				expr{&tree,
+					elems.size() == 1
+						// Extract singleton element.
+						? elems.front()
+						// Make tuple.
+						: tree.add_list(node_kind::tup, elems)}};
+		}
+
+		//! Parses a list, starting after "[".
+		auto parse_list(ast& tree, token_it begin, token_it end) -> parse_expr_result {
+			std::vector<node_id> elems;
+			auto const elems_result = parse_elems<tok::rsquare>(
+				tree, begin, end, [&](expr elem) { elems.push_back(elem.node); }, "expected ']' after list");
+			if (!elems_result.has_value()) { return tl::unexpected{elems_result.error()}; }
+			std::reverse(elems.begin(), elems.end());
+			return it_expr{elems_result.value(), expr{&tree, tree.add_list(node_kind::list, elems)}};
+		}
+
+		//! Parses a statement block, starting after "{".
+		auto parse_block(ast& tree, token_it begin, token_it end) -> parse_expr_result {
+			std::vector<node_id> stmts;
+			auto it = begin;
+			while (it != end && !std::holds_alternative<tok::rcurly>(*it)) {
+				auto stmt_result = parse_stmt(tree, it, end);
+				if (!stmt_result.has_value()) { return tl::unexpected{std::move(stmt_result.error())}; }
+				it = stmt_result.value().it;
+				stmts.push_back(stmt_result.value().stmt.node);
+			}
+			// Parse close curly brace.
+			if (it == end) { return tl::unexpected{"expected '}' after statement block"s}; }
+			return it_expr{it + 1, expr{&tree, tree.add_list(node_kind::block, stmts)}};
 		}
 
 		//! Parses a Gynjo value.
-		auto parse_value(token_it begin, token_it end) -> parse_expr_result {
+		auto parse_value(ast& tree, token_it begin, token_it end) -> parse_expr_result {
 			if (begin == end) { return tl::unexpected{"expected value"s}; }
-			auto const first_token = *begin;
-			auto it = begin + 1;
+			auto const it = begin + 1;
 			return match(
-				first_token,
+				*begin,
 				// Tuple or lambda
-				[&](tok::lparen const&) -> parse_expr_result {
-					tup_expr tup;
-					// Keep track of whether all tup elements are symbols (possible lambda parameter list).
-					bool could_be_lambda = true;
-					// Try to parse an expression.
-					auto first_result = parse_expr(it, end);
-					if (first_result.has_value()) {
-						auto [first_end, first] = std::move(first_result.value());
-						it = first_end;
-						could_be_lambda = could_be_lambda && std::holds_alternative<tok::sym>(first.value);
-						tup.elems->push_back(std::move(first));
-						// Try to parse additional comma-delimited expressions.
-						while (it != end && std::holds_alternative<tok::com>(*it)) {
-							++it;
-							auto next_result = parse_expr(it, end);
-							if (next_result.has_value()) {
-								auto [next_end, next] = std::move(next_result.value());
-								it = next_end;
-								could_be_lambda = could_be_lambda && std::holds_alternative<tok::sym>(next.value);
-								tup.elems->push_back(std::move(next));
-							} else {
-								return tl::unexpected{"expected expression after ','"s};
-							}
-						}
-					}
-					// Parse close parenthesis.
-					if (it == end || !std::holds_alternative<tok::rparen>(*it)) {
-						return tl::unexpected{"expected ')'"s};
-					}
-					++it;
-					// Check for lambda expression.
-					if (could_be_lambda) {
-						// Try to parse a lambda body.
-						auto body_result = parse_body(it, end);
-						if (body_result.has_value()) {
-							// Assemble lambda from parameter tuple and body.
-							auto [body_end, body] = std::move(body_result.value());
-							return it_expr{body_end, lambda{make_expr(std::move(tup)), make_expr(std::move(body))}};
-						}
-					}
-					// Collapse singletons back into their contained values. This allows use of parentheses for
-					// value grouping without having to special-case interpretation when an argument is a singleton.
-					return it_expr{it,
-						tup.elems->size() == 1
-							// Extract singleton element.
-							? std::move(tup.elems->front())
-							// Return unmodified tuple.
-							: expr{std::move(tup)}};
-				},
+				[&](tok::lparen) { return parse_tup_or_lambda(tree, it, end); },
 				// List
-				[&](tok::lsquare const&) -> parse_expr_result {
-					list_expr list;
-					// Try to parse an expression.
-					auto first_result = parse_expr(it, end);
-					if (first_result.has_value()) {
-						auto [first_end, first] = std::move(first_result.value());
-						it = first_end;
-						list.elems->push_front(std::move(first));
-						// Try to parse additional comma-delimited expressions.
-						while (it != end && std::holds_alternative<tok::com>(*it)) {
-							++it;
-							auto next_result = parse_expr(it, end);
-							if (next_result.has_value()) {
-								auto [next_end, next] = std::move(next_result.value());
-								it = next_end;
-								list.elems->push_front(std::move(next));
-							} else {
-								return tl::unexpected{"expected expression after ',' in list"s};
-							}
-						}
-					}
-					// Parse close square bracket.
-					if (it == end || !std::holds_alternative<tok::rsquare>(*it)) {
-						return tl::unexpected{"expected ']' after list"s};
-					}
-					++it;
-					return it_expr{it, std::move(list)};
-				},
+				[&](tok::lsquare) { return parse_list(tree, it, end); },
 				// Block
-				[&](tok::lcurly const&) -> parse_expr_result {
-					// Parse statements.
-					block block;
-					auto stmt_result = parse_stmt(it, end);
-					while (stmt_result.has_value()) {
-						it = stmt_result.value().it;
-						block.stmts->push_back(std::move(stmt_result.value().stmt));
-						stmt_result = parse_stmt(it, end);
-					}
-					// Parse close curly brace.
-					if (it == end || !std::holds_alternative<tok::rcurly>(*it)) {
-						return tl::unexpected{"expected '}' after statement block"s};
-					}
-					++it;
-					return it_expr{it, std::move(block)};
-				},
+				[&](tok::lcurly) { return parse_block(tree, it, end); },
 				// Intrinsic function
 				[&](intrinsic f) -> parse_expr_result {
-					auto params = [&] {
-						switch (f) {
-							case intrinsic::top:
-								return make_tup_expr(expr{tok::sym{"list"}});
-							case intrinsic::pop:
-								return make_tup_expr(expr{tok::sym{"list"}});
-							case intrinsic::push:
-								return make_tup_expr(expr{tok::sym{"list"}}, expr{tok::sym{"value"}});
-							case intrinsic::print:
-								return make_tup_expr(expr{tok::sym{"value"}});
-							default:
-								// unreachable
-								return make_tup_expr();
-						}
-					}();
-					return it_expr{it, lambda{make_expr(std::move(params)), f}};
+					return it_expr{it, expr{&tree, tree.add_intrinsic_lambda(f)}};
 				},
 				// Boolean
 				[&](tok::boolean const& b) -> parse_expr_result {
-					return it_expr{it, b};
+					return it_expr{it, expr{&tree, tree.add_boolean(b.value)}};
 				},
 				// Number
 				[&](tok::num const& num) -> parse_expr_result {
-					return it_expr{it, num};
+					return it_expr{it, expr{&tree, tree.add_literal(node_kind::num, num.rep)}};
 				},
 				// String
-				[&](std::string const& str) -> parse_expr_result {
-					return it_expr{it, str};
+				[&](tok::str const& str) -> parse_expr_result {
+					return it_expr{it, expr{&tree, tree.add_literal(node_kind::str, str.value)}};
 				},
 				// Symbol or lambda
 				[&](tok::sym const& sym) -> parse_expr_result {
-					// Could be a parentheses-less unary lambda. Try to parse a lambda body.
-					auto body_result = parse_body(it, end);
-					if (body_result.has_value()) {
+					// A symbol followed by an arrow is a parentheses-less unary lambda.
+					if (next_is<tok::arrow>(it, end)) {
+						auto body_result = parse_body(tree, it + 1, end);
+						if (!body_result.has_value()) { return body_result; }
 						// Assemble lambda from the parameter wrapped in a tuple and the body.
-						auto [body_end, body] = std::move(body_result.value());
-						return it_expr{body_end, lambda{make_expr(make_tup_expr(expr{sym})), make_expr(std::move(body))}};
+						auto const [body_end, body] = body_result.value();
+						auto const params = tree.add_list(node_kind::tup, std::array{tree.add_symbol(sym.name)});
+						return it_expr{body_end, expr{&tree, tree.add(node_kind::lambda, {params, body.node})}};
 					}
 					// It's just a symbol.
-					return it_expr{it, expr{sym}};
+					return it_expr{it, expr{&tree, tree.add_symbol(sym.name)}};
 				},
 				// Anything else is unexpected.
 				[](auto const& t) -> parse_expr_result {
@@ -173,267 +233,208 @@ namespace gynjo {
 
 		//! Checks whether the next token is a minus.
 		auto peek_negative(token_it begin, token_it end) -> bool {
-			if (begin == end) { return false; }
+			return next_is<tok::minus>(begin, end);
+		}
+
+		//! Whether the token at @p it continues a cluster.
+		auto continues_cluster(token_it it, token_it end) -> bool {
+			if (it == end) { return false; }
 			return match(
-				*begin,
-				// Unary minus
-				[&](tok::minus) { return true; },
-				// Unary plus (ignored)
-				[&](tok::plus) { return false; },
-				// Unsigned
-				[&](auto const&) { return false; });
+				*it,
+				[](tok::mul) { return true; },
+				[](tok::div) { return true; },
+				[](tok::exp) { return true; },
+				[&](auto const&) { return starts_value(it, end); });
+		}
+
+		//! Parses the rest of a cluster, given its already-parsed first item.
+		GYNJO_NOINLINE auto parse_cluster_tail(ast& tree, bool negative, it_expr first, token_it end) -> parse_expr_result {
+			auto it = first.it;
+			std::vector<bool> negations{negative};
+			std::vector<node_id> items{first.expr.node};
+			// Now parse connectors and subsequent items.
+			std::vector<connector> connectors;
+			while (continues_cluster(it, end)) {
+				// Determine the connector to the next item and the iterator offset to the start of that item, and push
+				// its negation flag. Explicit operators may be followed by a minus sign.
+				auto const explicit_op = [&](gynjo::connector connector) {
+					bool const negative = peek_negative(it + 1, end);
+					negations.push_back(negative);
+					// Consume the operator and maybe "-".
+					return std::pair{negative ? 2 : 1, connector};
+				};
+				auto const [it_offset, connector] = match(
+					*it,
+					[&](tok::mul) { return explicit_op(connector::mul); },
+					[&](tok::div) { return explicit_op(connector::div); },
+					[&](tok::exp) { return explicit_op(connector::exp); },
+					[&](tok::lparen) {
+						negations.push_back(false);
+						// Don't consume any tokens.
+						return std::pair{0, connector::adj_paren};
+					},
+					[&](auto const&) {
+						negations.push_back(false);
+						// Don't consume any tokens.
+						return std::pair{0, connector::adj_nonparen};
+					});
+				// Read the next cluster item.
+				auto next_result = parse_value(tree, it + it_offset, end);
+				if (!next_result.has_value()) {
+					// An explicit operator requires an operand. Otherwise, report the error in the adjacent item.
+					if (it_offset != 0) { return tl::unexpected{"expected an operand"s}; }
+					return next_result;
+				}
+				// Got another cluster item.
+				auto const [next_end, next_item] = next_result.value();
+				it = next_end;
+				items.push_back(next_item.node);
+				connectors.push_back(connector);
+			}
+			return it_expr{it,
+				expr{&tree,
+					items.size() == 1 && negations.front() == false
+						// Found a single non-negated value. Just extract it here.
+						? items.front()
+						// Found a cluster of values.
+						: tree.add_cluster(items, negations, connectors)}};
 		}
 
 		//! Parses a cluster of function calls, exponentiations, (possibly implicit) multiplications, and/or
 		//! divisions. The result is something that will require further parsing by the interpreter using
 		//! available semantic info.
-		auto parse_cluster(token_it begin, token_it end) -> parse_expr_result {
+		auto parse_cluster(ast& tree, token_it begin, token_it end) -> parse_expr_result {
 			// Get sign of first item.
-			std::vector<bool> negations;
-			if (peek_negative(begin, end)) {
-				++begin;
-				negations.push_back(true);
-			} else {
-				negations.push_back(false);
-			}
+			bool const negative = peek_negative(begin, end);
+			if (negative) { ++begin; }
 			// Parse first item.
-			return parse_value(begin, end).and_then([&](it_expr result) -> parse_expr_result {
-				auto [it, first] = std::move(result);
-				auto items = std::make_unique<std::vector<expr>>();
-				items->push_back(std::move(first));
-				// Now parse connectors and subsequent items.
-				std::vector<cluster::connector> connectors;
-				while (it != end) {
-					// The following match does three things:
-					//   1) Pushes the next negation flag, based on the peeked sign and operator
-					//   2) Determines the iterator offset to the start of the next factor
-					//   3) Determines Whether the next factor is required or optional
-					//   4) Determines the connector to the cluster element, if any
-					auto [it_offset, required, connector] = match(
-						*it,
-						[&negations, minus_it = it + 1, end = end](tok::mul) {
-							bool const negative = peek_negative(minus_it, end);
-							negations.push_back(negative);
-							// Consume "*" and maybe "-".
-							return std::tuple{negative ? 2 : 1, true, cluster::connector::mul};
-						},
-						[&negations, minus_it = it + 1, end = end](tok::div) {
-							bool const negative = peek_negative(minus_it, end);
-							negations.push_back(negative);
-							// Consume "/" and maybe "-".
-							return std::tuple{negative ? 2 : 1, true, cluster::connector::div};
-						},
-						[&negations, minus_it = it + 1, end = end](tok::exp) {
-							bool const negative = peek_negative(minus_it, end);
-							negations.push_back(negative);
-							// Consume "^" and maybe "-".
-							return std::tuple{negative ? 2 : 1, true, cluster::connector::exp};
-						},
-						[&negations](tok::lparen) {
-							negations.push_back(false);
-							// Don't consume any tokens.
-							return std::tuple{0, true, cluster::connector::adj_paren};
-						},
-						[&negations](auto const&) {
-							negations.push_back(false);
-							// Don't consume any tokens.
-							return std::tuple{0, false, cluster::connector::adj_nonparen};
-						});
-					// Try to read a cluster element.
-					auto next_result = parse_value(it + it_offset, end);
-					if (!next_result.has_value()) {
-						if (required) {
-							// Saw an explicit operator but did not find another cluster element.
-							return tl::unexpected{"expected an operand"s};
-						} else {
-							// This factor was optional. Just stop reading cluster elements now.
-							break;
-						}
-					}
-					// Got another cluster item.
-					auto [next_end, next_item] = std::move(next_result.value());
-					it = next_end;
-					items->emplace_back(std::move(next_item));
-					connectors.push_back(connector);
-				}
-				return it_expr{it,
-					items->size() == 1 && negations.front() == false
-						// Found a single non-negated value. Just extract it here.
-						? std::move(items->front())
-						// Found a cluster of values.
-						: expr{cluster{std::move(negations), std::move(items), std::move(connectors)}}};
-			});
+			auto first_result = parse_value(tree, begin, end);
+			// A single non-negated value doesn't need a cluster.
+			if (!first_result.has_value() || (!negative && !continues_cluster(first_result.value().it, end))) {
+				return first_result;
+			}
+			return parse_cluster_tail(tree, negative, std::move(first_result.value()), end);
 		}
 
-		//! Parses a series of additions and subtractions.
-		auto parse_terms(token_it begin, token_it end) -> parse_expr_result {
-			return parse_cluster(begin, end).and_then([&](it_expr result) -> parse_expr_result {
-				auto [it, terms] = std::move(result);
-				while (it != end && (std::holds_alternative<tok::plus>(*it) || std::holds_alternative<tok::minus>(*it))) {
-					// Parse next result.
-					auto const token = *it;
-					auto next_result = parse_cluster(it + 1, end);
-					if (!next_result.has_value()) { return tl::unexpected{"expected term"s}; }
-					// Extract result.
-					it = next_result.value().it;
-					auto next_term = std::move(next_result.value().expr);
-					// Incorporate into expression.
-					if (std::holds_alternative<tok::plus>(token)) {
-						terms = expr{add{make_expr(std::move(terms)), make_expr(std::move(next_term))}};
-					} else {
-						terms = expr{sub{make_expr(std::move(terms)), make_expr(std::move(next_term))}};
-					}
-				}
-				return it_expr{it, std::move(terms)};
-			});
-		}
+		//! Binary operator precedence levels, from loosest to tightest. All binary operators are left-associative.
+		enum class level { disjunction, conjunction, eq_check, comparison, term, cluster };
 
-		//! Parses a series of comparison checks (not including equals or not equals).
-		auto parse_comparisons(token_it begin, token_it end) -> parse_expr_result {
-			return parse_terms(begin, end).and_then([&](it_expr result) -> parse_expr_result {
-				auto it = std::move(result.it);
-				auto cmps = std::move(result.expr);
-				auto is_comparison = [](tok::token const& token) {
-					return match(
-						token,
-						[](tok::lt) { return true; },
-						[](tok::leq) { return true; },
-						[](tok::gt) { return true; },
-						[](tok::geq) { return true; },
-						[](auto const&) { return false; });
-				};
-				while (it != end && is_comparison(*it)) {
-					// Store token to match on later.
-					auto const token = *it;
-					// Parse next result.
-					auto next_result = parse_terms(it + 1, end);
-					if (!next_result.has_value()) { return tl::unexpected{"expected comparison"s}; }
-					// Extract result.
-					it = std::move(next_result.value().it);
-					auto next_cmp = std::move(next_result.value().expr);
-					// Incorporate into expression.
-					match(
-						token,
-						[&](tok::lt) {
-							cmps = expr{lt{make_expr(std::move(cmps)), make_expr(std::move(next_cmp))}};
-						},
-						[&](tok::leq) {
-							cmps = expr{leq{make_expr(std::move(cmps)), make_expr(std::move(next_cmp))}};
-						},
-						[&](tok::gt) {
-							cmps = expr{gt{make_expr(std::move(cmps)), make_expr(std::move(next_cmp))}};
-						},
-						[&](tok::geq) {
-							cmps = expr{geq{make_expr(std::move(cmps)), make_expr(std::move(next_cmp))}};
-						},
-						[&](auto const&) { /*unreachable*/ });
-				}
-				return it_expr{it, std::move(cmps)};
-			});
+		//! The next tighter precedence level after @p l.
+		auto tighter(level l) -> level {
+			return static_cast<level>(static_cast<int>(l) + 1);
 		}
 
-		//! Parses a series of equality, inequality, or approximate equality checks.
-		auto parse_eq_checks(token_it begin, token_it end) -> parse_expr_result {
-			return parse_comparisons(begin, end).and_then([&](it_expr result) -> parse_expr_result {
-				auto it = std::move(result.it);
-				auto cmps = std::move(result.expr);
-				auto is_eq_check = [](tok::token const& token) {
-					return match(
-						token,
-						[](tok::eq) { return true; },
-						[](tok::neq) { return true; },
-						[](tok::approx) { return true; },
-						[](auto const&) { return false; });
-				};
-				while (it != end && is_eq_check(*it)) {
-					// Parse next result.
-					auto const token = *it;
-					auto next_result = parse_comparisons(it + 1, end);
-					if (!next_result.has_value()) { return tl::unexpected{"expected equality check"s}; }
-					// Extract result.
-					it = std::move(next_result.value().it);
-					auto next_cmp = std::move(next_result.value().expr);
-					// Incorporate into expression.
-					match(
-						token,
-						[&](tok::eq) {
-							cmps = expr{eq{make_expr(std::move(cmps)), make_expr(std::move(next_cmp))}};
-						},
-						[&](tok::neq) {
-							cmps = expr{neq{make_expr(std::move(cmps)), make_expr(std::move(next_cmp))}};
-						},
-						[&](tok::approx) {
-							cmps = expr{approx{make_expr(std::move(cmps)), make_expr(std::move(next_cmp))}};
-						},
-						[&](auto const&) { /*unreachable*/ });
-				}
-				return it_expr{it, std::move(cmps)};
-			});
+		//! A binary operator's precedence level, the function that combines its operands, and the error to report if its
+		//! right operand is missing.
+		struct binary_op {
+			level precedence;
+			auto (*combine)(ast& tree, expr lhs, expr rhs) -> expr;
+			char const* missing_rhs_error;
+		};
+
+		//! Makes a binary_op::combine function for binary expressions of kind @p Kind.
+		template <node_kind Kind>
+		constexpr auto combine = [](ast& tree, expr lhs, expr rhs) {
+			return expr{&tree, tree.add(Kind, {lhs.node, rhs.node})};
+		};
+
+		//! The binary operator at @p it, if any.
+		auto peek_binary_op(token_it it, token_it end) -> std::optional<binary_op> {
+			if (it == end) { return std::nullopt; }
+			return match(
+				*it,
+				[](tok::or_) { return std::optional{binary_op{level::disjunction, combine<node_kind::or_>, "expected disjunction"}}; },
+				[](tok::and_) { return std::optional{binary_op{level::conjunction, combine<node_kind::and_>, "expected conjunction"}}; },
+				[](tok::eq) { return std::optional{binary_op{level::eq_check, combine<node_kind::eq>, "expected equality check"}}; },
+				[](tok::neq) { return std::optional{binary_op{level::eq_check, combine<node_kind::neq>, "expected equality check"}}; },
+				[](tok::approx) {
+					return std::optional{binary_op{level::eq_check, combine<node_kind::approx>, "expected equality check"}};
+				},
+				[](tok::lt) { return std::optional{binary_op{level::comparison, combine<node_kind::lt>, "expected comparison"}}; },
+				[](tok::leq) { return std::optional{binary_op{level::comparison, combine<node_kind::leq>, "expected comparison"}}; },
+				[](tok::gt) { return std::optional{binary_op{level::comparison, combine<node_kind::gt>, "expected comparison"}}; },
+				[](tok::geq) { return std::optional{binary_op{level::comparison, combine<node_kind::geq>, "expected comparison"}}; },
+				[](tok::plus) { return std::optional{binary_op{level::term, combine<node_kind::add>, "expected term"}}; },
+				[](tok::minus) { return std::optional{binary_op{level::term, combine<node_kind::sub>, "expected term"}}; },
+				[](auto const&) { return std::optional<binary_op>{}; });
 		}
 
-		//! Parses a series of logical conjunctions.
-		auto parse_conjunctions(token_it begin, token_it end) -> parse_expr_result {
-			return parse_eq_checks(begin, end).and_then([&](it_expr result) -> parse_expr_result {
-				auto it = std::move(result.it);
-				auto conjunctions = std::move(result.expr);
-				while (it != end && std::holds_alternative<tok::and_>(*it)) {
-					// Parse next result.
-					auto next_result = parse_eq_checks(it + 1, end);
-					if (!next_result.has_value()) { return tl::unexpected{"expected conjunction"s}; }
-					// Extract result.
-					it = std::move(next_result.value().it);
-					auto next_conjunction = std::move(next_result.value().expr);
-					// Incorporate into expression.
-					conjunctions = expr{and_{make_expr(std::move(conjunctions)), make_expr(std::move(next_conjunction))}};
-				}
-				return it_expr{it, std::move(conjunctions)};
-			});
+		auto parse_binary_ops(ast& tree, token_it begin, token_it end, level min_level) -> parse_expr_result;
+
+		//! Parses the rest of a series of binary operations, given the already-parsed left operand of the first one.
+		GYNJO_NOINLINE auto parse_binary_ops_tail(ast& tree, it_expr first, token_it end, level min_level) -> parse_expr_result {
+			auto [it, lhs] = std::move(first);
+			for (auto op = peek_binary_op(it, end); op.has_value() && op->precedence >= min_level; op = peek_binary_op(it, end)) {
+				// Operators at the same level are left-associative, so the right operand only takes tighter operators.
+				auto rhs_result = tighter(op->precedence) == level::cluster
+					? parse_cluster(tree, it + 1, end)
+					: parse_binary_ops(tree, it + 1, end, tighter(op->precedence));
+				if (!rhs_result.has_value()) { return tl::unexpected{std::string{op->missing_rhs_error}}; }
+				it = rhs_result.value().it;
+				lhs = op->combine(tree, std::move(lhs), std::move(rhs_result.value().expr));
+			}
+			return it_expr{it, std::move(lhs)};
 		}
 
-		//! Parses a series of logical disjunctions.
-		auto parse_disjunctions(token_it begin, token_it end) -> parse_expr_result {
-			return parse_conjunctions(begin, end).and_then([&](it_expr result) -> parse_expr_result {
-				auto it = std::move(result.it);
-				auto disjunctions = std::move(result.expr);
-				while (it != end && std::holds_alternative<tok::or_>(*it)) {
-					// Store token to match on later.
-					auto const token = *it;
-					// Parse next result.
-					auto next_result = parse_conjunctions(it + 1, end);
-					if (!next_result.has_value()) { return tl::unexpected{"expected disjunction"s}; }
-					// Extract result.
-					it = std::move(next_result.value().it);
-					auto next_disjunction = std::move(next_result.value().expr);
-					// Incorporate into expression.
-					disjunctions = expr{or_{make_expr(std::move(disjunctions)), make_expr(std::move(next_disjunction))}};
-				}
-				return it_expr{it, std::move(disjunctions)};
-			});
+		//! Parses a series of binary operations whose operators are at precedence level @p min_level or tighter, using
+		//! precedence climbing.
+		auto parse_binary_ops(ast& tree, token_it begin, token_it end, level min_level) -> parse_expr_result {
+			auto first_result = parse_cluster(tree, begin, end);
+			if (!first_result.has_value()) { return first_result; }
+			auto const op = peek_binary_op(first_result.value().it, end);
+			if (!op.has_value() || op->precedence < min_level) { return first_result; }
+			return parse_binary_ops_tail(tree, std::move(first_result.value()), end, min_level);
 		}
 
 		//! Parses a logical negation. Note that negation is right-associative.
-		auto parse_negation(token_it begin, token_it end) -> parse_expr_result {
+		auto parse_negation(ast& tree, token_it begin, token_it end) -> parse_expr_result {
 			if (begin == end) { return tl::unexpected{"expected expression"s}; }
-			if (std::holds_alternative<tok::not_>(*begin)) {
-				auto neg_result = parse_negation(begin + 1, end);
-				if (!neg_result.has_value()) { return tl::unexpected{"expected negation"s}; }
-				auto neg_end = std::move(neg_result.value().it);
-				auto neg = std::move(neg_result.value().expr);
-				return it_expr{neg_end, not_{make_expr(neg)}};
-			} else {
-				return parse_disjunctions(begin, end);
+			// Skip any "not"s first, so that a long chain of them doesn't recurse.
+			auto it = begin;
+			while (next_is<tok::not_>(it, end)) {
+				++it;
 			}
+			auto result = parse_binary_ops(tree, it, end, level::disjunction);
+			if (it == begin) { return result; }
+			if (!result.has_value()) { return tl::unexpected{"expected negation"s}; }
+			auto [neg_end, neg] = std::move(result.value());
+			for (; it != begin; --it) {
+				neg = expr{&tree, tree.add(node_kind::not_, {neg.node})};
+			}
+			return it_expr{neg_end, std::move(neg)};
+		}
+
+		//! Parses the rest of a conditional expression, given its already-parsed condition.
+		//! @note Kept out of parse_expr to keep the stack frames of deeply nested expressions small.
+		GYNJO_NOINLINE auto parse_cond(ast& tree, it_expr condition, token_it end) -> parse_expr_result {
+			// Skip "?".
+			auto it = condition.it + 1;
+			// Parse expression if true.
+			auto true_result = parse_expr(tree, it, end);
+			if (!true_result.has_value()) { return tl::unexpected{"expected true case in conditional expression"s}; }
+			it = true_result.value().it;
+			// Parse ":".
+			if (!next_is<tok::colon>(it, end)) { return tl::unexpected{"expected \"?\" in conditional expression"s}; }
+			++it;
+			// Parse expression if false.
+			auto false_result = parse_expr(tree, it, end);
+			if (!false_result.has_value()) { return tl::unexpected{"expected false case in conditional expression"s}; }
+			it = false_result.value().it;
+			return it_expr{it,
+				expr{&tree,
+					tree.add(node_kind::cond,
+						{condition.expr.node, true_result.value().expr.node, false_result.value().expr.node})}};
 		}
 
 		//! Parses a return statement, starting after "return".
-		auto parse_ret(token_it begin, token_it end) -> parse_stmt_result {
-			auto ret_result = parse_expr(begin, end);
+		auto parse_ret(ast& tree, token_it begin, token_it end) -> parse_stmt_result {
+			auto ret_result = parse_expr(tree, begin, end);
 			if (!ret_result.has_value()) { return tl::unexpected{"expected return expression"s}; }
-			return it_stmt{ret_result.value().it, ret{make_expr(std::move(ret_result.value().expr))}};
+			return it_stmt{ret_result.value().it, stmt{&tree, tree.add(node_kind::ret, {ret_result.value().expr.node})}};
 		}
 
 		//! Parses a for-loop, starting after "for".
-		auto parse_for_loop(token_it begin, token_it end) -> parse_stmt_result {
+		auto parse_for_loop(ast& tree, token_it begin, token_it end) -> parse_stmt_result {
 			if (begin == end) { return tl::unexpected{"expected for-loop"s}; }
 			// Parse loop variable.
 			return match(
@@ -446,7 +447,7 @@ namespace gynjo {
 					}
 					auto const range_begin = in_begin + 1;
 					// Parse range expression.
-					return parse_expr(range_begin, end).and_then([&](it_expr range_result) -> parse_stmt_result {
+					return parse_expr(tree, range_begin, end).and_then([&](it_expr range_result) -> parse_stmt_result {
 						auto range_end = range_result.it;
 						// Parse "do".
 						if (range_end == end || !std::holds_alternative<tok::do_>(*range_end)) {
@@ -454,13 +455,12 @@ namespace gynjo {
 						}
 						auto const body_begin = range_end + 1;
 						// Parse body.
-						return parse_stmt(body_begin, end).and_then([&](it_stmt body_result) -> parse_stmt_result {
+						return parse_stmt(tree, body_begin, end).and_then([&](it_stmt body_result) -> parse_stmt_result {
 							// Assemble for-loop.
+							auto const loop_var = tree.add_symbol(symbol.name);
 							return it_stmt{body_result.it,
-								for_loop{//
-									symbol,
-									make_expr(std::move(range_result.expr)),
-									make_stmt(std::move(body_result.stmt))}};
+								stmt{&tree,
+									tree.add(node_kind::for_loop, {loop_var, range_result.expr.node, body_result.stmt.node})}};
 						});
 					});
 				},
@@ -468,10 +468,10 @@ namespace gynjo {
 		}
 
 		//! Parses a while-loop, starting after "while".
-		auto parse_while_loop(token_it begin, token_it end) -> parse_stmt_result {
+		auto parse_while_loop(ast& tree, token_it begin, token_it end) -> parse_stmt_result {
 			if (begin == end) { return tl::unexpected{"expected while-loop"s}; }
 			// Parse test expression.
-			return parse_expr(begin, end).and_then([&](it_expr test_result) -> parse_stmt_result {
+			return parse_expr(tree, begin, end).and_then([&](it_expr test_result) -> parse_stmt_result {
 				auto test_end = test_result.it;
 				// Parse "do".
 				if (test_end == end || !std::holds_alternative<tok::do_>(*test_end)) {
@@ -479,20 +479,18 @@ namespace gynjo {
 				}
 				auto const body_begin = test_end + 1;
 				// Parse body.
-				return parse_stmt(body_begin, end).and_then([&](it_stmt body_result) -> parse_stmt_result {
+				return parse_stmt(tree, body_begin, end).and_then([&](it_stmt body_result) -> parse_stmt_result {
 					// Assemble while-loop.
 					return it_stmt{body_result.it,
-						while_loop{//
-							make_expr(std::move(test_result.expr)),
-							make_stmt(std::move(body_result.stmt))}};
+						stmt{&tree, tree.add(node_kind::while_loop, {test_result.expr.node, body_result.stmt.node})}};
 				});
 			});
 		}
 
 		//! Parses a branch statment - if-then or if-then-else - starting after "if".
-		auto parse_branch(token_it begin, token_it end) -> parse_stmt_result {
+		auto parse_branch(ast& tree, token_it begin, token_it end) -> parse_stmt_result {
 			// Parse test expression.
-			auto test_result = parse_expr(begin, end);
+			auto test_result = parse_expr(tree, begin, end);
 			if (!test_result.has_value()) { return tl::unexpected{"expected test expression in branch statement"s}; }
 			auto it = test_result.value().it;
 			// Parse "then".
@@ -501,34 +499,34 @@ namespace gynjo {
 			}
 			++it;
 			// Parse statement if true.
-			auto true_result = parse_stmt(it, end);
+			auto true_result = parse_stmt(tree, it, end);
 			if (!true_result.has_value()) { return tl::unexpected{"expected true case in branch statement"s}; }
 			it = true_result.value().it;
 			// Try to parse "else".
 			if (it != end && std::holds_alternative<tok::else_>(*it)) {
 				++it;
 				// Parse statement if false.
-				auto false_result = parse_stmt(it, end);
+				auto false_result = parse_stmt(tree, it, end);
 				if (!false_result.has_value()) { return tl::unexpected{"expected false case in branch statement"s}; }
 				it = false_result.value().it;
 				return it_stmt{it,
-					branch{//
-						make_expr(std::move(test_result.value().expr)),
-						make_stmt(std::move(true_result.value().stmt)),
-						make_stmt(std::move(false_result.value().stmt))}};
+					stmt{&tree,
+						tree.add(node_kind::branch,
+							{test_result.value().expr.node, true_result.value().stmt.node, false_result.value().stmt.node})}};
 			} else {
 				// Empty else expression.
 				return it_stmt{it,
-					branch{//
-						make_expr(std::move(test_result.value().expr)),
-						make_stmt(std::move(true_result.value().stmt)),
-						// Defaults to no-op.
-						make_stmt(nop{})}};
+					stmt{&tree,
+						tree.add(node_kind::branch,
+							{test_result.value().expr.node,
+								true_result.value().stmt.node,
+								// Defaults to no-op.
+								tree.add_nop()})}};
 			}
 		}
 
 		//! Parses an assignment operation, starting after "let".
-		auto parse_assignment(token_it begin, token_it end) -> parse_stmt_result {
+		auto parse_assignment(ast& tree, token_it begin, token_it end) -> parse_stmt_result {
 			if (begin == end) { return tl::unexpected{"expected assignment"s}; }
 			// Parse LHS.
 			return match(
@@ -541,84 +539,126 @@ namespace gynjo {
 					}
 					auto const rhs_begin = eq_begin + 1;
 					// Parse RHS.
-					return parse_expr(rhs_begin, end).and_then([&](it_expr rhs_result) -> parse_stmt_result {
+					return parse_expr(tree, rhs_begin, end).and_then([&](it_expr rhs_result) -> parse_stmt_result {
 						// Assemble assignment from symbol and RHS.
-						auto [rhs_end, rhs] = std::move(rhs_result);
-						return it_stmt{rhs_end, assign{symbol, make_expr(std::move(rhs))}};
+						auto const [rhs_end, rhs] = rhs_result;
+						auto const lhs = tree.add_symbol(symbol.name);
+						return it_stmt{rhs_end, stmt{&tree, tree.add(node_kind::assign, {lhs, rhs.node})}};
 					});
 				},
 				[&](auto const&) -> parse_stmt_result {
-					return tl::unexpected{"expected loop variable after \"for\", found " + to_string(*begin)};
+					return tl::unexpected{"expected variable after \"let\", found " + to_string(*begin)};
 				});
 		}
 
 		//! Parses an import statement, starting after "import".
-		auto parse_import(token_it begin, token_it end) -> parse_stmt_result {
+		auto parse_import(ast& tree, token_it begin, token_it end) -> parse_stmt_result {
 			if (begin == end) { return tl::unexpected{"expected import target"s}; }
 			return match(
 				*begin,
 				[&](tok::sym const& filename) -> parse_stmt_result {
-					return it_stmt{begin + 1, imp{filename.name}};
+					return it_stmt{begin + 1, stmt{&tree, tree.add_literal(node_kind::imp, filename.name.str())}};
 				},
-				[&](std::string const& filename) -> parse_stmt_result {
-					return it_stmt{begin + 1, imp{filename}};
+				[&](tok::str const& filename) -> parse_stmt_result {
+					return it_stmt{begin + 1, stmt{&tree, tree.add_literal(node_kind::imp, filename.value)}};
 				},
 				[&](auto const&) -> parse_stmt_result {
 					return tl::unexpected{
 						"expected filename (symbol or string) in import statement, found " + to_string(*begin)};
 				});
 		}
-	}
 
-	auto parse_expr(token_it begin, token_it end) -> parse_expr_result {
-		return parse_negation(begin, end).and_then([&](it_expr result) -> parse_expr_result {
-			auto it = result.it;
-			// Check for conditional expression.
-			if (result.it == end || !std::holds_alternative<tok::que>(*result.it)) { return result; }
-			++it;
-			// Parse expression if true.
-			auto true_result = parse_expr(it, end);
-			if (!true_result.has_value()) { return tl::unexpected{"expected true case in conditional expression"s}; }
-			it = true_result.value().it;
-			// Parse ":".
-			if (it == end || !std::holds_alternative<tok::colon>(*it)) {
-				return tl::unexpected{"expected \"?\" in conditional expression"s};
+		//! Parses an expression statement, given the result of parsing its expression.
+		auto parse_expr_stmt(ast& tree, it_expr expr_result, token_it end) -> parse_stmt_result {
+			if (expr_result.it == end || !std::holds_alternative<tok::semicolon>(*expr_result.it)) {
+				return tl::unexpected{"missing semicolon after expression statement"s};
 			}
-			++it;
-			// Parse expression if false.
-			auto false_result = parse_expr(it, end);
-			if (!false_result.has_value()) { return tl::unexpected{"expected false case in conditional expression"s}; }
-			it = false_result.value().it;
-			return it_expr{it,
-				cond{//
-					make_expr(std::move(result.expr)),
-					make_expr(std::move(true_result.value().expr)),
-					make_expr(std::move(false_result.value().expr))}};
-		});
+			return it_stmt{expr_result.it + 1, stmt{&tree, tree.add(node_kind::expr_stmt, {expr_result.expr.node})}};
+		}
+	}
+
+	auto set_max_nesting_depth(std::size_t depth) -> void {
+		selected_max_nesting_depth = depth;
 	}
 
-	auto parse_stmt(token_it begin, token_it end) -> parse_stmt_result {
+	auto max_nesting_depth() -> std::size_t {
+		return selected_max_nesting_depth;
+	}
+
+	auto parse_expr(ast& tree, token_it begin, token_it end) -> parse_expr_result {
+		nesting_level const level;
+		if (level.too_deep()) { return tl::unexpected{nesting_error()}; }
+		auto result = parse_negation(tree, begin, end);
+		// Check for conditional expression.
+		if (result.has_value() && next_is<tok::que>(result.value().it, end)) {
+			result = parse_cond(tree, std::move(result.value()), end);
+		}
+		return level.checked(std::move(result));
+	}
+
+	auto parse_stmt(ast& tree, token_it begin, token_it end) -> parse_stmt_result {
 		// Empty input is a no-op.
-		if (begin == end) { return it_stmt{end, nop{}}; }
+		if (begin == end) { return it_stmt{end, stmt{&tree, tree.add_nop()}}; }
+		// Statements nest within branches and loops. Any other statement nests only within its expressions.
+		bool const compound = std::holds_alternative<tok::if_>(*begin) || std::holds_alternative<tok::while_>(*begin) ||
+			std::holds_alternative<tok::for_>(*begin);
+		nesting_level const level{compound};
+		if (level.too_deep()) { return tl::unexpected{nesting_error()}; }
 		auto stmt_result = match(
 			*begin,
-			[&](tok::imp) -> parse_stmt_result { return parse_import(begin + 1, end); },
-			[&](tok::let) -> parse_stmt_result { return parse_assignment(begin + 1, end); },
-			[&](tok::if_) -> parse_stmt_result { return parse_branch(begin + 1, end); },
-			[&](tok::while_) -> parse_stmt_result { return parse_while_loop(begin + 1, end); },
-			[&](tok::for_) -> parse_stmt_result { return parse_for_loop(begin + 1, end); },
-			[&](tok::ret) -> parse_stmt_result { return parse_ret(begin + 1, end); },
+			[&](tok::imp) -> parse_stmt_result { return parse_import(tree, begin + 1, end); },
+			[&](tok::let) -> parse_stmt_result { return parse_assignment(tree, begin + 1, end); },
+			[&](tok::if_) -> parse_stmt_result { return parse_branch(tree, begin + 1, end); },
+			[&](tok::while_) -> parse_stmt_result { return parse_while_loop(tree, begin + 1, end); },
+			[&](tok::for_) -> parse_stmt_result { return parse_for_loop(tree, begin + 1, end); },
+			[&](tok::ret) -> parse_stmt_result { return parse_ret(tree, begin + 1, end); },
 			[&](auto const&) -> parse_stmt_result {
-				return parse_expr(begin, end).and_then([&](it_expr result) -> parse_stmt_result {
-					if (result.it == end || !std::holds_alternative<tok::semicolon>(*result.it)) {
-						return tl::unexpected{"missing semicolon after expression statement"s};
-					};
-					return it_stmt{result.it + 1, expr_stmt{make_expr(std::move(result.expr))}};
-				});
+				return parse_expr(tree, begin, end).and_then(
+					[&](it_expr result) { return parse_expr_stmt(tree, std::move(result), end); });
 			});
-		// Check for error in statement.
-		if (!stmt_result) { return stmt_result; }
-		auto const stmt_end = stmt_result.value().it;
-		return it_stmt{stmt_end, std::move(stmt_result.value().stmt)};
+		return level.checked(std::move(stmt_result));
+	}
+
+	auto parse_expr_or_stmt(ast& tree, token_it begin, token_it end) -> parse_expr_or_stmt_result {
+		using result_t = std::variant<it_expr, it_stmt>;
+		nesting_level const level{false};
+		auto expr_result = parse_expr(tree, begin, end);
+		// Statement keywords can't begin an expression, so this reparses only if the input is invalid or begins with one.
+		if (!expr_result.has_value()) {
+			return level.checked(
+				parse_stmt(tree, begin, end).map([](it_stmt stmt) { return result_t{std::move(stmt)}; }));
+		}
+		if (expr_result.value().it == end) {
+			return level.checked(parse_expr_or_stmt_result{std::move(expr_result.value())});
+		}
+		return level.checked(parse_expr_stmt(tree, std::move(expr_result.value()), end).map([](it_stmt stmt) {
+			return result_t{std::move(stmt)};
+		}));
+	}
+
+	auto stmt_is_final(token_it stmt_end, token_it end) -> bool {
+		// A statement that uses every available token might continue into the next one.
+		if (stmt_end == end) { return false; }
+		return match(
+			*stmt_end,
+			// Tokens that can begin a statement end the previous one regardless of what follows.
+			[](tok::imp) { return true; },
+			[](tok::let) { return true; },
+			[](tok::if_) { return true; },
+			[](tok::while_) { return true; },
+			[](tok::for_) { return true; },
+			[](tok::ret) { return true; },
+			[](tok::not_) { return true; },
+			[](tok::minus) { return true; },
+			[](tok::lparen) { return true; },
+			[](tok::lsquare) { return true; },
+			[](tok::lcurly) { return true; },
+			[](tok::boolean) { return true; },
+			[](tok::num) { return true; },
+			[](tok::str) { return true; },
+			[](tok::sym) { return true; },
+			[](intrinsic) { return true; },
+			// Anything else can't begin a statement, so the input is invalid unless later tokens change how it parses.
+			[](auto const&) { return false; });
 	}
 }
@@ -10,7 +10,9 @@
 
 #include <tl/expected.hpp>
 
+#include <cstddef>
 #include <string>
+#include <variant>
 #include <vector>
 
 namespace gynjo {
@@ -35,11 +37,36 @@ namespace gynjo {
 	//! Either a (token iterator, statement) pair or an error message.
 	using parse_stmt_result = tl::expected<it_stmt, std::string>;
 
-	//! If possible, parses the next single expression from @p begin to @p end.
+	//! Either a (token iterator, expression) pair, a (token iterator, statement) pair, or an error message.
+	using parse_expr_or_stmt_result = tl::expected<std::variant<it_expr, it_stmt>, std::string>;
+
+	//! The default deepest nesting of expressions, branches and loops the parser accepts. Parsing, the later passes over
+	//! the tree and evaluation all recurse on the native stack for each level, so deeper input is rejected up front rather
+	//! than overflowing the stack. At this depth they need about 4 MiB, within the 8 MiB Linux default and the 16 MiB the
+	//! Windows build reserves.
+	constexpr std::size_t default_max_nesting_depth = 2'000;
+
+	//! Sets the deepest nesting the parser accepts. Deeper nesting is a parse error. Raising it above the default needs
+	//! a correspondingly larger stack, about 2 KiB per level.
+	auto set_max_nesting_depth(std::size_t depth) -> void;
+
+	//! The deepest nesting the parser accepts.
+	auto max_nesting_depth() -> std::size_t;
+
+	//! If possible, parses the next single expression from @p begin to @p end, adding its nodes to @p tree.
 	//! @return An iterator to the next unused token along with the parsed expression, or an error message.
-	auto parse_expr(token_it begin, token_it end) -> parse_expr_result;
+	auto parse_expr(ast& tree, token_it begin, token_it end) -> parse_expr_result;
 
-	//! If possible, parses the next single statement from @p begin to @p end.
+	//! If possible, parses the next single statement from @p begin to @p end, adding its nodes to @p tree.
 	//! @return An iterator to the next unused token along with the parsed statement, or an error message.
-	auto parse_stmt(token_it begin, token_it end) -> parse_stmt_result;
+	auto parse_stmt(ast& tree, token_it begin, token_it end) -> parse_stmt_result;
+
+	//! If possible, parses an expression spanning all of @p begin to @p end or else the next single statement, adding its
+	//! nodes to @p tree.
+	//! @note Equivalent to trying parse_expr and then parse_stmt, but an expression statement is parsed only once.
+	auto parse_expr_or_stmt(ast& tree, token_it begin, token_it end) -> parse_expr_or_stmt_result;
+
+	//! Determines whether a statement parsed from @p begin to @p end and ending at @p stmt_end would be parsed the same
+	//! way if more tokens followed @p end. Used to execute statements before the rest of the input is available.
+	auto stmt_is_final(token_it stmt_end, token_it end) -> bool;
 }
@@ -0,0 +1,219 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "simd.hpp"
+
+#include <bit>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define GYNJO_SIMD_X86_64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC allows AVX2 intrinsics in any function.
+#define GYNJO_TARGET_AVX2
+#else
+#define GYNJO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace gynjo::simd {
+	namespace {
+		//! An inclusive range of character values.
+		struct range {
+			unsigned char low;
+			unsigned char high;
+		};
+
+		//! A set of characters made up of @p Ranges, with scalar and vector membership tests. The vector tests produce
+		//! a bit mask with a set bit for each member character.
+		template <range... Ranges>
+		struct char_class {
+			static auto contains(char c) -> bool {
+				// Subtraction wraps characters below the low end of a range around past its high end.
+				return ((static_cast<unsigned char>(c - Ranges.low) <= Ranges.high - Ranges.low) || ...);
+			}
+
+#ifdef GYNJO_SIMD_X86_64
+			static auto mask(__m128i chars) -> unsigned {
+				__m128i members = _mm_setzero_si128();
+				((members = _mm_or_si128(members, in_range<Ranges>(chars))), ...);
+				return static_cast<unsigned>(_mm_movemask_epi8(members));
+			}
+
+			GYNJO_TARGET_AVX2 static auto mask(__m256i chars) -> unsigned {
+				__m256i members = _mm256_setzero_si256();
+				((members = _mm256_or_si256(members, in_range<Ranges>(chars))), ...);
+				return static_cast<unsigned>(_mm256_movemask_epi8(members));
+			}
+
+		private:
+			//! Sets each byte of the result to all ones if the corresponding character is in range @p R.
+			template <range R>
+			static auto in_range(__m128i chars) -> __m128i {
+				auto const offsets = _mm_sub_epi8(chars, _mm_set1_epi8(static_cast<char>(R.low)));
+				auto const clamped = _mm_min_epu8(offsets, _mm_set1_epi8(static_cast<char>(R.high - R.low)));
+				return _mm_cmpeq_epi8(offsets, clamped);
+			}
+
+			template <range R>
+			GYNJO_TARGET_AVX2 static auto in_range(__m256i chars) -> __m256i {
+				auto const offsets = _mm256_sub_epi8(chars, _mm256_set1_epi8(static_cast<char>(R.low)));
+				auto const clamped = _mm256_min_epu8(offsets, _mm256_set1_epi8(static_cast<char>(R.high - R.low)));
+				return _mm256_cmpeq_epi8(offsets, clamped);
+			}
+#endif
+		};
+
+		using space_class = char_class<range{'\t', '\r'}, range{' ', ' '}>;
+		using line_end_class = char_class<range{'\n', '\n'}, range{'\r', '\r'}>;
+		using digit_class = char_class<range{'0', '9'}>;
+
+		//! The first character in [@p it, @p end) whose membership in @p Class is @p Member.
+		template <typename Class, bool Member>
+		auto find_scalar(char const* it, char const* end) -> char const* {
+			while (it != end && Class::contains(*it) != Member) {
+				++it;
+			}
+			return it;
+		}
+
+#ifdef GYNJO_SIMD_X86_64
+		//! SSE2 version of find_scalar, which checks 16 characters at a time.
+		template <typename Class, bool Member>
+		auto find_sse2(char const* it, char const* end) -> char const* {
+			for (; end - it >= 16; it += 16) {
+				auto mask = Class::mask(_mm_loadu_si128(reinterpret_cast<__m128i const*>(it)));
+				if constexpr (!Member) { mask = ~mask & 0xFFFFu; }
+				if (mask != 0) { return it + std::countr_zero(mask); }
+			}
+			return find_scalar<Class, Member>(it, end);
+		}
+
+		//! AVX2 version of find_scalar, which checks 32 characters at a time.
+		template <typename Class, bool Member>
+		GYNJO_TARGET_AVX2 auto find_avx2(char const* it, char const* end) -> char const* {
+			for (; end - it >= 32; it += 32) {
+				auto mask = Class::mask(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(it)));
+				if constexpr (!Member) { mask = ~mask; }
+				if (mask != 0) { return it + std::countr_zero(mask); }
+			}
+			return find_sse2<Class, Member>(it, end);
+		}
+#endif
+
+		//! The first character in [@p begin, @p end) whose membership in @p Class is @p Member, using @p Isa.
+		template <isa Isa, typename Class, bool Member>
+		auto find(char const* begin, char const* end) -> char const* {
+#ifdef GYNJO_SIMD_X86_64
+			if constexpr (Isa == isa::avx2) { return find_avx2<Class, Member>(begin, end); }
+			if constexpr (Isa == isa::sse2) { return find_sse2<Class, Member>(begin, end); }
+#endif
+			return find_scalar<Class, Member>(begin, end);
+		}
+
+		using kernel = auto (*)(char const*, char const*) -> char const*;
+
+		//! One implementation of each scanning kernel.
+		struct kernel_set {
+			kernel skip_space;
+			kernel find_line_end;
+			kernel skip_digits;
+		};
+
+		template <isa Isa>
+		constexpr kernel_set kernels_for{
+			find<Isa, space_class, false>, find<Isa, line_end_class, true>, find<Isa, digit_class, false>};
+
+		//! Selects the best instruction set and then forwards to the selected version of @p Kernel.
+		template <kernel kernel_set::*Kernel>
+		auto select_and_call(char const* begin, char const* end) -> char const*;
+
+		//! The kernels in use. Selection is deferred to the first call to keep CPU detection out of static init.
+		kernel_set active_kernels{select_and_call<&kernel_set::skip_space>,
+			select_and_call<&kernel_set::find_line_end>,
+			select_and_call<&kernel_set::skip_digits>};
+		isa active = isa::scalar;
+
+		template <kernel kernel_set::*Kernel>
+		auto select_and_call(char const* begin, char const* end) -> char const* {
+			set_active_isa(best_isa());
+			return (active_kernels.*Kernel)(begin, end);
+		}
+
+		//! Detects the most capable instruction set this CPU supports.
+		auto detect_isa() -> isa {
+#ifdef GYNJO_SIMD_X86_64
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] >= 7) {
+				__cpuidex(info, 7, 0);
+				bool const cpu_avx2 = (info[1] & (1 << 5)) != 0;
+				__cpuid(info, 1);
+				bool const os_saves_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+				if (cpu_avx2 && os_saves_ymm) { return isa::avx2; }
+			}
+#else
+			if (__builtin_cpu_supports("avx2")) { return isa::avx2; }
+#endif
+			// SSE2 is part of x86-64.
+			return isa::sse2;
+#else
+			return isa::scalar;
+#endif
+		}
+	}
+
+	auto to_string(isa isa) -> std::string_view {
+		switch (isa) {
+			case isa::scalar:
+				return "scalar";
+			case isa::sse2:
+				return "sse2";
+			case isa::avx2:
+				return "avx2";
+		}
+		return "unknown";
+	}
+
+	auto best_isa() -> isa {
+		static auto const result = detect_isa();
+		return result;
+	}
+
+	auto active_isa() -> isa {
+		// Resolve a pending selection so the answer reflects what the kernels will use.
+		if (active_kernels.skip_space == select_and_call<&kernel_set::skip_space>) { set_active_isa(best_isa()); }
+		return active;
+	}
+
+	auto set_active_isa(isa isa) -> bool {
+		if (isa > best_isa()) { return false; }
+		switch (isa) {
+			case isa::scalar:
+				active_kernels = kernels_for<isa::scalar>;
+				break;
+			case isa::sse2:
+				active_kernels = kernels_for<isa::sse2>;
+				break;
+			case isa::avx2:
+				active_kernels = kernels_for<isa::avx2>;
+				break;
+		}
+		active = isa;
+		return true;
+	}
+
+	auto skip_space(char const* begin, char const* end) -> char const* {
+		return active_kernels.skip_space(begin, end);
+	}
+
+	auto find_line_end(char const* begin, char const* end) -> char const* {
+		return active_kernels.find_line_end(begin, end);
+	}
+
+	auto skip_digits(char const* begin, char const* end) -> char const* {
+		return active_kernels.skip_digits(begin, end);
+	}
+}
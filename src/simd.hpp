@@ -0,0 +1,34 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Vectorized character-class scanning kernels for the lexer, selected at runtime.
+
+#pragma once
+
+#include <string_view>
+
+namespace gynjo::simd {
+	//! Instruction sets with scanning kernels, from least to most capable.
+	enum class isa { scalar, sse2, avx2 };
+
+	//! The name of @p isa.
+	auto to_string(isa isa) -> std::string_view;
+
+	//! The most capable instruction set supported by this CPU.
+	auto best_isa() -> isa;
+
+	//! The instruction set the kernels currently use. Defaults to the best supported one.
+	auto active_isa() -> isa;
+
+	//! Makes the kernels use @p isa, for testing and benchmarking.
+	//! @return Whether @p isa is supported. If not, the active instruction set is unchanged.
+	auto set_active_isa(isa isa) -> bool;
+
+	//! The first character in [@p begin, @p end) that isn't whitespace, in the sense of the ECMAScript "\s" class.
+	auto skip_space(char const* begin, char const* end) -> char const*;
+
+	//! The first line terminator ('\n' or '\r') in [@p begin, @p end), or @p end if there isn't one.
+	auto find_line_end(char const* begin, char const* end) -> char const*;
+
+	//! The first character in [@p begin, @p end) that isn't a decimal digit.
+	auto skip_digits(char const* begin, char const* end) -> char const*;
+}
@@ -0,0 +1,42 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "stack.hpp"
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+namespace gynjo {
+	namespace {
+		//! The lowest address of the current thread's stack, or zero if unknown.
+		auto stack_low_end() -> std::uintptr_t {
+#if defined(_WIN32)
+			ULONG_PTR low;
+			ULONG_PTR high;
+			GetCurrentThreadStackLimits(&low, &high);
+			return low;
+#elif defined(__APPLE__)
+			auto const self = pthread_self();
+			return reinterpret_cast<std::uintptr_t>(pthread_get_stackaddr_np(self)) - pthread_get_stacksize_np(self);
+#elif defined(__linux__)
+			pthread_attr_t attr;
+			if (pthread_getattr_np(pthread_self(), &attr) != 0) { return 0; }
+			void* low = nullptr;
+			std::size_t size = 0;
+			auto const found = pthread_attr_getstack(&attr, &low, &size) == 0;
+			pthread_attr_destroy(&attr);
+			return found ? reinterpret_cast<std::uintptr_t>(low) : 0;
+#else
+			return 0;
+#endif
+		}
+	}
+
+	auto stack_limit(std::size_t reserve) -> std::uintptr_t {
+		auto const low = stack_low_end();
+		return low == 0 ? 0 : low + reserve;
+	}
+}
@@ -0,0 +1,14 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Measures the native stack, so that deep recursion can stop before overflowing it.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gynjo {
+	//! The lowest address the current thread's stack can grow down to while leaving @p reserve bytes unused, or zero if
+	//! the stack's extent can't be determined on this platform.
+	auto stack_limit(std::size_t reserve) -> std::uintptr_t;
+}
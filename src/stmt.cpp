@@ -3,56 +3,65 @@
 
 #include "stmt.hpp"
 
-#include "expr.hpp"
+#include "tokens.hpp"
 
-namespace gynjo {
-	auto assign::operator==(assign const& that) const noexcept -> bool {
-		return symbol == that.symbol && *rhs == *that.rhs;
-	}
-
-	auto branch::operator==(branch const& that) const noexcept -> bool {
-		return *test == *that.test && *true_stmt == *that.true_stmt && *false_stmt == *that.false_stmt;
-	}
-
-	auto while_loop::operator==(while_loop const& that) const noexcept -> bool {
-		return *test == *that.test && *body == *that.body;
-	}
+#include <fmt/format.h>
 
-	auto for_loop::operator==(for_loop const& that) const noexcept -> bool {
-		return loop_var == that.loop_var && *range == *that.range && *body == *that.body;
-	}
-
-	auto ret::operator==(ret const& that) const noexcept -> bool {
-		return *result == *that.result;
-	}
-
-	auto expr_stmt::operator==(expr_stmt const& that) const noexcept -> bool {
-		return *expr == *that.expr;
+namespace gynjo {
+	auto stmt::operator==(stmt const& that) const noexcept -> bool {
+		auto const k = kind();
+		if (k != that.kind()) { return false; }
+		switch (k) {
+			case node_kind::nop:
+				return true;
+			case node_kind::imp:
+				return tree->literal(node) == that.tree->literal(that.node);
+			case node_kind::assign:
+				return expr_child(0) == that.expr_child(0) && expr_child(1) == that.expr_child(1);
+			case node_kind::ret:
+			case node_kind::expr_stmt:
+				return expr_child(0) == that.expr_child(0);
+			case node_kind::branch:
+				return expr_child(0) == that.expr_child(0) && stmt_child(1) == that.stmt_child(1) &&
+					stmt_child(2) == that.stmt_child(2);
+			case node_kind::while_loop:
+				return expr_child(0) == that.expr_child(0) && stmt_child(1) == that.stmt_child(1);
+			case node_kind::for_loop:
+				return expr_child(0) == that.expr_child(0) && expr_child(1) == that.expr_child(1) &&
+					stmt_child(2) == that.stmt_child(2);
+			default:
+				// Expressions aren't statements.
+				return false;
+		}
 	}
 
-	auto to_string(stmt const& stmt) -> std::string {
+	auto to_string(stmt const& stmt, print_form form) -> std::string {
 		using namespace std::string_literals;
-		return match(
-			stmt.value,
-			[](nop) { return "no-op"s; },
-			[](imp const& imp) { return "import " + imp.filename; },
-			[](assign const& assign) {
-				return fmt::format("let {} = {}", tok::to_string(assign.symbol), to_string(*assign.rhs));
-			},
-			[](branch const& branch) {
-				return fmt::format(
-					"if {} then {} else {}", to_string(*branch.test), to_string(*branch.true_stmt), to_string(*branch.false_stmt));
-			},
-			[](while_loop const& while_loop) {
-				return fmt::format("while {} do {}", to_string(*while_loop.test), to_string(*while_loop.body));
-			},
-			[](for_loop const& for_loop) {
+		switch (stmt.kind()) {
+			case node_kind::nop:
+				return "no-op"s;
+			case node_kind::imp:
+				return "import " + std::string{stmt.tree->literal(stmt.node)};
+			case node_kind::assign:
+				return fmt::format("let {} = {}", to_string(stmt.expr_child(0), form), to_string(stmt.expr_child(1), form));
+			case node_kind::branch:
+				return fmt::format("if {} then {} else {}",
+					to_string(stmt.expr_child(0), form),
+					to_string(stmt.stmt_child(1), form),
+					to_string(stmt.stmt_child(2), form));
+			case node_kind::while_loop:
+				return fmt::format("while {} do {}", to_string(stmt.expr_child(0), form), to_string(stmt.stmt_child(1), form));
+			case node_kind::for_loop:
 				return fmt::format("for {} in {} do {}",
-					tok::to_string(for_loop.loop_var),
-					to_string(*for_loop.range),
-					to_string(*for_loop.body));
-			},
-			[](ret const& ret) { return fmt::format("return {}", to_string(*ret.result)); },
-			[](expr_stmt const expr_stmt) { return fmt::format("{};", to_string(*expr_stmt.expr)); });
+					to_string(stmt.expr_child(0), form),
+					to_string(stmt.expr_child(1), form),
+					to_string(stmt.stmt_child(2), form));
+			case node_kind::ret:
+				return fmt::format("return {}", to_string(stmt.expr_child(0), form));
+			case node_kind::expr_stmt:
+				return fmt::format("{};", to_string(stmt.expr_child(0), form));
+			default:
+				return to_string(expr{stmt.tree, stmt.node}, form);
+		}
 	}
 }
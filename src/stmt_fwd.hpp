@@ -3,10 +3,6 @@
 
 #pragma once
 
-#include <memory>
-
 namespace gynjo {
 	struct stmt;
-
-	using stmt_ptr = std::shared_ptr<stmt>;
 }
@@ -0,0 +1,124 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Hash map from interned symbol names to values.
+
+#pragma once
+
+#include "interned.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace gynjo {
+	//! Map from interned names to @p T. Keys are compared by ID, so lookups never touch the names' characters.
+	//! @note Entries are stored densely, in insertion order. Small maps, such as most function call environments, are
+	//! searched linearly. Larger ones also keep an open-addressing hash index of their entries.
+	template <typename T>
+	struct symbol_map {
+		//! Inserts @p value for @p name if @p name isn't already present.
+		//! @return The value for @p name.
+		auto try_emplace(interned name, T value) -> T& {
+			if (auto const index = find_index(name); index != npos) { return _entries[index].second; }
+			return insert(name, std::move(value));
+		}
+
+		//! Assigns @p value to @p name, inserting it if necessary.
+		auto insert_or_assign(interned name, T value) -> T& {
+			if (auto const index = find_index(name); index != npos) { return _entries[index].second = std::move(value); }
+			return insert(name, std::move(value));
+		}
+
+		//! The value for @p name, which is default-constructed first if @p name isn't present.
+		auto operator[](interned name) -> T& {
+			if (auto const index = find_index(name); index != npos) { return _entries[index].second; }
+			return insert(name, T{});
+		}
+
+		//! The value for @p name, or null if @p name isn't present.
+		auto find(interned name) const noexcept -> T const* {
+			auto const index = find_index(name);
+			return index == npos ? nullptr : &_entries[index].second;
+		}
+
+		auto size() const noexcept -> std::size_t {
+			return _entries.size();
+		}
+
+		auto empty() const noexcept -> bool {
+			return _entries.empty();
+		}
+
+		//! Removes every entry.
+		auto clear() -> void {
+			_entries.clear();
+			_index.clear();
+		}
+
+	private:
+		//! Maps with at most this many entries have no index.
+		static constexpr std::size_t linear_limit = 8;
+		//! Marks an unused index slot, or the absence of an entry.
+		static constexpr std::uint32_t npos = UINT32_MAX;
+
+		//! Entries, in insertion order.
+		std::vector<std::pair<interned, T>> _entries;
+		//! Open-addressing hash table of entry indices, or empty if the map is small. The size is a power of two.
+		std::vector<std::uint32_t> _index;
+
+		//! Fibonacci hash of the name's ID, which spreads consecutive IDs apart.
+		static auto hash(interned name) noexcept -> std::size_t {
+			return static_cast<std::size_t>((std::uint64_t{name.id} * 11400714819323198485ull) >> 32);
+		}
+
+		//! The index of the entry for @p name, or npos if @p name isn't present.
+		auto find_index(interned name) const noexcept -> std::uint32_t {
+			if (_index.empty()) {
+				for (std::uint32_t i = 0; i < _entries.size(); ++i) {
+					if (_entries[i].first == name) { return i; }
+				}
+				return npos;
+			}
+			auto const mask = _index.size() - 1;
+			for (auto i = hash(name) & mask;; i = (i + 1) & mask) {
+				auto const entry = _index[i];
+				if (entry == npos || _entries[entry].first == name) { return entry; }
+			}
+		}
+
+		//! Adds an entry for @p name, which isn't present.
+		auto insert(interned name, T value) -> T& {
+			_entries.emplace_back(name, std::move(value));
+			if (_entries.size() > linear_limit) {
+				// Keep the index's load factor at or below one half.
+				if (2 * _entries.size() > _index.size()) {
+					reindex();
+				} else {
+					index_entry(static_cast<std::uint32_t>(_entries.size() - 1));
+				}
+			}
+			return _entries.back().second;
+		}
+
+		//! Rebuilds the index with room for twice as many entries.
+		auto reindex() -> void {
+			std::size_t size = 2 * linear_limit;
+			while (size < 4 * _entries.size()) {
+				size *= 2;
+			}
+			_index.assign(size, npos);
+			for (std::uint32_t entry = 0; entry < _entries.size(); ++entry) {
+				index_entry(entry);
+			}
+		}
+
+		auto index_entry(std::uint32_t entry) -> void {
+			auto const mask = _index.size() - 1;
+			auto i = hash(_entries[entry].first) & mask;
+			while (_index[i] != npos) {
+				i = (i + 1) & mask;
+			}
+			_index[i] = entry;
+		}
+	};
+}
@@ -3,9 +3,12 @@
 
 #pragma once
 
+#include "interned.hpp"
 #include "intrinsics.hpp"
 #include "visitation.hpp"
 
+#include <fmt/format.h>
+
 #include <compare>
 #include <string>
 #include <variant>
@@ -166,11 +169,18 @@ namespace gynjo::tok {
 	};
 	//! Token for symbols.
 	struct sym {
-		std::string name;
+		interned name;
 		auto operator<=>(sym const&) const noexcept = default;
 	};
+	//! Token for string literals, with quotes and escape characters removed.
+	struct str {
+		std::string value;
+		auto operator<=>(str const&) const noexcept = default;
+	};
 
 	//! Union type of all valid tokens.
+	//! @note Symbol names live in the intern table, so symbols are trivially copyable. Literal text is owned by its token,
+	//! so that the intern table holds only the names a program uses, however many distinct literals it contains.
 	using token = std::variant<
 		// clang-format off
 		imp,
@@ -182,7 +192,7 @@ namespace gynjo::tok {
 		plus, minus, mul, div, exp, // arithmetic ops
 		lparen, rparen, lsquare, rsquare, lcurly, rcurly, // brackets
 		com, semicolon, arrow, que, colon, // punctuation
-		boolean, num, sym, intrinsic, std::string // values
+		boolean, num, sym, intrinsic, str // values
 		// clang-format on
 		>;
 
@@ -229,8 +239,8 @@ namespace gynjo::tok {
 			[](colon const&) { return ":"s; },
 			[](boolean const& b) { return b.value ? "true"s : "false"s; },
 			[](num const& n) { return n.rep; },
-			[](sym const& s) { return s.name; },
+			[](sym const& s) { return std::string{s.name.str()}; },
 			[](intrinsic const& f) { return name(f); },
-			[](std::string const& str) { return '"' + str + '"'; });
+			[](str const& s) { return fmt::format("\"{}\"", s.value); });
 	}
 }
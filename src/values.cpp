@@ -17,7 +17,65 @@ namespace gynjo::val {
 	}
 
 	auto list::operator==(list const& that) const noexcept -> bool {
-		return *head == *that.head && *tail == *that.tail;
+		// Compare iteratively along the tails, so long lists can't overflow the stack.
+		list const* left = this;
+		list const* right = &that;
+		for (;;) {
+			if (left->head != right->head) { return false; }
+			if (!left->tail.is<list>() || !right->tail.is<list>()) { return left->tail == right->tail; }
+			left = &left->tail.as<list>();
+			right = &right->tail.as<list>();
+		}
+	}
+
+	auto value::destroy() noexcept -> void {
+		switch (_tag) {
+			case tag::num:
+				delete static_cast<box<num>*>(boxed());
+				break;
+			case tag::string:
+				delete static_cast<box<std::string>*>(boxed());
+				break;
+			case tag::tup:
+				delete static_cast<box<tup>*>(boxed());
+				break;
+			case tag::list: {
+				// To avoid stack overflow, lists are destroyed iteratively by eating the tail. Only nodes owned solely by
+				// the tail eater may be eaten, since other lists may share the rest.
+				auto node = static_cast<box<list>*>(boxed());
+				for (;;) {
+					value tail_eater = std::move(node->content.tail);
+					delete node;
+					if (tail_eater._tag != tag::list || tail_eater.boxed()->count != 1) { break; }
+					node = static_cast<box<list>*>(tail_eater.boxed());
+					// The eater owns the next node alone, so it can release it without counting.
+					tail_eater._tag = tag::empty;
+				}
+				break;
+			}
+			case tag::closure:
+				delete static_cast<box<closure>*>(boxed());
+				break;
+			default:
+				break;
+		}
+	}
+
+	auto operator==(value const& a, value const& b) -> bool {
+		using tag = value::tag;
+		if (a._tag == tag::machine_int && b._tag == tag::machine_int) {
+			return a.load<std::int64_t>() == b.load<std::int64_t>();
+		}
+		return visit(
+			[](auto const& x, auto const& y) {
+				if constexpr (std::is_same_v<decltype(x), decltype(y)>) {
+					return x == y;
+				} else {
+					return false;
+				}
+			},
+			a,
+			b);
 	}
 
 	auto to_string(value const& val, std::shared_ptr<environment> const& env) -> std::string {
@@ -27,12 +85,13 @@ namespace gynjo::val {
 			[](tok::boolean const& b) { return tok::to_string(b); },
 			[&](num const& num) {
 				constexpr auto default_precision = 12;
-				auto const o_precision = env->lookup("precision");
+				static interned const precision_name{"precision"};
+				auto const o_precision = env->lookup(precision_name);
 				// Use default precision if there's no precision variable or if it's not an integer.
 				auto const precision = o_precision ? as_int(*o_precision).value_or(default_precision) : default_precision;
 				return num.str(precision);
 			},
-			[](std::string const& str) { return tok::to_string(str); },
+			[](std::string const& str) { return fmt::format("\"{}\"", str); },
 			[&](tup const& tup) {
 				std::string result = "(";
 				if (!tup.elems->empty()) {
@@ -46,20 +105,18 @@ namespace gynjo::val {
 			},
 			[](empty) { return "[]"s; },
 			[&](list const& list) {
-				std::string result = "[" + to_string(*list.head, env);
-				auto current = list.tail;
-				while (!std::holds_alternative<empty>(*current)) {
-					auto const& current_list = std::get<val::list>(*current);
-					result += ", " + to_string(*current_list.head, env);
-					current = current_list.tail;
+				std::string result = "[" + to_string(list.head, env);
+				for (auto current = &list.tail; current->is<val::list>(); current = &current->as<val::list>().tail) {
+					result += ", " + to_string(current->as<val::list>().head, env);
 				}
 				result += "]";
 				return result;
 			},
-			[&](closure const& c) { return to_string(expr{c.f}); });
+			[&](closure const& c) { return to_string(c.f); });
 	}
 
 	auto as_int(value const& val) -> std::optional<int> {
-		return std::holds_alternative<num>(val) ? std::make_optional(std::get<num>(val).convert_to<int>()) : std::nullopt;
+		num storage;
+		return val.is<num>() ? std::make_optional(val.as(storage).convert_to<int>()) : std::nullopt;
 	}
 }
@@ -5,28 +5,33 @@
 
 #include "environment_fwd.hpp"
 #include "expr.hpp"
+#include "num.hpp"
 #include "tokens.hpp"
 #include "visitation.hpp"
 
-#include <boost/multiprecision/cpp_dec_float.hpp>
-
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace gynjo {
 	namespace val {
-		//! Floating-point number.
-		using num = boost::multiprecision::cpp_dec_float_100;
-
-		//! Union type of all Gynjo value types.
-		using value = std::variant<tok::boolean, num, std::string, struct tup, struct empty, struct list, struct closure>;
-
-		//! Shared pointer to a Gynjo value.
-		using ptr = std::shared_ptr<value>;
+		class value;
 
 		//! A lambda along with the environment in which it was called.
 		struct closure {
-			lambda f;
+			//! The lambda expression.
+			expr f;
 			std::shared_ptr<environment> env;
+			//! Keeps the syntax tree containing the lambda alive.
+			std::shared_ptr<ast const> code;
 
 			~closure();
 
@@ -44,52 +49,335 @@ namespace gynjo {
 			auto operator==(tup const&) const noexcept -> bool;
 		};
 
-		template <typename... Args>
-		auto make_tup(Args&&... args) {
-			auto elems = std::make_shared<std::vector<value>>();
-			(elems->push_back(std::move(args)), ...);
-			return tup{std::move(elems)};
-		}
-
 		//! The empty Gynjo type.
 		struct empty {
 			auto operator==(empty const&) const noexcept -> bool = default;
 		};
 
+		struct list;
+
+		//! A Gynjo value: a boolean, number, string, tuple, empty list, list, or closure. Use match to visit a value as if
+		//! it were a variant of those types.
+		//!
+		//! A value takes 16 bytes. Booleans, empty lists, machine numbers, and strings of up to 14 bytes are stored in
+		//! place. Anything else is boxed: stored once behind a reference count and shared by copies, so it's immutable.
+		//! The count isn't atomic, so a value and its copies must stay on one thread.
+		class value {
+		public:
+			//! False, as a variant of the value types would be by default.
+			value() noexcept : value{tok::boolean{false}} {}
+
+			value(tok::boolean b) noexcept : _tag{tag::boolean} {
+				_bytes[0] = std::byte{b.value};
+			}
+
+			template <std::integral T>
+			value(T i) : value{num{i}} {}
+
+			value(num const& n);
+
+			value(std::string s);
+
+			value(tup t);
+
+			value(empty) noexcept : _tag{tag::empty} {}
+
+			value(list l);
+
+			value(closure c);
+
+			value(value const& that) noexcept : _bytes{that._bytes}, _size{that._size}, _tag{that._tag} {
+				if (is_boxed()) { ++boxed()->count; }
+			}
+
+			value(value&& that) noexcept : _bytes{that._bytes}, _size{that._size}, _tag{that._tag} {
+				that._tag = tag::empty;
+			}
+
+			~value() {
+				release();
+			}
+
+			// Assignment copies or moves first, since the assigned value may be part of this one.
+
+			auto operator=(value const& that) noexcept -> value& {
+				value copy{that};
+				swap(copy);
+				return *this;
+			}
+
+			auto operator=(value&& that) noexcept -> value& {
+				value moved{std::move(that)};
+				swap(moved);
+				return *this;
+			}
+
+			//! Whether this value is a @p T.
+			template <typename T>
+			auto is() const noexcept -> bool;
+
+			//! This value as a @p T, which it must be. Tuples, lists and closures are returned by reference, and other types
+			//! by value.
+			template <typename T>
+			auto as() const -> decltype(auto);
+
+			//! This value as a number or string @p T, which it must be. A boxed number or string is returned by reference,
+			//! and one stored in place is converted into @p storage.
+			template <typename T>
+				requires std::is_same_v<T, num> || std::is_same_v<T, std::string>
+			auto as(T& storage) const -> T const&;
+
+			//! Moves this value, which must be a boxed @p T, out of its box if this is its only owner or else copies it,
+			//! leaving this value empty.
+			template <typename T>
+			auto take() -> T;
+
+			friend auto operator==(value const& a, value const& b) -> bool;
+
+			//! Calls @p f with @p v as whichever type it is. This is how match visits values.
+			template <typename F>
+			friend auto visit(F&& f, value const& v) -> decltype(auto);
+
+			//! Calls @p f with @p v1 and @p v2 as whichever types they are. This is how match2 visits values.
+			template <typename F>
+			friend auto visit(F&& f, value const& v1, value const& v2) -> decltype(auto);
+
+		private:
+			enum class tag : std::uint8_t {
+				boolean,
+				empty,
+				machine_int,
+				machine_double,
+				short_string,
+				// The boxed types follow.
+				num,
+				string,
+				tup,
+				list,
+				closure,
+			};
+
+			//! The reference count of a box. Values aren't shared between threads running at the same time, so it
+			//! needn't be atomic. Even the core environment is per thread (see environment::make_with_core_libs).
+			struct header {
+				std::size_t count = 1;
+			};
+
+			template <typename T>
+			struct box : header {
+				T content;
+			};
+
+			static constexpr std::size_t short_string_capacity = 14;
+
+			//! A machine number, a box pointer, or a short string's characters.
+			alignas(std::int64_t) std::array<std::byte, short_string_capacity> _bytes{};
+			//! The length of a short string.
+			std::uint8_t _size = 0;
+			tag _tag;
+
+			auto is_boxed() const noexcept -> bool {
+				return _tag >= tag::num;
+			}
+
+			//! Stores @p word at the start of the bytes.
+			template <typename T>
+			auto store(T word) noexcept -> void {
+				std::memcpy(_bytes.data(), &word, sizeof(T));
+			}
+
+			//! Loads a @p T from the start of the bytes.
+			template <typename T>
+			auto load() const noexcept -> T {
+				T word;
+				std::memcpy(&word, _bytes.data(), sizeof(T));
+				return word;
+			}
+
+			auto boxed() const noexcept -> header* {
+				return load<header*>();
+			}
+
+			template <typename T>
+			auto content() const noexcept -> T const& {
+				return static_cast<box<T> const*>(boxed())->content;
+			}
+
+			//! Boxes @p content, with this value as its only owner.
+			template <typename T>
+			auto store_boxed(tag t, T content) -> void {
+				_tag = t;
+				store(static_cast<header*>(new box<T>{{}, std::move(content)}));
+			}
+
+			auto swap(value& that) noexcept -> void {
+				std::swap(_bytes, that._bytes);
+				std::swap(_size, that._size);
+				std::swap(_tag, that._tag);
+			}
+
+			auto release() noexcept -> void {
+				if (is_boxed() && --boxed()->count == 0) { destroy(); }
+			}
+
+			//! Deletes the box of this value, whose last owner is releasing it.
+			auto destroy() noexcept -> void;
+		};
+
+		static_assert(sizeof(value) == 16);
+
 		//! Functional list of Gynjo values.
 		struct list {
 			//! The top value of this list.
-			ptr head;
+			value head;
 			//! Either another list or empty.
-			ptr tail;
+			value tail;
 
 			auto operator==(list const&) const noexcept -> bool;
 		};
 
-		//! Convenience function for creating a value pointer from @p value.
+		inline value::value(num const& n) {
+			if (auto const i = n.machine_int()) {
+				_tag = tag::machine_int;
+				store(*i);
+			} else if (auto const d = n.machine_double()) {
+				_tag = tag::machine_double;
+				store(*d);
+			} else {
+				store_boxed(tag::num, n);
+			}
+		}
+
+		inline value::value(std::string s) {
+			if (s.size() <= short_string_capacity) {
+				_tag = tag::short_string;
+				_size = static_cast<std::uint8_t>(s.size());
+				std::memcpy(_bytes.data(), s.data(), s.size());
+			} else {
+				store_boxed(tag::string, std::move(s));
+			}
+		}
+
+		inline value::value(tup t) {
+			store_boxed(tag::tup, std::move(t));
+		}
+
+		inline value::value(list l) {
+			store_boxed(tag::list, std::move(l));
+		}
+
+		inline value::value(closure c) {
+			store_boxed(tag::closure, std::move(c));
+		}
+
 		template <typename T>
-		auto make_value(T&& value) {
-			if constexpr (std::is_same_v<std::remove_cvref_t<T>, list>) {
-				// To avoid stack overflow, list pointers must be destroyed iteratively by eating the tail.
-				return std::shared_ptr<val::value>(new val::value{std::forward<T>(value)}, [](val::value* v) {
-					auto& l = std::get<list>(*v);
-					l.head = nullptr;
-					auto tail_eater = std::move(l.tail);
-					while (tail_eater != nullptr && std::holds_alternative<val::list>(*tail_eater)) {
-						tail_eater = std::move(std::get<val::list>(*tail_eater).tail);
-					}
-					tail_eater = nullptr;
-					delete v;
-				});
+		auto value::is() const noexcept -> bool {
+			if constexpr (std::is_same_v<T, tok::boolean>) {
+				return _tag == tag::boolean;
+			} else if constexpr (std::is_same_v<T, num>) {
+				return _tag == tag::machine_int || _tag == tag::machine_double || _tag == tag::num;
+			} else if constexpr (std::is_same_v<T, std::string>) {
+				return _tag == tag::short_string || _tag == tag::string;
+			} else if constexpr (std::is_same_v<T, tup>) {
+				return _tag == tag::tup;
+			} else if constexpr (std::is_same_v<T, empty>) {
+				return _tag == tag::empty;
+			} else if constexpr (std::is_same_v<T, list>) {
+				return _tag == tag::list;
 			} else {
-				return std::make_shared<val::value>(std::forward<T>(value));
+				static_assert(std::is_same_v<T, closure>, "not a value type");
+				return _tag == tag::closure;
 			}
 		}
 
+		template <typename T>
+		auto value::as() const -> decltype(auto) {
+			if constexpr (std::is_same_v<T, tok::boolean>) {
+				return tok::boolean{_bytes[0] != std::byte{0}};
+			} else if constexpr (std::is_same_v<T, num>) {
+				if (_tag == tag::machine_int) { return num{load<std::int64_t>()}; }
+				if (_tag == tag::machine_double) { return num::binary(load<double>()); }
+				return num{content<num>()};
+			} else if constexpr (std::is_same_v<T, std::string>) {
+				if (_tag == tag::short_string) { return std::string(reinterpret_cast<char const*>(_bytes.data()), _size); }
+				return std::string{content<std::string>()};
+			} else if constexpr (std::is_same_v<T, empty>) {
+				return empty{};
+			} else {
+				return content<T>();
+			}
+		}
+
+		template <typename T>
+			requires std::is_same_v<T, num> || std::is_same_v<T, std::string>
+		auto value::as(T& storage) const -> T const& {
+			if (_tag == (std::is_same_v<T, num> ? tag::num : tag::string)) { return content<T>(); }
+			storage = as<T>();
+			return storage;
+		}
+
+		template <typename T>
+		auto value::take() -> T {
+			auto& content = static_cast<box<T>*>(boxed())->content;
+			T result = boxed()->count == 1 ? T(std::move(content)) : T(content);
+			*this = empty{};
+			return result;
+		}
+
+		template <typename F>
+		auto visit(F&& f, value const& v) -> decltype(auto) {
+			using tag = value::tag;
+			switch (v._tag) {
+				case tag::boolean: {
+					auto const b = v.as<tok::boolean>();
+					return f(b);
+				}
+				case tag::empty: {
+					empty const e{};
+					return f(e);
+				}
+				case tag::machine_int:
+				case tag::machine_double: {
+					auto const n = v.as<num>();
+					return f(n);
+				}
+				case tag::short_string: {
+					auto const s = v.as<std::string>();
+					return f(s);
+				}
+				case tag::num:
+					return f(v.content<num>());
+				case tag::string:
+					return f(v.content<std::string>());
+				case tag::tup:
+					return f(v.content<tup>());
+				case tag::list:
+					return f(v.content<list>());
+				default:
+					return f(v.content<closure>());
+			}
+		}
+
+		template <typename F>
+		auto visit(F&& f, value const& v1, value const& v2) -> decltype(auto) {
+			return visit(
+				[&](auto const& a) -> decltype(auto) {
+					return visit([&](auto const& b) -> decltype(auto) { return f(a, b); }, v2);
+				},
+				v1);
+		}
+
+		template <typename... Args>
+		auto make_tup(Args&&... args) {
+			auto elems = std::make_shared<std::vector<value>>();
+			(elems->push_back(std::move(args)), ...);
+			return tup{std::move(elems)};
+		}
+
 		template <typename... Args>
 		auto make_list(Args&&... args) {
-			val::value result = val::empty{};
-			((result = val::list{make_value(std::move(args)), make_value(std::move(result))}), ...);
+			value result = empty{};
+			((result = list{value{std::move(args)}, std::move(result)}), ...);
 			return result;
 		}
 
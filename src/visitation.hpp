@@ -17,18 +17,19 @@ namespace gynjo {
 	template <typename... Funcs>
 	overloaded(Funcs...)->overloaded<Funcs...>;
 
-	//! Visits the variant @p v using the handlers @p handlers.
+	//! Visits the variant @p v using the handlers @p handlers. Types other than variants can be matched too, if they
+	//! provide a visit function that argument-dependent lookup finds.
 	//! @note Credit to Nikolai Wuttke, "std::variant and the power of pattern matching".
 	template <typename Variant, typename... Handlers>
 	auto match(Variant&& v, Handlers&&... handlers) {
-		return std::visit(overloaded{std::forward<Handlers>(handlers)...}, std::forward<Variant>(v));
+		return visit(overloaded{std::forward<Handlers>(handlers)...}, std::forward<Variant>(v));
 	}
 
 	//! Visits the variants @p v1 and @p v2 using the handlers @p handlers.
 	//! @note Credit to Nikolai Wuttke, "std::variant and the power of pattern matching".
 	template <typename Variant1, typename Variant2, typename... Handlers>
 	auto match2(Variant1&& v1, Variant2&& v2, Handlers&&... handlers) {
-		return std::visit( //
+		return visit( //
 			overloaded{std::forward<Handlers>(handlers)...},
 			std::forward<Variant1>(v1),
 			std::forward<Variant2>(v2));
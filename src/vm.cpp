@@ -0,0 +1,424 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "vm.hpp"
+
+#include "environment.hpp"
+#include "operations.hpp"
+
+#include <fmt/format.h>
+
+#include <iterator>
+
+// Dispatch through a table of label addresses where the compiler supports it, so that each operation ends in its own
+// indirect branch. Otherwise, fall back to a switch.
+// @note A computed goto doesn't destroy the locals of the scopes it leaves, so handlers must only dispatch once their
+// locals are out of scope.
+#if defined(__GNUC__) || defined(__clang__)
+#define GYNJO_COMPUTED_GOTO
+#endif
+
+//! Calls X on the name of each opcode, in order.
+#define GYNJO_OPCODES(X) \
+	X(push_const) \
+	X(load) \
+	X(load_slot) \
+	X(store) \
+	X(store_slot) \
+	X(make_closure) \
+	X(make_tup) \
+	X(make_list) \
+	X(cluster) \
+	X(tail_cluster) \
+	X(not_) \
+	X(neg) \
+	X(binary) \
+	X(binary_load) \
+	X(binary_load_slot) \
+	X(and_left) \
+	X(and_right) \
+	X(or_left) \
+	X(or_right) \
+	X(jump) \
+	X(jump_unless) \
+	X(jump_unless_while) \
+	X(for_begin) \
+	X(for_next) \
+	X(discard_unit) \
+	X(import) \
+	X(ret_outside_block) \
+	X(eval_stmt) \
+	X(end)
+
+namespace gynjo {
+	namespace {
+		//! The value stack, shared by nested runs on this thread. Each run uses the part above where it started.
+		auto value_stack() -> std::vector<val::value>& {
+			thread_local std::vector<val::value> stack;
+			return stack;
+		}
+
+		//! The evaluations of cluster instructions in progress, innermost last, shared by nested runs on this thread like
+		//! the value stack. Each belongs to the current call or to a suspended call.
+		auto cluster_stack() -> std::vector<cluster_eval>& {
+			thread_local std::vector<cluster_eval> stack;
+			return stack;
+		}
+
+		//! A call suspended while a function it called runs. Its cluster evaluation awaits the result on the cluster
+		//! stack.
+		struct suspended_call {
+			env_ptr env;
+			chunk const* code;
+			//! The cluster instruction that made the call.
+			instr const* ip;
+			//! Keeps the syntax tree of the suspended code alive, if it isn't the code being run.
+			std::shared_ptr<ast const> code_owner;
+		};
+
+		//! The calls suspended while the functions they called run, innermost last, shared by nested runs on this
+		//! thread. Keeping these on the heap rather than nesting runs lets recursion go as deep as the maximum depth.
+		auto call_stack() -> std::vector<suspended_call>& {
+			thread_local std::vector<suspended_call> stack;
+			return stack;
+		}
+	}
+
+	auto run(env_ptr const& entry_env, chunk const& entry_code) -> eval_result {
+		auto& stack = value_stack();
+		auto& clusters = cluster_stack();
+		auto& callers = call_stack();
+		auto const base = stack.size();
+		auto const cluster_base = clusters.size();
+		auto const caller_base = callers.size();
+		auto const depth_limit = max_depth();
+		// The current call's frame and code.
+		env_ptr env = entry_env;
+		chunk const* code = &entry_code;
+		ast const* tree = code->tree;
+		instr const* begin = code->code.data();
+		instr const* ip = begin;
+		// Keeps the syntax tree of the current code alive, if it isn't the code being run.
+		std::shared_ptr<ast const> code_owner;
+
+		// Unwinds this run's part of the stacks and reports @p message in the error contexts of the suspended calls and
+		// the current instruction.
+		auto const fail = [&](std::string message) -> eval_result {
+			std::string prefixes;
+			for (auto it = callers.begin() + caller_base; it != callers.end(); ++it) {
+				prefixes += it->code->in_context(it->ip - it->code->code.data(), {});
+			}
+			stack.resize(base);
+			clusters.erase(clusters.begin() + cluster_base, clusters.end());
+			callers.erase(callers.begin() + caller_base, callers.end());
+			return tl::unexpected{prefixes + code->in_context(ip - begin, std::move(message))};
+		};
+		auto const pop = [&] {
+			auto result = std::move(stack.back());
+			stack.pop_back();
+			return result;
+		};
+		// Moves the top @p count values off the stack, in order.
+		auto const pop_n = [&](std::size_t count) {
+			std::vector<val::value> result(
+				std::make_move_iterator(stack.end() - count), std::make_move_iterator(stack.end()));
+			stack.resize(stack.size() - count);
+			return result;
+		};
+		// The value of the local variable @p ref refers to, in place, or null if it's undefined.
+		auto const find_slot = [&](slot_ref const& ref) -> val::value const* {
+			environment const* frame = env.get();
+			for (auto i = ref.depth; i != 0 && frame != nullptr; --i) {
+				frame = frame->parent_env.get();
+			}
+			if (frame != nullptr && ref.slot < frame->slot_names.size() && frame->slot_names[ref.slot] == ref.name &&
+				frame->slots[ref.slot].has_value()) {
+				return &*frame->slots[ref.slot];
+			}
+			// The variable hasn't been assigned yet, so the name refers to a variable in an enclosing scope. (Or the frame
+			// didn't come from the expected function's bytecode, e.g. because the tree walker created it.)
+			return env->lookup(ref.name);
+		};
+
+#ifdef GYNJO_COMPUTED_GOTO
+#define GYNJO_LABEL_ADDRESS(name) &&op_##name,
+		static void* const dispatch_table[] = {GYNJO_OPCODES(GYNJO_LABEL_ADDRESS)};
+#undef GYNJO_LABEL_ADDRESS
+		static_assert(std::size(dispatch_table) == static_cast<std::size_t>(opcode::end) + 1);
+#define GYNJO_DISPATCH() goto* dispatch_table[static_cast<std::size_t>(ip->op)]
+#else
+#define GYNJO_DISPATCH() goto dispatch
+#endif
+#define GYNJO_NEXT() \
+	++ip; \
+	GYNJO_DISPATCH()
+#define GYNJO_JUMP() \
+	ip = begin + ip->arg; \
+	GYNJO_DISPATCH()
+
+		GYNJO_DISPATCH();
+
+#ifndef GYNJO_COMPUTED_GOTO
+	dispatch:
+		switch (ip->op) {
+#define GYNJO_CASE(name) \
+	case opcode::name: \
+		goto op_##name;
+			GYNJO_OPCODES(GYNJO_CASE)
+#undef GYNJO_CASE
+		}
+#endif
+
+	op_push_const:
+		stack.push_back(code->constants[ip->arg]);
+		GYNJO_NEXT();
+
+	op_load: {
+		auto const name = tree->symbol(ip->arg);
+		auto const value = env->lookup(name);
+		if (value == nullptr) { return fail(fmt::format("'{}' is undefined", name.str())); }
+		stack.push_back(*value);
+	}
+		GYNJO_NEXT();
+
+	op_load_slot: {
+		auto const& ref = code->slot_refs[ip->arg];
+		auto const value = find_slot(ref);
+		if (value == nullptr) { return fail(fmt::format("'{}' is undefined", ref.name.str())); }
+		stack.push_back(*value);
+	}
+		GYNJO_NEXT();
+
+	op_store:
+		env->local_vars.insert_or_assign(tree->symbol(ip->arg), pop());
+		GYNJO_NEXT();
+
+	op_store_slot:
+		// Only a function's own frames run its bytecode, so the slot exists.
+		env->slots[ip->arg] = pop();
+		GYNJO_NEXT();
+
+	op_make_closure:
+		stack.push_back(val::closure{expr{tree, ip->arg}, std::make_shared<environment>(env), tree->shared_from_this()});
+		GYNJO_NEXT();
+
+	op_make_tup:
+		stack.push_back(val::tup{std::make_shared<std::vector<val::value>>(pop_n(ip->arg))});
+		GYNJO_NEXT();
+
+	op_make_list: {
+		// Elements are stored in reverse order, so prepending each in turn builds the list.
+		val::value list = val::empty{};
+		for (auto it = stack.end() - ip->arg; it != stack.end(); ++it) {
+			list = val::list{std::move(*it), std::move(list)};
+		}
+		stack.resize(stack.size() - ip->arg);
+		stack.push_back(std::move(list));
+	}
+		GYNJO_NEXT();
+
+	op_cluster:
+	op_tail_cluster:
+		// The items must leave the stack first, since calls run on top of it.
+		clusters.emplace_back(expr{tree, ip->arg}, pop_n(tree->cluster_items(ip->arg).size()));
+	advance_cluster: {
+		bool called;
+		{
+			auto& cluster = clusters.back();
+			auto result = cluster.advance(env);
+			if (!result.has_value()) { return fail(std::move(result.error())); }
+			called = !result.value().has_value();
+			if (!called) {
+				stack.push_back(std::move(*result.value()));
+				clusters.pop_back();
+			} else {
+				// Switch to the callee's frame and code.
+				auto& call = cluster.call();
+				auto const& callee_code = bytecode(call.f.f);
+				auto frame = call_env(call.f, std::move(call.arg), &callee_code);
+				if (!frame.has_value()) { return fail(std::move(frame.error())); }
+				auto callee_owner = std::move(call.f.code);
+				if (ip->op == opcode::tail_cluster && cluster.call_is_last()) {
+					// Replace the current call, so that tail recursion runs in constant space.
+					clusters.pop_back();
+				} else {
+					if (callers.size() - caller_base >= depth_limit) { return fail(max_depth_error(depth_limit)); }
+					callers.push_back({std::move(env), code, ip, std::move(code_owner)});
+				}
+				env = std::move(frame.value());
+				code_owner = std::move(callee_owner);
+				code = &callee_code;
+				tree = code->tree;
+				begin = code->code.data();
+				ip = begin;
+			}
+		}
+		if (called) { GYNJO_DISPATCH(); }
+	}
+		GYNJO_NEXT();
+
+	op_not_: {
+		auto result = logical_not(env, stack.back());
+		if (!result.has_value()) { return fail(std::move(result.error())); }
+		stack.back() = std::move(result.value());
+	}
+		GYNJO_NEXT();
+
+	op_neg: {
+		auto result = negate(env, stack.back());
+		if (!result.has_value()) { return fail(std::move(result.error())); }
+		stack.back() = std::move(result.value());
+	}
+		GYNJO_NEXT();
+
+	op_binary: {
+		auto const right = pop();
+		auto result = binary_op(static_cast<node_kind>(ip->arg), env, stack.back(), right);
+		if (!result.has_value()) { return fail(std::move(result.error())); }
+		stack.back() = std::move(result.value());
+	}
+		GYNJO_NEXT();
+
+	op_binary_load: {
+		auto const name = tree->symbol(tree->child(ip->arg, 1));
+		auto const right = env->lookup(name);
+		if (right == nullptr) { return fail(fmt::format("'{}' is undefined", name.str())); }
+		auto result = binary_op(tree->kind(ip->arg), env, stack.back(), *right);
+		if (!result.has_value()) { return fail(std::move(result.error())); }
+		stack.back() = std::move(result.value());
+	}
+		GYNJO_NEXT();
+
+	op_binary_load_slot: {
+		auto const& ref = code->slot_refs[ip->arg & ((1u << binary_slot_bits) - 1)];
+		auto const right = find_slot(ref);
+		if (right == nullptr) { return fail(fmt::format("'{}' is undefined", ref.name.str())); }
+		auto result = binary_op(static_cast<node_kind>(ip->arg >> binary_slot_bits), env, stack.back(), *right);
+		if (!result.has_value()) { return fail(std::move(result.error())); }
+		stack.back() = std::move(result.value());
+	}
+		GYNJO_NEXT();
+
+	op_and_left:
+		if (!stack.back().is<tok::boolean>()) {
+			return fail(
+				fmt::format("cannot take logical conjunction of non-boolean value {}", to_string(stack.back(), env)));
+		}
+		if (!stack.back().as<tok::boolean>().value) {
+			// Short-circuit, leaving false as the result.
+			GYNJO_JUMP();
+		}
+		stack.pop_back();
+		GYNJO_NEXT();
+
+	op_and_right:
+		if (!stack.back().is<tok::boolean>()) {
+			return fail(
+				fmt::format("cannot take logical conjunction of non-boolean value {}", to_string(stack.back(), env)));
+		}
+		GYNJO_NEXT();
+
+	op_or_left:
+		if (!stack.back().is<tok::boolean>()) {
+			return fail(
+				fmt::format("cannot take logical disjunction of non-boolean value {}", to_string(stack.back(), env)));
+		}
+		if (stack.back().as<tok::boolean>().value) {
+			// Short-circuit, leaving true as the result.
+			GYNJO_JUMP();
+		}
+		stack.pop_back();
+		GYNJO_NEXT();
+
+	op_or_right:
+		if (!stack.back().is<tok::boolean>()) {
+			return fail(
+				fmt::format("cannot take logical disjunction of non-boolean value {}", to_string(stack.back(), env)));
+		}
+		GYNJO_NEXT();
+
+	op_jump:
+		GYNJO_JUMP();
+
+	op_jump_unless:
+		if (!stack.back().is<tok::boolean>()) {
+			return fail(fmt::format("expected boolean in conditional test, found {}", to_string(stack.back(), env)));
+		}
+		if (!pop().as<tok::boolean>().value) { GYNJO_JUMP(); }
+		GYNJO_NEXT();
+
+	op_jump_unless_while:
+		if (!stack.back().is<tok::boolean>()) {
+			return fail("while-loop test value must be boolean, found " + to_string(stack.back(), env));
+		}
+		if (!pop().as<tok::boolean>().value) { GYNJO_JUMP(); }
+		GYNJO_NEXT();
+
+	op_for_begin:
+		if (stack.back().is<val::empty>()) {
+			stack.pop_back();
+			GYNJO_JUMP();
+		}
+		if (!stack.back().is<val::list>()) {
+			return fail(fmt::format("expected a list, found {}", to_string(stack.back(), env)));
+		}
+		GYNJO_NEXT();
+
+	op_for_next:
+		if (!stack.back().is<val::list>()) {
+			// End of the range.
+			stack.pop_back();
+			GYNJO_JUMP();
+		}
+		{
+			auto head = stack.back().as<val::list>().head;
+			stack.back() = stack.back().as<val::list>().tail;
+			stack.push_back(std::move(head));
+		}
+		GYNJO_NEXT();
+
+	op_discard_unit:
+		// Expression statements must evaluate to nothing.
+		if (stack.back() != val::value{val::make_tup()}) {
+			return fail("unused expression result: " + to_string(stack.back(), env));
+		}
+		stack.pop_back();
+		GYNJO_NEXT();
+
+	op_import: {
+		auto const result = import_module(env, tree->literal(ip->arg));
+		if (!result.has_value()) { return fail(result.error()); }
+	}
+		GYNJO_NEXT();
+
+	op_ret_outside_block:
+		return fail("cannot return outside statement block");
+
+	op_eval_stmt:
+		return fail("cannot evaluate imperative statement: " + to_string(stmt{tree, ip->arg}));
+
+	op_end:
+		if (callers.size() == caller_base) {
+			auto result = pop();
+			stack.resize(base);
+			return result;
+		}
+		{
+			// Return to the innermost suspended call, whose cluster continues with the result.
+			auto& caller = callers.back();
+			env = std::move(caller.env);
+			code = caller.code;
+			tree = code->tree;
+			begin = code->code.data();
+			ip = caller.ip;
+			code_owner = std::move(caller.code_owner);
+			callers.pop_back();
+			clusters.back().resume(pop());
+		}
+		goto advance_cluster;
+
+#undef GYNJO_JUMP
+#undef GYNJO_NEXT
+#undef GYNJO_DISPATCH
+	}
+}
@@ -0,0 +1,14 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief The bytecode virtual machine.
+
+#pragma once
+
+#include "bytecode.hpp"
+#include "interpreter.hpp"
+
+namespace gynjo {
+	//! If possible, runs @p code in the context of @p env.
+	//! @return The value @p code leaves on top of the stack, or an error message.
+	auto run(env_ptr const& env, chunk const& code) -> eval_result;
+}
@@ -0,0 +1,77 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "allocations.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace gynjo::test {
+	namespace {
+		std::atomic<std::size_t> count = 0;
+		std::atomic<std::size_t> bytes = 0;
+		std::atomic<std::size_t> live = 0;
+		std::atomic<std::size_t> peak = 0;
+
+		//! Each allocation is preceded by its size, in a prefix that keeps the allocation suitably aligned.
+		constexpr std::size_t prefix_size = alignof(std::max_align_t);
+
+		auto record_allocation(std::size_t size) -> void {
+			count.fetch_add(1, std::memory_order_relaxed);
+			bytes.fetch_add(size, std::memory_order_relaxed);
+			auto const now = live.fetch_add(size, std::memory_order_relaxed) + size;
+			auto old_peak = peak.load(std::memory_order_relaxed);
+			while (old_peak < now && !peak.compare_exchange_weak(old_peak, now, std::memory_order_relaxed)) {}
+		}
+	}
+
+	auto allocation_count() -> std::size_t {
+		return count.load(std::memory_order_relaxed);
+	}
+
+	auto allocated_bytes() -> std::size_t {
+		return bytes.load(std::memory_order_relaxed);
+	}
+
+	auto live_bytes() -> std::size_t {
+		return live.load(std::memory_order_relaxed);
+	}
+
+	auto peak_bytes() -> std::size_t {
+		return peak.load(std::memory_order_relaxed);
+	}
+
+	auto reset_peak_bytes() -> void {
+		peak.store(live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+}
+
+#ifdef _DEBUG
+// Replace the global allocation functions in test builds only. The array and nothrow forms forward to these.
+
+auto operator new(std::size_t size) -> void* {
+	using gynjo::test::prefix_size;
+	auto const block = static_cast<char*>(std::malloc(prefix_size + size));
+	if (block == nullptr) { throw std::bad_alloc{}; }
+	std::memcpy(block, &size, sizeof(size));
+	gynjo::test::record_allocation(size);
+	return block + prefix_size;
+}
+
+auto operator delete(void* ptr) noexcept -> void {
+	using gynjo::test::prefix_size;
+	if (ptr == nullptr) { return; }
+	auto const block = static_cast<char*>(ptr) - prefix_size;
+	std::size_t size;
+	std::memcpy(&size, block, sizeof(size));
+	gynjo::test::live.fetch_sub(size, std::memory_order_relaxed);
+	std::free(block);
+}
+
+auto operator delete(void* ptr, std::size_t) noexcept -> void {
+	operator delete(ptr);
+}
+#endif
@@ -0,0 +1,24 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief Global allocation counting for tests and benchmarks.
+
+#pragma once
+
+#include <cstddef>
+
+namespace gynjo::test {
+	//! The number of calls to the global allocation functions so far. Always zero in release builds.
+	auto allocation_count() -> std::size_t;
+
+	//! The total number of bytes requested from the global allocation functions so far. Always zero in release builds.
+	auto allocated_bytes() -> std::size_t;
+
+	//! The number of bytes allocated by the global allocation functions and not yet freed. Always zero in release builds.
+	auto live_bytes() -> std::size_t;
+
+	//! The most live bytes at any point since the last call to reset_peak_bytes. Always zero in release builds.
+	auto peak_bytes() -> std::size_t;
+
+	//! Restarts tracking of the peak from the current number of live bytes.
+	auto reset_peak_bytes() -> void;
+}
@@ -0,0 +1,41 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "combinatorics.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <vector>
+
+TEST_SUITE("combinatorics") {
+	using namespace gynjo;
+	using val::big_int;
+
+	TEST_CASE("factorials are products of the natural numbers") {
+		big_int product = 1;
+		for (std::uint64_t n = 0; n <= 300; ++n) {
+			if (n > 0) { product *= n; }
+			INFO("n: ", n);
+			CHECK(val::factorial(n) == product);
+		}
+	}
+
+	TEST_CASE("binomial coefficients are the entries of Pascal's triangle") {
+		std::vector<big_int> row{1};
+		for (std::uint64_t n = 0; n <= 120; ++n) {
+			for (std::uint64_t k = 0; k <= n + 1; ++k) {
+				INFO("n: ", n, ", k: ", k);
+				CHECK(val::binomial(n, k) == (k <= n ? row[k] : big_int{0}));
+			}
+			std::vector<big_int> next(n + 2, 1);
+			for (std::size_t k = 1; k <= n; ++k) {
+				next[k] = row[k - 1] + row[k];
+			}
+			row = std::move(next);
+		}
+	}
+}
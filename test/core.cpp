@@ -23,6 +23,10 @@ TEST_SUITE("core libraries") {
 		auto env = environment::make_with_core_libs();
 		SUBCASE("factorial") {
 			CHECK(val::value{val::num{120}} == eval(env, "fact 5").value());
+			CHECK(val::value{val::num{1}} == eval(env, "fact 0").value());
+			// Other than natural numbers, the product continues down while the factors are greater than 1.
+			CHECK(val::value{val::num{"3.75"}} == eval(env, "fact 2.5").value());
+			CHECK(!eval(env, "fact \"5\"").has_value());
 		}
 		SUBCASE("permutations") {
 			CHECK(val::value{val::num{60}} == eval(env, "nPk(5, 3)").value());
@@ -30,6 +34,30 @@ TEST_SUITE("core libraries") {
 		SUBCASE("combinations") {
 			// Using an epsilon here because of the division.
 			CHECK(val::value{tok::boolean{true}} == eval(env, "abs(nCk(5, 3) - 10) < 10**-50").value());
+			CHECK(val::value{val::num{10}} == eval(env, "nCk(5, 3)").value());
+			CHECK(val::value{val::num{0}} == eval(env, "nCk(3, 5)").value());
+			// Other than natural numbers n, the falling factorial over k!.
+			CHECK(val::value{val::num{"1.875"}} == eval(env, "nCk(2.5, 2)").value());
+			CHECK(!eval(env, "nCk(5, 1.5)").has_value());
+		}
+		SUBCASE("native functions are ordinary variables") {
+			// A scope of its own, so the rebinding doesn't leak into the shared core environment.
+			auto const local_env = std::make_shared<environment>(env);
+			CHECK("fact" == val::to_string(eval(local_env, "fact").value(), local_env));
+			CHECK(exec(local_env, "let fact = 3 let nCk_x = 2").has_value());
+			CHECK(val::value{val::num{6}} == eval(local_env, "fact nCk_x").value());
+			CHECK(val::value{val::num{120}} == eval(env, "fact 5").value());
+		}
+		SUBCASE("exact numbers") {
+			auto const exact_numbers = val::exact_numbers_enabled();
+			val::set_exact_numbers(true);
+			auto const factorial = eval(env, "fact 30 = 265252859812191058636308480000000");
+			auto const binomial = eval(env, "nCk(100, 50) = 100891344545564193334812497256");
+			auto const permutations = eval(env, "nPk(30, 28) = fact 30 / 2");
+			val::set_exact_numbers(exact_numbers);
+			CHECK(val::value{tok::boolean{true}} == factorial.value());
+			CHECK(val::value{tok::boolean{true}} == binomial.value());
+			CHECK(val::value{tok::boolean{true}} == permutations.value());
 		}
 	}
 	TEST_CASE("list operations") {
@@ -0,0 +1,148 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "allocations.hpp"
+
+#include "environment.hpp"
+#include "interpreter.hpp"
+#include "symbol_map.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_SUITE("environment") {
+	using namespace gynjo;
+
+	TEST_CASE("symbol map") {
+		symbol_map<int> map;
+		CHECK(map.empty());
+		CHECK(map.find("a") == nullptr);
+		SUBCASE("insertion and assignment") {
+			CHECK(1 == map.try_emplace("a", 1));
+			CHECK(1 == map.try_emplace("a", 2));
+			CHECK(3 == map.insert_or_assign("a", 3));
+			map["b"] = 4;
+			CHECK(2 == map.size());
+			CHECK(3 == *map.find("a"));
+			CHECK(4 == *map.find("b"));
+			CHECK(map.find("c") == nullptr);
+		}
+		SUBCASE("growth keeps every entry") {
+			for (int i = 0; i < 1000; ++i) {
+				map.insert_or_assign(interned{"var" + std::to_string(i)}, i);
+			}
+			CHECK(1000 == map.size());
+			bool all_found = true;
+			for (int i = 0; i < 1000; ++i) {
+				auto const value = map.find(interned{"var" + std::to_string(i)});
+				all_found = all_found && value != nullptr && *value == i;
+			}
+			CHECK(all_found);
+		}
+		SUBCASE("clear") {
+			map["a"] = 1;
+			map.clear();
+			CHECK(map.empty());
+			CHECK(map.find("a") == nullptr);
+		}
+	}
+
+	TEST_CASE("lookup searches enclosing environments") {
+		auto const parent = environment::make_empty();
+		auto const child = std::make_shared<environment>(parent);
+		parent->local_vars["x"] = val::num{1};
+		parent->local_vars["y"] = val::num{2};
+		child->local_vars["y"] = val::num{3};
+		CHECK(val::value{val::num{1}} == *child->lookup("x"));
+		CHECK(val::value{val::num{3}} == *child->lookup("y"));
+		CHECK(child->lookup("z") == nullptr);
+	}
+
+	TEST_CASE("lookup doesn't allocate") {
+		auto const env = environment::make_empty();
+		for (int i = 0; i < 100; ++i) {
+			env->local_vars[interned{"var" + std::to_string(i)}] = val::num{i};
+		}
+		interned const name{"var42"};
+		auto const before = test::allocation_count();
+		auto const value = env->lookup(name);
+		CHECK(before == test::allocation_count());
+		CHECK(val::value{val::num{42}} == *value);
+	}
+
+	TEST_CASE("variables aren't copied needlessly") {
+		auto const env = environment::make_empty();
+		// Much bigger than anything else the code below allocates, so a single copy would show.
+		constexpr std::size_t size = 100'000;
+		env->local_vars["s"] = std::string(size, 's');
+		SUBCASE("assignment in a loop") {
+			env->local_vars["x"] = val::num{0};
+			auto const before = test::allocated_bytes();
+			REQUIRE(exec(env, "let i = 0 while i < 100 do { let x = x + 1 let i = i + 1 };").has_value());
+			CHECK(test::allocated_bytes() - before < size);
+			CHECK(val::value{val::num{100}} == *env->lookup("x"));
+		}
+		SUBCASE("variable operands are read in place") {
+			auto const before = test::allocated_bytes();
+			CHECK(val::value{tok::boolean{false}} == eval(env, "\"s\" = s").value());
+			CHECK(test::allocated_bytes() - before < size);
+		}
+		SUBCASE("arguments are moved into frames") {
+			// The argument is copied out of s once, into the argument tuple.
+			REQUIRE(exec(env, "let f = t -> 0").has_value());
+			auto const before = test::allocated_bytes();
+			CHECK(val::value{val::num{0}} == eval(env, "f(s)").value());
+			CHECK(test::allocated_bytes() - before < 2 * size);
+		}
+	}
+
+	TEST_CASE("boxed strings are read in place") {
+		val::value const boxed = std::string(1'000, 's');
+		val::value const short_string = std::string{"s"};
+		std::string storage;
+		auto const before = test::allocation_count();
+		CHECK(&boxed.as(storage) != &storage);
+		CHECK(before == test::allocation_count());
+		CHECK(&short_string.as(storage) == &storage);
+		CHECK(storage == "s");
+	}
+
+	TEST_CASE("each thread has its own core environment") {
+		auto const env = environment::make_with_core_libs();
+		CHECK(env == environment::make_with_core_libs());
+		std::array<env_ptr, 2> thread_envs;
+		std::array<eval_result, 2> results;
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0; t < thread_envs.size(); ++t) {
+			threads.emplace_back([t, &thread_envs, &results] {
+				thread_envs[t] = environment::make_with_core_libs();
+				results[t] = eval(thread_envs[t], "reduce(map([1, 2, 3], x -> x^2), 0, (a, b) -> a + b)");
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		for (std::size_t t = 0; t < thread_envs.size(); ++t) {
+			CHECK(thread_envs[t] != env);
+			CHECK(val::value{val::num{14}} == results[t].value());
+		}
+		CHECK(thread_envs[0] != thread_envs[1]);
+	}
+
+	TEST_CASE("precision is looked up dynamically") {
+		auto const env = environment::make_empty();
+		REQUIRE(exec(env, "let precision = 3").has_value());
+		CHECK("0.333" == val::to_string(eval(env, "1/3").value(), env));
+		auto const child = std::make_shared<environment>(env);
+		child->local_vars["precision"] = val::num{5};
+		CHECK("0.33333" == val::to_string(eval(env, "1/3").value(), child));
+		CHECK(val::value{tok::boolean{true}} == eval(env, "(() -> { let precision = 2 return 1/3 ~ 0.33 })()").value());
+	}
+}
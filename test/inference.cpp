@@ -0,0 +1,125 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "inference.hpp"
+#include "interpreter.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <string>
+
+namespace {
+	using namespace gynjo;
+
+	//! Parses @p input as an expression in @p tree and resolves its clusters where possible.
+	auto parse_resolved(ast& tree, std::string const& input) -> expr {
+		auto const tokens = lex(input).value();
+		auto const parse_result = parse_expr(tree, tokens.begin(), tokens.end());
+		REQUIRE(parse_result.has_value());
+		resolve_clusters(tree);
+		return parse_result.value().expr;
+	}
+
+	//! @p input as a string, after resolving its clusters.
+	auto resolved(std::string const& input) -> std::string {
+		auto const tree = ast::make();
+		return to_string(parse_resolved(*tree, input), print_form::evaluated);
+	}
+
+	//! @p input as a string, as written.
+	auto written(std::string const& input) -> std::string {
+		auto const tokens = lex(input).value();
+		auto const tree = ast::make();
+		auto const parse_result = parse_expr(*tree, tokens.begin(), tokens.end());
+		REQUIRE(parse_result.has_value());
+		return to_string(parse_result.value().expr);
+	}
+
+	//! Whether the cluster @p input is resolved.
+	auto resolves(std::string const& input) -> bool {
+		auto const tree = ast::make();
+		return parse_resolved(*tree, input).kind() != node_kind::cluster;
+	}
+}
+
+TEST_SUITE("inference") {
+	TEST_CASE("clusters are resolved when no item can be applied") {
+		CHECK(resolved("2^3*3^2") == "((2 ^ 3) * (3 ^ 2))");
+		CHECK(resolved("2 x / 3 y") == "(((2 * x) / 3) * y)");
+		CHECK(resolved("-2^-3^2") == "(-(2 ^ (-(3 ^ 2))))");
+		CHECK(resolved("2 * 3 * -4") == "((2 * 3) * (-4))");
+		CHECK(resolved("(1, 2)(3)") == "((1, 2) * 3)");
+		CHECK(resolved("x^2 y") == "((x ^ 2) * y)");
+		CHECK(resolved("x -> 2x") == "((x) -> (2 * x))");
+		// Clusters nested in resolved items are resolved too.
+		CHECK(resolved("2(3 4)^2") == "(2 * ((3 * 4) ^ 2))");
+	}
+
+	TEST_CASE("clusters that might make calls are left alone") {
+		// Any symbol could name a function.
+		CHECK(!resolves("f x"));
+		CHECK(!resolves("2 f(x)"));
+		CHECK(!resolves("x y^2"));
+		CHECK(!resolves("(x -> x)(1)"));
+		// Items that might have side effects make it unsafe to interleave their evaluation with the operations.
+		CHECK(!resolves("2 { return 3 }"));
+		CHECK(!resolves("2 (f x)"));
+	}
+
+	TEST_CASE("clusters longer than the nesting limit are left for evaluation") {
+		std::string input;
+		for (int i = 0; i < 20'000; ++i) {
+			input += "1 ";
+		}
+		CHECK(!resolves(input));
+		auto const original_engine = current_engine();
+		for (auto const e : {engine::tree_walker, engine::vm}) {
+			set_engine(e);
+			auto const env = environment::make_empty();
+			CHECK(val::value{val::num{1}} == eval(env, input).value());
+		}
+		set_engine(original_engine);
+	}
+
+	TEST_CASE("resolved clusters evaluate like clusters") {
+		auto const original_engine = current_engine();
+		auto const original_inference = inference_enabled();
+		for (auto const e : {engine::tree_walker, engine::vm}) {
+			set_engine(e);
+			for (char const* input : {"2^3*3^2",
+					 "-2^-3^2",
+					 "2 * 3 * -4",
+					 "12 / 2 3",
+					 "2 [1, 2] 3",
+					 "(x -> 2x^2)(3)",
+					 "let x = 4 return 2x / -x^(1/2)",
+					 "2 * \"s\"",
+					 "1 / 0",
+					 "-(1, 2)",
+					 "3 (x -> x)"}) {
+				INFO("input: ", input);
+				auto const env = environment::make_empty();
+				set_inference(false);
+				auto const expected = interpret(env, input);
+				set_inference(true);
+				auto const actual = interpret(env, input);
+				CHECK(expected == actual);
+			}
+		}
+		set_engine(original_engine);
+		set_inference(original_inference);
+	}
+
+	TEST_CASE("resolved clusters print as written") {
+		for (auto const input : {"c -> 9/5c + 32", "2 x / 3 y", "-2^-3^2", "(1, 2)[1]"}) {
+			INFO("input: ", input);
+			auto const tree = ast::make();
+			CHECK(to_string(parse_resolved(*tree, input)) == written(input));
+		}
+	}
+}
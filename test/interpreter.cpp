@@ -3,11 +3,16 @@
 
 #include "interpreter.hpp"
 
+#include "allocations.hpp"
+
 #ifndef _DEBUG
 #define DOCTEST_CONFIG_DISABLE
 #endif
 #include <doctest/doctest.h>
 
+#include <fmt/format.h>
+
+#include <fstream>
 #include <sstream>
 
 TEST_SUITE("interpreter") {
@@ -289,6 +294,29 @@ TEST_SUITE("interpreter") {
 			auto const actual = eval(env, "4inc 2^2");
 			CHECK(expected == actual.value());
 		}
+		SUBCASE("exponentiations separated by other operations") {
+			CHECK(val::value{val::num{72}} == eval(env, "2^3*3^2").value());
+			CHECK(val::value{val::num{72}} == eval(env, "2^3 3^2").value());
+		}
+		SUBCASE("negation of later factors") {
+			CHECK(val::value{val::num{-24}} == eval(env, "2*3*-4").value());
+			CHECK(val::value{val::num{-24}} == eval(env, "2*-3*4").value());
+			CHECK(val::value{val::num{-18}} == eval(env, "2*-3^2").value());
+		}
+	}
+
+	TEST_CASE("clusters are evaluated consistently as their items' types change") {
+		auto env = environment::make_empty();
+		// The same cluster is a double application or a multiplication, depending on what g returns.
+		exec(env, "let g = n -> n = 0 ? (x -> 2x) : n");
+		exec(env, "let h = n -> g(n)(7)");
+		auto const expected = val::make_tup(val::num{14}, val::num{21}, val::num{14}, val::num{35});
+		CHECK(val::value{expected} == eval(env, "(h 0, h 3, h 0, h 5)").value());
+		// Here the items' types change from the start.
+		exec(env, "let k = (f, x) -> f x");
+		CHECK(val::value{val::num{6}} == eval(env, "k(2, 3)").value());
+		CHECK(val::value{val::num{4}} == eval(env, "k(x -> x + 1, 3)").value());
+		CHECK(val::value{val::num{10}} == eval(env, "k(5, 2)").value());
 	}
 
 	TEST_CASE("higher-order functions") {
@@ -340,6 +368,126 @@ TEST_SUITE("interpreter") {
 		CHECK(expected == actual.value());
 	}
 
+	TEST_CASE("tail calls run in constant stack space") {
+		auto env = environment::make_empty();
+		// Each of these would overflow the stack if every call nested.
+		constexpr int n = 1'000'000;
+		val::value const expected = val::num{n};
+		SUBCASE("in a conditional branch") {
+			exec(env, "let count = (n, acc) -> n = 0 ? acc : count(n - 1, acc + 1)");
+			CHECK(expected == eval(env, fmt::format("count({}, 0)", n)).value());
+		}
+		SUBCASE("in a block's return statement") {
+			exec(env, "let count = (n, acc) -> { let next = acc + 1 return n = 0 ? acc : count(n - 1, next) }");
+			CHECK(expected == eval(env, fmt::format("count({}, 0)", n)).value());
+		}
+		SUBCASE("between mutually recursive functions") {
+			exec(env, R"(
+				let even = (n, count) -> n = 0 ? count : odd(n - 1, count + 1)
+				let odd = (n, count) -> n = 0 ? count : even(n - 1, count + 1)
+				)");
+			CHECK(expected == eval(env, fmt::format("even({}, 0)", n)).value());
+		}
+	}
+
+	TEST_CASE("calls not in tail position") {
+		auto env = environment::make_empty();
+		SUBCASE("negated call") {
+			exec(env, "let f = n -> n = 0 ? 1 : -f(n - 1)");
+			CHECK(val::value{val::num{-1}} == eval(env, "f 3").value());
+		}
+		SUBCASE("call followed by multiplication") {
+			exec(env, "let f = n -> n = 0 ? 1 : f(n - 1) 2");
+			CHECK(val::value{val::num{8}} == eval(env, "f 3").value());
+		}
+		SUBCASE("call in a block statement") {
+			exec(env, "let f = n -> { let m = n = 0 ? 0 : f(n - 1) return m + 1 }");
+			CHECK(val::value{val::num{4}} == eval(env, "f 3").value());
+		}
+	}
+
+	TEST_CASE("deep recursion") {
+		auto env = environment::make_empty();
+		exec(env, "let f = n -> n = 0 ? 0 : 1 + f(n - 1)");
+		auto const original_engine = current_engine();
+		auto const original_depth = max_depth();
+		SUBCASE("doesn't overflow the VM's stack") {
+			set_engine(engine::vm);
+			CHECK(val::value{val::num{50'000}} == eval(env, "f 50000").value());
+		}
+		SUBCASE("goes beyond a thousand calls in either engine") {
+			auto const core_env = environment::make_with_core_libs();
+			for (auto const e : {engine::tree_walker, engine::vm}) {
+				set_engine(e);
+				CHECK(val::value{val::num{1'500}} == eval(env, "f 1500").value());
+				CHECK(val::value{val::num{1'501}} == eval(core_env, "len(concat(range(1, 1500), [1]))").value());
+			}
+		}
+		SUBCASE("stops the tree walker with an error when the native stack runs low") {
+			set_engine(engine::tree_walker);
+			set_max_depth(1'000'000);
+			// Each result is either correct or an error, around and far beyond where the stack runs out.
+			auto const core_env = environment::make_with_core_libs();
+			for (int const n : {3'000, 3'300, 3'600, 5'000, 100'000}) {
+				INFO("n = ", n);
+				auto const result = eval(core_env, fmt::format("len(concat(range(1, {}), [1]))", n));
+				if (result.has_value()) {
+					CHECK(val::value{val::num{n + 1}} == result.value());
+				} else {
+					CHECK(result.error().find("out of stack space") != std::string::npos);
+				}
+			}
+			auto const local_env = std::make_shared<environment>(core_env);
+			exec(local_env, "let rec = n -> n = 0 ? [] : push(rec(n - 1), n)");
+			auto const pushed = eval(local_env, "len(rec 3500)");
+			CHECK((pushed.has_value() ? pushed.value() == val::value{val::num{3'500}}
+									  : pushed.error().find("out of stack space") != std::string::npos));
+			// Beyond what any default stack holds, so the stack runs out before the maximum depth.
+			auto const result = eval(env, "f 1000000");
+			REQUIRE(!result.has_value());
+			CHECK(result.error().find("out of stack space") != std::string::npos);
+		}
+		SUBCASE("reports exceeding the maximum depth") {
+			set_max_depth(100);
+			for (auto const e : {engine::tree_walker, engine::vm}) {
+				set_engine(e);
+				CHECK(val::value{val::num{99}} == eval(env, "f 99").value());
+				auto const result = eval(env, "f 100");
+				REQUIRE(!result.has_value());
+				CHECK(result.error().find("maximum call depth of 100 exceeded") != std::string::npos);
+			}
+		}
+		set_engine(original_engine);
+		set_max_depth(original_depth);
+	}
+
+	TEST_CASE("operations on long lists don't recurse") {
+		auto env = environment::make_empty();
+		constexpr int n = 300'000;
+		val::value l = val::empty{};
+		for (int i = 0; i < n; ++i) {
+			l = val::list{val::num{i}, std::move(l)};
+		}
+		env->local_vars["l"] = l;
+		CHECK(val::value{tok::boolean{true}} == eval(env, "l = l").value());
+		CHECK(val::value{tok::boolean{true}} == eval(env, "(l + 1) - 1 = l").value());
+		CHECK(val::value{tok::boolean{false}} == eval(env, "l + 1 = l").value());
+	}
+
+	TEST_CASE("closures keep their code alive") {
+		auto env = environment::make_empty();
+		exec(env, "let inc = a -> a + 1");
+		std::weak_ptr<ast const> const code = env->lookup("inc")->as<val::closure>().code;
+		// The tree containing the statement outlives the statement's execution.
+		CHECK(!code.expired());
+		val::value const expected = val::num{2};
+		auto const actual = eval(env, "inc 1");
+		CHECK(expected == actual.value());
+		// It's freed along with the last closure that refers to it.
+		env->local_vars.clear();
+		CHECK(code.expired());
+	}
+
 	TEST_CASE("importing core constants") {
 		auto env = environment::make_empty();
 		val::value const expected = val::num{
@@ -418,4 +566,155 @@ TEST_SUITE("interpreter") {
 		CHECK(result.has_value());
 		CHECK("\"test\"\n" == sout.str());
 	}
+
+	TEST_CASE("interpretation of REPL lines") {
+		auto env = environment::make_empty();
+		SUBCASE("expressions produce values") {
+			CHECK(std::optional<val::value>{val::num{"3"}} == interpret(env, "1 + 2").value());
+		}
+		SUBCASE("statements produce nothing") {
+			CHECK(std::nullopt == interpret(env, "let x = 5").value());
+			CHECK(val::value{val::num{"5"}} == eval(env, "x").value());
+		}
+		SUBCASE("expression statement followed by more statements") {
+			CHECK(std::nullopt == interpret(env, "{ let a = 1 }; let b = 2 let c = b + 1").value());
+			CHECK(val::value{val::num{"3"}} == eval(env, "c").value());
+		}
+		SUBCASE("errors are reported once") {
+			CHECK("(lex error) unrecognized token: '#'" == interpret(env, "#").error());
+			CHECK("(parse error) expected term" == interpret(env, "1 +").error());
+			CHECK("division by zero" == interpret(env, "1/0").error());
+			CHECK("(runtime error) unused expression result: 1" == interpret(env, "1;").error());
+		}
+		SUBCASE("statements before an error take effect") {
+			CHECK(!interpret(env, "let a = 1 let b =").has_value());
+			CHECK(val::value{val::num{"1"}} == eval(env, "a").value());
+		}
+	}
+
+	TEST_CASE("chunked execution matches whole-input execution") {
+		// Scripts paired with an expression to evaluate afterward.
+		std::vector<std::pair<std::string, std::string>> const cases = {
+			{"", "1"},
+			{"let x = 42", "x"},
+			{"let f = x -> y -> x + y let g = f 1", "g 2"},
+			{"{ let a = 0 } let b = { let a = a + 1 return a }", "b"},
+			{"if false then let a = 1/0 else let a = 1", "a"},
+			{"let a = 0\nwhile a < 3 do let a = a + 1", "a"},
+			{"let a = 0 for x in [1, 2, 3] do let a = a + x for x in [] do let a = 10", "a"},
+			{"let l = [1, 2, 3] let s = \"a \\\"quoted\\\" string\" // comment\nlet t = (l, s)", "t"},
+			{"let x = 1.5 let y = .25 let z = x ** 2 ^ y", "z"},
+			{"import \"core/constants.gynj\"", "PI"},
+			{"let x = # let y = 1", "y"},
+			{"let x = 1 let y = (x, ", "x"},
+			{"let x = 1 let s = \"unterminated", "x"},
+			{"let x = 1 let y = 1/0 let z = 2", "z"},
+			{"let f = x -> ", "f 1"},
+			{"let f = x -> x let g = f [1, 2", "g 5"},
+		};
+		for (std::size_t const chunk_size : {1, 7, 4096}) {
+			for (auto const& [script, probe] : cases) {
+				INFO("chunk size: ", chunk_size, ", script: ", script);
+				auto whole_env = environment::make_empty();
+				auto const expected = exec(whole_env, script);
+				auto chunked_env = environment::make_empty();
+				std::istringstream input{script};
+				auto const actual = exec(chunked_env, input, chunk_size);
+				CHECK(expected == actual);
+				CHECK(eval(whole_env, probe) == eval(chunked_env, probe));
+			}
+		}
+	}
+
+	TEST_CASE("chunked execution holds memory bounded by the largest statement") {
+		// The peak number of bytes allocated at once while streaming a script of @p line_count statements, each with
+		// distinct literals, as in a data file.
+		auto const peak_bytes = [](int line_count) {
+			std::string script;
+			for (int i = 0; i < line_count; ++i) {
+				script += fmt::format("let a = {} + 1\n", 1'000'000 + i);
+			}
+			std::istringstream input{script};
+			auto env = environment::make_empty();
+			auto const before = test::live_bytes();
+			test::reset_peak_bytes();
+			REQUIRE(exec(env, input).has_value());
+			return test::peak_bytes() - before;
+		};
+		auto const small = peak_bytes(2'000);
+		auto const large = peak_bytes(20'000);
+		INFO("peak bytes for 2k statements: ", small, ", for 20k statements: ", large);
+		CHECK(large < 2 * small);
+	}
+
+	TEST_CASE("tree walker and VM agree") {
+		// Scripts paired with an expression to evaluate afterward. Errors must match too, including their context.
+		std::vector<std::pair<std::string, std::string>> const cases = {
+			{"let x = 42", "x"},
+			{"let f = x -> y -> x + y let g = f 1", "g 2"},
+			{"let fib = n -> n <= 1 ? n : fib(n - 1) + fib(n - 2)", "fib 10"},
+			{"let f = n -> { let i = 0 while i < n do let i = i + 1 return i }", "f 5"},
+			{"let a = 0 for x in [1, 2, 3] do let a = a + x for x in [] do let a = 10", "a"},
+			{"let l = [1, 2, 3]", "(l, [], \"s\", true and not false, false or 1 < 2)"},
+			{"let x = 2", "-x^2 (x)3/4 - 2x"},
+			{"import \"core/constants.gynj\"", "PI"},
+			{"let a = 0", "{ let a = a + 1 }"},
+			{"let a = 1 let f = () -> { let a = a + 1 return a }", "(f(), a)"},
+			{"let f = x -> { let g = () -> x + y let y = 10 return g() }", "f 1"},
+			{"let f = () -> { let g = () -> a let a = 1 return g } let g = f()", "g()"},
+			{"let f = x -> () -> x let g = f 1 let x = 5", "g()"},
+			{"let f = () -> 1 let g = () -> f() let f = () -> 2", "g()"},
+			{"let f = (a, a) -> a", "f(1, 2)"},
+			{"let f = l -> { let s = 0 for x in l do let s = s + x return s }", "f [1, 2, 3]"},
+			{"let f = () -> { let precision = 3 return 1/3 ~ 0.333 }", "f()"},
+			{"let a = 1/0", "a"},
+			{"let a = { let b = 1/0 }", "{ while 1 do let a = 1 }"},
+			{"if 1 then let a = 1", "{ { 1; }; }"},
+			{"for x in 1 do let a = 1", "{ for x in [1] do let a = 1/x - 2/0 }"},
+			{"return 1", "(1, 2) + 1"},
+			{"let f = (a, b) -> a", "f 1"},
+			{"let a = 1", "true and a"},
+			{"let a = b", "false or ()"},
+			{"let f = (n, acc) -> n = 0 ? acc : f(n - 1, acc + n)", "f(10, 0)"},
+			{"let f = n -> n = 0 ? 1/0 : f(n - 1)", "f 3"},
+			{"let g = (a, b) -> a let f = n -> { let m = n return g m }", "f 1"},
+			{"let f = n -> n = 0 ? 1 : -f(n - 1)", "f 3"},
+			{"let f = n -> { let g = m -> m = 0 ? n : g(m - 1) return g n }", "f 5"},
+			{"let f = n -> n = 0 ? 0 : 1 + f(n - 1)", "f 500"},
+			{"let x = 2", "2^3 x^2 -x 5/-x"},
+			{"let g = n -> n = 0 ? (x -> 2x) : n let h = n -> g(n)(7)", "(h 0, h 3, h 0)"},
+			{"let f = n -> n = 0 ? 1/0 : 2 f(n - 1)", "f 3"},
+		};
+		auto const original = current_engine();
+		for (auto const& [script, probe] : cases) {
+			INFO("script: ", script, ", probe: ", probe);
+			set_engine(engine::tree_walker);
+			auto tree_env = environment::make_empty();
+			auto const expected_exec = exec(tree_env, script);
+			auto const expected_eval = eval(tree_env, probe);
+			set_engine(engine::vm);
+			auto vm_env = environment::make_empty();
+			CHECK(expected_exec == exec(vm_env, script));
+			CHECK(expected_eval == eval(vm_env, probe));
+		}
+		set_engine(original);
+	}
+
+	TEST_CASE("chunked execution executes statements before a later lex error") {
+		auto env = environment::make_empty();
+		std::istringstream input{"let x = 1 let y = x #"};
+		CHECK(!exec(env, input, 1).has_value());
+		CHECK(val::value{val::num{"1"}} == eval(env, "x").value());
+	}
+
+	TEST_CASE("chunked execution of core libraries") {
+		auto env = environment::make_empty();
+		import_natives(env);
+		for (char const* const filename : {"core/constants.gynj", "core/core.gynj"}) {
+			std::ifstream input{filename};
+			REQUIRE(exec(env, input, 7).has_value());
+		}
+		CHECK(val::value{val::num{"120"}} == eval(env, "fact 5").value());
+		CHECK(val::value{val::num{"3"}} == eval(env, "len [1, 2, 3]").value());
+	}
 }
@@ -3,11 +3,39 @@
 
 #include "lexer.hpp"
 
+#include "regex_lexer.hpp"
+
 #ifndef _DEBUG
 #define DOCTEST_CONFIG_DISABLE
 #endif
 #include <doctest/doctest.h>
 
+#include <array>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace {
+	//! Random soups of fragments chosen to exercise token boundaries, reserved-word prefixes, and error paths.
+	auto generated_corpus() -> std::vector<std::string> {
+		constexpr std::array fragments{"0", "01", "1.5", ".5", "1.", "..", "42", "a", "_", "x_y", "if", "ifx", "if_",
+			"true", "true1", "falsey", "import", "in", "int", "print", "top_", "// comment\n", "//\r", "\"s\\\"t\"",
+			"\"\\\\\"", "\"bad\\q\"", "\"", "->", "-", ">", ">=", "<", "<=", "=", "==", "!=", "!", "*", "**", "***",
+			"^", "/", "~", "(", ")", "[", "]", "{", "}", ",", ";", "?", ":", "#", "@", "\xc3\xa9", " ", "  ", "\n", "\t", "\r", "\v"};
+		std::mt19937 gen{42};
+		std::uniform_int_distribution<std::size_t> fragment_dist{0, fragments.size() - 1};
+		std::uniform_int_distribution<int> length_dist{1, 24};
+		std::vector<std::string> result(2000);
+		for (auto& input : result) {
+			for (int length = length_dist(gen); length > 0; --length) {
+				input += fragments[fragment_dist(gen)];
+			}
+		}
+		return result;
+	}
+}
+
 TEST_SUITE("lexer") {
 	using namespace gynjo;
 	using namespace gynjo::tok;
@@ -95,10 +123,10 @@ TEST_SUITE("lexer") {
 
 	TEST_CASE("strings") {
 		SUBCASE("valid") {
-			CHECK(token{""} == lex(R"...("")...").value().front());
-			CHECK(token{"abc"} == lex(R"...("abc")...").value().front());
-			CHECK(token{R"...("abc")..."} == lex(R"...("\"abc\"")...").value().front());
-			CHECK(token{R"...(a\b\c)..."} == lex(R"...("a\\b\\c")...").value().front());
+			CHECK(token{str{""}} == lex(R"...("")...").value().front());
+			CHECK(token{str{"abc"}} == lex(R"...("abc")...").value().front());
+			CHECK(token{str{R"...("abc")..."}} == lex(R"...("\"abc\"")...").value().front());
+			CHECK(token{str{R"...(a\b\c)..."}} == lex(R"...("a\\b\\c")...").value().front());
 		}
 		SUBCASE("invalid") {
 			CHECK(!lex(R"...(")...").has_value());
@@ -107,4 +135,81 @@ TEST_SUITE("lexer") {
 			CHECK(!lex(R"...("\a")...").has_value());
 		}
 	}
+
+	TEST_CASE("threads can lex at the same time") {
+		// Each thread interns its own new symbols, growing the shared intern table while the others read it.
+		std::vector<std::thread> threads;
+		std::array<bool, 4> matched{};
+		for (std::size_t t = 0; t < matched.size(); ++t) {
+			threads.emplace_back([t, &matched] {
+				std::string input;
+				std::vector<token> expected;
+				for (int i = 0; i < 2'000; ++i) {
+					auto name = "thread" + std::string(t + 1, '_') + "sym" + std::string(i % 50 + 1, 'x');
+					name += std::string(i / 50 + 1, 'y');
+					input += name + " ";
+					expected.push_back(sym{name});
+				}
+				auto const actual = lex(input);
+				matched[t] = actual.has_value() && actual.value() == expected;
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		for (bool const m : matched) {
+			CHECK(m);
+		}
+	}
+
+	TEST_CASE("hand-written lexer matches the regex lexer") {
+		auto const check_same = [](std::string_view input) {
+			INFO(input);
+			CHECK(test::regex_lex(input) == lex(input));
+		};
+		SUBCASE("lexer test cases") {
+			check_same(" \t \n 1 \n + \t 2+3 \t \n ");
+			check_same("let=!=<<=>>=~*(+-->)[]^***/.1 0 0.1,?:");
+			check_same("1+2 // This is a line comment.");
+			check_same("import1 imports if1 ifs then1 thens else1 elses while1 whiles for1 fors in1 ins do1 dos");
+			check_same("return1 returns and1 ands or1 ors not1 nots");
+			for (auto const input : {R"...("")...", R"...("abc")...", R"...("\"abc\"")...", R"...("a\\b\\c")..."}) {
+				check_same(input);
+			}
+			for (auto const input : {R"...(")...", R"...(""")...", R"...("\")...", R"...("\a")..."}) {
+				check_same(input);
+			}
+		}
+		SUBCASE("core libraries") {
+			for (auto const filename : {"core/constants.gynj", "core/core.gynj"}) {
+				std::ifstream fin{filename};
+				std::stringstream ss;
+				ss << fin.rdbuf();
+				check_same(ss.str());
+			}
+		}
+		SUBCASE("generated corpus") {
+			for (auto const& input : generated_corpus()) {
+				check_same(input);
+			}
+		}
+	}
+
+	TEST_CASE("chunked lexer matches the whole-input lexer") {
+		auto const lex_chunked = [](std::string_view input, std::size_t chunk_size) -> lex_result {
+			chunked_lexer lexer;
+			std::vector<token> tokens;
+			for (std::size_t i = 0; i < input.size(); i += chunk_size) {
+				auto const fed = lexer.feed(input.substr(i, chunk_size), tokens);
+				if (!fed.has_value()) { return tl::unexpected{fed.error()}; }
+			}
+			return lexer.finish(tokens).map([&] { return std::move(tokens); });
+		};
+		for (auto const& input : generated_corpus()) {
+			for (std::size_t const chunk_size : {1, 2, 3, 7, 4096}) {
+				INFO("chunk size: ", chunk_size, ", input: ", input);
+				CHECK(lex(input) == lex_chunked(input, chunk_size));
+			}
+		}
+	}
 }
@@ -0,0 +1,151 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "interpreter.hpp"
+#include "lexer.hpp"
+#include "module_cache.hpp"
+#include "parser.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace {
+	using namespace gynjo;
+
+	//! A source file in the temporary directory, removed along with its cache on destruction.
+	struct temp_source {
+		std::filesystem::path path;
+
+		explicit temp_source(char const* name) : path{std::filesystem::temp_directory_path() / name} {
+			std::filesystem::remove(cache_path(path));
+		}
+
+		~temp_source() {
+			std::filesystem::remove(path);
+			std::filesystem::remove(cache_path(path));
+		}
+
+		auto write(std::string_view contents) const -> void {
+			std::ofstream{path} << contents;
+		}
+
+		//! Imports this file into a new environment and returns the value of @p expr there.
+		auto import_and_eval(char const* expr) const -> eval_result {
+			auto const env = environment::make_empty();
+			auto const import_result = exec(env, "import \"" + path.generic_string() + "\"");
+			if (!import_result.has_value()) { return tl::unexpected{import_result.error()}; }
+			return eval(env, expr);
+		}
+	};
+}
+
+TEST_SUITE("module cache") {
+	TEST_CASE("imports write a cache and later imports read it") {
+		temp_source const source{"gynjo_cache_hit.gynj"};
+		source.write("let f = x -> x + 1\nlet y = f(2)");
+		CHECK(val::value{val::num{3}} == source.import_and_eval("y").value());
+		REQUIRE(std::filesystem::exists(cache_path(source.path)));
+		auto const cache_mtime = std::filesystem::last_write_time(cache_path(source.path));
+		// A warm import gives the same result without rewriting the cache.
+		CHECK(val::value{val::num{3}} == source.import_and_eval("y").value());
+		CHECK(val::value{val::num{6}} == source.import_and_eval("f(5)").value());
+		CHECK(std::filesystem::last_write_time(cache_path(source.path)) == cache_mtime);
+		// The cache was renamed into place, leaving no temporary file behind.
+		auto const cache_name = cache_path(source.path).filename().string();
+		for (auto const& entry : std::filesystem::directory_iterator{source.path.parent_path()}) {
+			auto const name = entry.path().filename().string();
+			CHECK_FALSE((name.starts_with(cache_name) && name.ends_with(".tmp")));
+		}
+	}
+
+	TEST_CASE("edited sources invalidate the cache") {
+		temp_source const source{"gynjo_cache_edit.gynj"};
+		source.write("let y = 1");
+		CHECK(val::value{val::num{1}} == source.import_and_eval("y").value());
+		SUBCASE("different size") {
+			source.write("let y = 10");
+			CHECK(val::value{val::num{10}} == source.import_and_eval("y").value());
+		}
+		SUBCASE("same size and modification time") {
+			auto const mtime = std::filesystem::last_write_time(source.path);
+			source.write("let y = 2");
+			std::filesystem::last_write_time(source.path, mtime);
+			CHECK(val::value{val::num{2}} == source.import_and_eval("y").value());
+		}
+	}
+
+	TEST_CASE("corrupt caches are ignored") {
+		temp_source const source{"gynjo_cache_corrupt.gynj"};
+		source.write("let y = 1");
+		CHECK(val::value{val::num{1}} == source.import_and_eval("y").value());
+		{
+			std::fstream cache{cache_path(source.path), std::ios::in | std::ios::out | std::ios::binary};
+			cache.seekp(-1, std::ios::end);
+			cache.put('\x7f');
+		}
+		CHECK(val::value{val::num{1}} == source.import_and_eval("y").value());
+	}
+
+	TEST_CASE("trees with nodes out of range are rejected") {
+		auto const tree = ast::make();
+		auto const tokens = lex("let f = x -> (x + 1, [x])").value();
+		REQUIRE(parse_stmt(*tree, tokens.begin(), tokens.end()).has_value());
+		std::ostringstream out;
+		tree->write(out);
+		auto const bytes = std::move(out).str();
+		auto const read = [](std::string const& bytes) {
+			std::istringstream in{bytes};
+			return ast::read(in);
+		};
+		REQUIRE(read(bytes) != nullptr);
+		// The kinds and operands are each preceded by a 32-bit count, and the children follow them.
+		auto const node_count = tree->size();
+		auto const kinds_offset = sizeof(std::uint32_t);
+		auto const children_offset = 3 * sizeof(std::uint32_t) + node_count * (1 + sizeof(std::uint32_t));
+		SUBCASE("child") {
+			auto corrupt = bytes;
+			std::memset(corrupt.data() + children_offset, 0xff, sizeof(node_id));
+			CHECK(read(corrupt) == nullptr);
+		}
+		SUBCASE("kind") {
+			auto corrupt = bytes;
+			corrupt[kinds_offset] = '\xff';
+			CHECK(read(corrupt) == nullptr);
+		}
+	}
+
+	TEST_CASE("large sources are interpreted incrementally without a cache") {
+		temp_source const source{"gynjo_cache_large.gynj"};
+		std::string contents;
+		int last = 0;
+		for (; contents.size() <= max_cached_source_size; ++last) {
+			contents += "let y = " + std::to_string(last) + "\n";
+		}
+		source.write(contents);
+		CHECK(!load_module(source.path).has_value());
+		CHECK(val::value{val::num{last - 1}} == source.import_and_eval("y").value());
+		CHECK(!std::filesystem::exists(cache_path(source.path)));
+	}
+
+	TEST_CASE("sources that don't parse are interpreted as before") {
+		temp_source const source{"gynjo_cache_error.gynj"};
+		source.write("let y = 1\nlet z = (");
+		auto const env = environment::make_empty();
+		auto const result = exec(env, "import \"" + source.path.generic_string() + "\"");
+		REQUIRE(!result.has_value());
+		CHECK(result.error().find("(parse error)") != std::string::npos);
+		// Statements before the error still take effect.
+		CHECK(val::value{val::num{1}} == eval(env, "y").value());
+		CHECK(!std::filesystem::exists(cache_path(source.path)));
+	}
+}
@@ -0,0 +1,180 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "num.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace {
+	using namespace gynjo;
+	using val::decimal;
+	using val::num;
+
+	constexpr auto min = std::numeric_limits<std::int64_t>::min();
+	constexpr auto max = std::numeric_limits<std::int64_t>::max();
+
+	//! Whether the widest numbers of the numeric policy hold every machine integer exactly, which cases that compare
+	//! machine integers with them rely on.
+	constexpr bool exact_decimal_ints =
+		std::numeric_limits<decimal>::digits10 > std::numeric_limits<std::int64_t>::digits10;
+
+	//! Whether the numeric policy is the decimal one, for cases about decimal results.
+	constexpr bool decimal_policy = std::is_same_v<val::numbers, val::decimal_numbers>;
+
+	//! Whether the numeric policy has only doubles.
+	constexpr bool binary_policy = std::is_same_v<decimal, double>;
+
+	//! Integers around zero, the 32-bit limits, and the 64-bit limits, where machine integer operations overflow.
+	auto const samples = std::vector<std::int64_t>{
+		0, 1, -1, 2, -3, 7, 10, -12, 1000, (1LL << 31) - 1, -(1LL << 31), 1LL << 31, 3037000499, max - 1, max, min + 1, min};
+}
+
+TEST_SUITE("num") {
+	TEST_CASE("integer literals are machine integers") {
+		CHECK(num{"42"}.is_machine_int());
+		CHECK(num{"-9223372036854775808"}.is_machine_int());
+		CHECK(num{"2.0"}.is_machine_int());
+		CHECK(!num{"9223372036854775808"}.is_machine_int());
+		CHECK(!num{"0.5"}.is_machine_int());
+	}
+
+	TEST_CASE("machine integer results are the same as decimal results" * doctest::skip(!decimal_policy)) {
+		// With binary floats or exact numbers, inexact results of machine integers may be doubles or rationals.
+		auto const binary_floats = val::binary_floats_enabled();
+		auto const exact_numbers = val::exact_numbers_enabled();
+		val::set_binary_floats(false);
+		val::set_exact_numbers(false);
+		for (auto const a : samples) {
+			for (auto const b : samples) {
+				INFO("a: ", a, ", b: ", b);
+				decimal const x(a);
+				decimal const y(b);
+				CHECK((num{a} + num{b}).str() == num{decimal{x + y}}.str());
+				CHECK((num{a} - num{b}).str() == num{decimal{x - y}}.str());
+				CHECK((num{a} * num{b}).str() == num{decimal{x * y}}.str());
+				if (b != 0 && b != -1 && a % b != 0) { CHECK((num{a} / num{b}).str() == num{decimal{x / y}}.str()); }
+				CHECK((num{a} < num{b}) == (x < y));
+				CHECK((num{a} == num{b}) == (x == y));
+			}
+			CHECK((-num{a}).str() == num{decimal{-decimal(a)}}.str());
+		}
+		for (std::int64_t base = -20; base <= 20; ++base) {
+			for (std::int64_t exponent = -2; exponent <= 70; ++exponent) {
+				INFO("base: ", base, ", exponent: ", exponent);
+				CHECK(pow(num{base}, num{exponent}).str() == num{decimal{pow(decimal(base), decimal(exponent))}}.str());
+			}
+		}
+		val::set_binary_floats(binary_floats);
+		val::set_exact_numbers(exact_numbers);
+	}
+
+	TEST_CASE("division of machine integers is exact") {
+		// Decimal division can leave an error in the last guard digit, even when the quotient is an integer.
+		CHECK(num{-12} / num{-3} == num{4});
+		CHECK((num{max} / num{7}).is_machine_int());
+		CHECK((num{1} / num{3}).str(12) == "0.333333333333");
+	}
+
+	TEST_CASE("numbers of different representations compare by value" * doctest::skip(!exact_decimal_ints)) {
+		CHECK(num{"0.5"} * num{4} == num{2});
+		CHECK(num{max} + num{1} > num{max});
+		CHECK(num{max} + num{1} - num{1} == num{max});
+		CHECK(num{1} / num{3} < num{1});
+	}
+
+	TEST_CASE("integers are written as decimals would be" * doctest::skip(!exact_decimal_ints)) {
+		for (auto const a : samples) {
+			for (int const precision : {0, 1, 3, 12, 19, 20, 30}) {
+				INFO("a: ", a, ", precision: ", precision);
+				CHECK(num{a}.str(precision) == num{decimal(a)}.str(precision));
+			}
+		}
+	}
+
+	TEST_CASE("working precision" * doctest::skip(val::working_precisions.size() < 2)) {
+		auto const binary_floats = val::binary_floats_enabled();
+		auto const exact_numbers = val::exact_numbers_enabled();
+		val::set_binary_floats(false);
+		val::set_exact_numbers(false);
+		auto const original = val::working_precision();
+		CHECK(!val::set_working_precision(val::working_precisions.back() + 1));
+		CHECK(val::working_precision() == original);
+		REQUIRE(val::set_working_precision(val::working_precisions[0] + 1));
+		CHECK(val::working_precision() == val::working_precisions[1]);
+		auto const third = num{1} / num{3};
+		auto const product = num{max} * num{max} * num{max} * num{max} * num{max};
+		REQUIRE(val::set_working_precision(val::working_precisions.back()));
+		auto const precise_third = num{1} / num{3};
+		auto const precise_product = num{max} * num{max} * num{max} * num{max} * num{max};
+		val::set_working_precision(original);
+		val::set_binary_floats(binary_floats);
+		val::set_exact_numbers(exact_numbers);
+		// Results are rounded to the working precision, which doesn't show at lower printing precision.
+		CHECK(third != precise_third);
+		CHECK(third.str(12) == precise_third.str(12));
+		CHECK(third.str().size() < precise_third.str().size());
+		// That includes promoted machine integers.
+		CHECK(product != precise_product);
+		CHECK(product.str(30) == precise_product.str(30));
+		// Machine integers are exact at any working precision.
+		CHECK(num{max} - num{1} == num{max - 1});
+	}
+
+	TEST_CASE("exact numbers") {
+		auto const exact_numbers = val::exact_numbers_enabled();
+		val::set_exact_numbers(true);
+		auto const big = num{max} + num{1};
+		auto const power = pow(num{2}, num{100});
+		auto const literal = num{"1267650600228229401496703205376"};
+		auto const negated_min = -num{min};
+		auto const demoted = big - num{1};
+		auto const third = num{1} / num{3};
+		auto const thirds = third + third + third;
+		auto const negative_power = pow(num{2}, num{-3});
+		val::set_exact_numbers(false);
+		auto const decimal_power = pow(num{2}, num{100});
+		val::set_exact_numbers(exact_numbers);
+		// Integers that don't fit a machine integer are exact.
+		CHECK(big.str() == "9223372036854775808");
+		CHECK(power.str() == "1267650600228229401496703205376");
+		CHECK(power == literal);
+		CHECK(negated_min == big);
+		CHECK(power.str(12) == decimal_power.str(12));
+		// They're demoted to machine integers whenever they fit.
+		CHECK(demoted.is_machine_int());
+		CHECK(demoted == num{max});
+		// Quotients of integers are exact rationals.
+		CHECK(thirds.is_machine_int());
+		CHECK(thirds == num{1});
+		CHECK(num{"0.3333"} < third);
+		CHECK(third < num{"0.3334"});
+		CHECK(third.str(12) == "0.333333333333");
+		CHECK(negative_power == num{"0.125"});
+	}
+
+	TEST_CASE("binary floats" * doctest::skip(binary_policy)) {
+		auto const binary_floats = val::binary_floats_enabled();
+		val::set_binary_floats(true);
+		auto const sum = num{"0.1"} + num{"0.2"};
+		auto const quotient = num{1} / num{4};
+		auto const overflow = num{"1e300"} * num{"1e300"};
+		val::set_binary_floats(false);
+		auto const decimal_sum = num{"0.1"} + num{"0.2"};
+		val::set_binary_floats(binary_floats);
+		// Doubles round in binary.
+		CHECK(sum.str(17) == "0.30000000000000004");
+		CHECK(quotient == num{"0.25"});
+		// Doubles that would overflow are promoted to decimals.
+		CHECK(overflow.str(12) == "1e+600");
+		// Decimals round in decimal.
+		CHECK(decimal_sum.str(17) == "0.3");
+	}
+}
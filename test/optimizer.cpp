@@ -0,0 +1,147 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "inference.hpp"
+#include "interpreter.hpp"
+#include "lexer.hpp"
+#include "num.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <string>
+#include <utility>
+
+namespace {
+	using namespace gynjo;
+
+	//! @p input as a string, after resolving its clusters and optimizing it.
+	auto optimized(std::string const& input) -> std::string {
+		auto const tokens = lex(input).value();
+		auto const tree = ast::make();
+		auto const parse_result = parse_expr(*tree, tokens.begin(), tokens.end());
+		REQUIRE(parse_result.has_value());
+		resolve_clusters(*tree, 0, optimize_node);
+		return to_string(parse_result.value().expr, print_form::evaluated);
+	}
+}
+
+TEST_SUITE("optimizer") {
+	TEST_CASE("constant subexpressions are folded") {
+		CHECK(optimized("1 + 2 * 3") == "7");
+		CHECK(optimized("c -> 10/5c + 32") == "((c) -> ((2 * c) + 32))");
+		CHECK(optimized("2^-(-3)") == "8");
+		CHECK(optimized("1 < 2 and (not false)") == "true");
+		CHECK(optimized("1 = 1 ? x : y") == "x");
+		CHECK(optimized("\"a\" = \"a\"") == "true");
+	}
+
+	TEST_CASE("operations that fail or depend on context aren't folded") {
+		CHECK(optimized("1 / 0") == "(1 / 0)");
+		CHECK(optimized("1 + true") == "(1 + true)");
+		CHECK(optimized("0.1 ~ 0.1") == "(0.1 ~ 0.1)");
+		// Other numbers than machine integers depend on the precision and numeric modes in effect when the code runs.
+		CHECK(optimized("9/5") == "(9 / 5)");
+		CHECK(optimized("2^-1") == "(2 ^ -1)");
+		CHECK(optimized("0.1 + 0.2") == "(0.1 + 0.2)");
+		CHECK(optimized("0.5 < 1") == "(0.5 < 1)");
+		// Core constants could be rebound.
+		CHECK(optimized("2PI") == "(2 * PI)");
+	}
+
+	TEST_CASE("powers by constants are simplified") {
+		CHECK(optimized("x^(1/2)") == "(x ^ (1 / 2))");
+		CHECK(optimized("x^3") == "(x ^ 3)");
+		auto const kind = [](std::string const& input) {
+			auto const tokens = lex(input).value();
+			auto const tree = ast::make();
+			auto const parse_result = parse_expr(*tree, tokens.begin(), tokens.end());
+			REQUIRE(parse_result.has_value());
+			resolve_clusters(*tree, 0, optimize_node);
+			return parse_result.value().expr.kind();
+		};
+		CHECK(kind("x^(1/2)") == node_kind::sqrt);
+		CHECK(kind("x^3") == node_kind::int_pow);
+		CHECK(kind("x^64") == node_kind::int_pow);
+		CHECK(kind("x^65") == node_kind::pow);
+		CHECK(kind("x^2.5") == node_kind::pow);
+		CHECK(kind("x^-2") == node_kind::pow);
+	}
+
+	TEST_CASE("optimized code evaluates like unoptimized code") {
+		auto const original_engine = current_engine();
+		auto const original_optimization = optimization_enabled();
+		// Imports the core libraries afresh, so that their functions are optimized or not according to the setting.
+		auto const eval_with_core = [](char const* input) {
+			auto const env = environment::make_empty();
+			import_natives(env);
+			REQUIRE(exec(env, "import \"core/constants.gynj\" import \"core/core.gynj\"").has_value());
+			return std::pair{eval(env, input), env};
+		};
+		for (auto const e : {engine::tree_walker, engine::vm}) {
+			set_engine(e);
+			for (char const* input : {"1 + 2 * 3 - 4 / 5",
+					 "2^-3^2",
+					 "-(2^10)",
+					 "ctof 100",
+					 "ftoc 212",
+					 "sqrt 2",
+					 "sqrt(-1)",
+					 "[4, 9, 16]^(1/2)",
+					 "(x -> x^3)(1.1)",
+					 "(x -> x^2)([1, 2, 3])",
+					 "(x -> x^64)(-1.01)",
+					 "(x -> x^(1/2))(\"s\")",
+					 "(x -> x^3)(true)",
+					 "cbrt 27",
+					 "fact 20",
+					 "1 / 0",
+					 "1 = 1 ? 2 : 1 / 0",
+					 "not 1"}) {
+				INFO("input: ", input);
+				set_optimization(false);
+				auto const [expected, env] = eval_with_core(input);
+				set_optimization(true);
+				auto const [actual, optimized_env] = eval_with_core(input);
+				REQUIRE(expected.has_value() == actual.has_value());
+				if (expected.has_value()) {
+					// A square root can differ from the equivalent power beyond the working precision.
+					CHECK(to_string(expected.value(), env) == to_string(actual.value(), optimized_env));
+				} else {
+					CHECK(expected.error() == actual.error());
+				}
+			}
+		}
+		set_engine(original_engine);
+		set_optimization(original_optimization);
+	}
+
+	TEST_CASE("optimized code follows the numeric modes in effect when it runs") {
+		auto const original_optimization = optimization_enabled();
+		auto const original_exact_numbers = val::exact_numbers_enabled();
+		auto const original_precision = val::working_precision();
+		set_optimization(true);
+		auto const env = environment::make_empty();
+		val::set_exact_numbers(false);
+		val::set_working_precision(16);
+		REQUIRE(exec(env, "let third = x -> x * (1/3)").has_value());
+		auto const code = eval(env, "third").value();
+		SUBCASE("exact numbers") {
+			val::set_exact_numbers(true);
+			CHECK(eval(env, "third 1") == eval(env, "1/3"));
+		}
+		SUBCASE("working precision") {
+			val::set_working_precision(100);
+			CHECK(eval(env, "third 2") == eval(env, "2/3"));
+		}
+		// Code prints as written, not as optimized.
+		CHECK(to_string(code, env) == "((x) -> (x * (1 / 3)))");
+		val::set_exact_numbers(original_exact_numbers);
+		val::set_working_precision(original_precision);
+		set_optimization(original_optimization);
+	}
+}
@@ -0,0 +1,106 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "lexer.hpp"
+#include "parser.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <fmt/format.h>
+
+#include <string>
+
+namespace {
+	using namespace gynjo;
+
+	//! Lexes and parses @p input as an expression in @p tree, requiring that the expression consume all the tokens.
+	auto parse_whole_expr(ast& tree, std::string const& input) -> tl::expected<expr, std::string> {
+		auto const tokens = lex(input).value();
+		auto result = parse_expr(tree, tokens.begin(), tokens.end());
+		if (!result.has_value()) { return tl::unexpected{result.error()}; }
+		if (result.value().it != tokens.end()) { return tl::unexpected{"unconsumed tokens"}; }
+		return result.value().expr;
+	}
+
+	//! Lexes and parses @p input as a statement in @p tree, requiring that the statement consume all the tokens.
+	auto parse_whole_stmt(ast& tree, std::string const& input) -> tl::expected<stmt, std::string> {
+		auto const tokens = lex(input).value();
+		auto result = parse_stmt(tree, tokens.begin(), tokens.end());
+		if (!result.has_value()) { return tl::unexpected{result.error()}; }
+		if (result.value().it != tokens.end()) { return tl::unexpected{"unconsumed tokens"}; }
+		return result.value().stmt;
+	}
+
+	//! @p open repeated @p depth times, then @p inner, then @p close repeated @p depth times.
+	auto nest(std::string const& open, std::string const& inner, std::string const& close, int depth) -> std::string {
+		std::string result;
+		for (int i = 0; i < depth; ++i) {
+			result += open;
+		}
+		result += inner;
+		for (int i = 0; i < depth; ++i) {
+			result += close;
+		}
+		return result;
+	}
+}
+
+TEST_SUITE("parser") {
+	TEST_CASE("tuples and lambdas are distinguished without backtracking") {
+		auto const tree = ast::make();
+		CHECK(parse_whole_expr(*tree, "(a, b) -> a").value().kind() == node_kind::lambda);
+		CHECK(parse_whole_expr(*tree, "a -> a").value().kind() == node_kind::lambda);
+		CHECK(parse_whole_expr(*tree, "() -> 1").value().kind() == node_kind::lambda);
+		CHECK(parse_whole_expr(*tree, "(a, b)").value().kind() == node_kind::tup);
+		CHECK(parse_whole_expr(*tree, "(a, 1)").value().kind() == node_kind::tup);
+		CHECK(parse_whole_expr(*tree, "(a)").value().kind() == node_kind::sym);
+		CHECK(parse_whole_expr(*tree, "(a, 1) -> a").error() == "unconsumed tokens");
+	}
+
+	TEST_CASE("parse errors are reported from the point of failure") {
+		auto const tree = ast::make();
+		CHECK(parse_whole_expr(*tree, "(1, 2").error() == "expected ')'");
+		CHECK(parse_whole_expr(*tree, "[1, 2").error() == "expected ']' after list");
+		CHECK(parse_whole_expr(*tree, "a -> ").error() == "expected function body");
+		CHECK(parse_whole_expr(*tree, "2 *").error() == "expected an operand");
+		CHECK(parse_whole_expr(*tree, "1 + ").error() == "expected term");
+		CHECK(parse_whole_stmt(*tree, "let 1 = 2").error() == "expected variable after \"let\", found 1");
+	}
+
+	TEST_CASE("deeply nested expressions") {
+		auto const tree = ast::make();
+		// The outermost expression or statement is the first level.
+		constexpr int depth = default_max_nesting_depth - 1;
+		CHECK(parse_whole_expr(*tree, nest("(", "1", ")", depth)).has_value());
+		CHECK(parse_whole_expr(*tree, nest("[", "1", "]", depth)).has_value());
+		CHECK(parse_whole_expr(*tree, nest("{ return ", "1", " }", depth)).has_value());
+		CHECK(parse_whole_expr(*tree, nest("-(1 + ", "1", ")", depth)).has_value());
+		CHECK(parse_whole_expr(*tree, nest("not ", "true", "", 10 * depth)).has_value());
+		CHECK(parse_whole_expr(*tree, nest("(", "1", "", depth)).error() == "expected ')'");
+		CHECK(parse_whole_stmt(*tree, nest("if true then ", "1;", "", depth)).has_value());
+		CHECK(parse_whole_stmt(*tree, nest("while false do ", "1;", "", depth)).has_value());
+	}
+
+	TEST_CASE("nesting beyond the maximum depth is a parse error") {
+		auto const tree = ast::make();
+		constexpr int depth = default_max_nesting_depth;
+		auto const error = fmt::format("maximum nesting depth of {} exceeded", default_max_nesting_depth);
+		CHECK(parse_whole_expr(*tree, nest("(", "1", ")", depth)).error() == error);
+		CHECK(parse_whole_expr(*tree, nest("[", "1", "]", depth)).error() == error);
+		CHECK(parse_whole_expr(*tree, nest("{ return ", "1", " }", depth)).error() == error);
+		CHECK(parse_whole_expr(*tree, nest("(", "1", "", 25 * depth)).error() == error);
+		CHECK(parse_whole_stmt(*tree, nest("if true then ", "1;", "", depth)).error() == error);
+		// Later parses are unaffected.
+		CHECK(parse_whole_expr(*tree, nest("(", "1", ")", depth - 1)).has_value());
+
+		SUBCASE("the maximum is configurable") {
+			set_max_nesting_depth(10);
+			CHECK(parse_whole_expr(*tree, nest("(", "1", ")", 9)).has_value());
+			CHECK(parse_whole_expr(*tree, nest("(", "1", ")", 10)).error() == "maximum nesting depth of 10 exceeded");
+			set_max_nesting_depth(default_max_nesting_depth);
+		}
+	}
+}
@@ -0,0 +1,12 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+//! @brief The original regex-based lexer, kept as a reference implementation for differential testing.
+
+#pragma once
+
+#include "lexer.hpp"
+
+namespace gynjo::test {
+	//! Lexes @p input into a vector of tokens by trying each token regex in turn at every position.
+	auto regex_lex(std::string_view input) -> lex_result;
+}
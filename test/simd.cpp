@@ -0,0 +1,62 @@
+//! @file
+//! @copyright See <a href="LICENSE.txt">LICENSE.txt</a>.
+
+#include "simd.hpp"
+
+#ifndef _DEBUG
+#define DOCTEST_CONFIG_DISABLE
+#endif
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+TEST_SUITE("simd") {
+	using namespace gynjo;
+
+	TEST_CASE("scanning kernels match scalar scanning on every supported instruction set") {
+		// Random text drawn mostly from the characters the kernels look for, plus high bytes to catch signedness bugs.
+		std::string const alphabet = " \t\n\v\f\r0123456789./a\x80\xff\x08\x0e\x1f!";
+		std::mt19937 gen{42};
+		std::uniform_int_distribution<std::size_t> char_dist{0, alphabet.size() - 1};
+		std::string text(4096, ' ');
+		for (auto& c : text) {
+			c = alphabet[char_dist(gen)];
+		}
+		// Long runs exercise the vector loops.
+		text.replace(100, 200, 200, ' ');
+		text.replace(400, 100, 100, '7');
+		text.replace(600, 300, 300, 'x');
+
+		auto const is_space = [](char c) { return c == ' ' || ('\t' <= c && c <= '\r'); };
+		auto const is_line_end = [](char c) { return c == '\n' || c == '\r'; };
+		auto const is_digit = [](char c) { return '0' <= c && c <= '9'; };
+
+		auto const original_isa = simd::active_isa();
+		for (auto const isa : {simd::isa::scalar, simd::isa::sse2, simd::isa::avx2}) {
+			if (!simd::set_active_isa(isa)) { continue; }
+			INFO("instruction set: ", simd::to_string(isa));
+			for (std::size_t begin = 0; begin < text.size(); begin += 13) {
+				for (std::size_t const length : {0, 1, 15, 16, 17, 31, 32, 33, 64, 500}) {
+					auto const first = text.data() + begin;
+					auto const last = text.data() + std::min(text.size(), begin + length);
+					CHECK(std::find_if_not(first, last, is_space) == simd::skip_space(first, last));
+					CHECK(std::find_if(first, last, is_line_end) == simd::find_line_end(first, last));
+					CHECK(std::find_if_not(first, last, is_digit) == simd::skip_digits(first, last));
+				}
+			}
+		}
+		simd::set_active_isa(original_isa);
+	}
+
+	TEST_CASE("unsupported instruction sets are rejected") {
+		auto const best = simd::best_isa();
+		CHECK(simd::set_active_isa(best));
+		CHECK(best == simd::active_isa());
+		if (best != simd::isa::avx2) {
+			CHECK_FALSE(simd::set_active_isa(simd::isa::avx2));
+			CHECK(best == simd::active_isa());
+		}
+	}
+}